@@ -9,7 +9,7 @@ public class DSTerrainScan : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", 
-			"InputCore", "EnhancedInput", "Niagara", "Landscape", "Foliage", "RuntimeVideoRecorder" });
+			"InputCore", "EnhancedInput", "Niagara", "Landscape", "Foliage", "RuntimeVideoRecorder", "RenderCore", "RHI", "PhysicsCore" });
 		
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
@@ -7,36 +7,83 @@
 #include "Components/DecalComponent.h"
 #include "GameFramework/Actor.h"
 #include "GameFramework/Character.h"
-#include "Kismet/GameplayStatics.h"
 #include "Materials/MaterialParameterCollectionInstance.h"
+#include "TerrainScanMPCSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "FootprintCrowdSubsystem.h"
+#include "Algo/Unique.h"
+#include "TerrainScanStats.h"
 
-constexpr int32 GMaxFootprints = 99;
+/** Lifts the instanced footprints off the ground, to avoid z-fighting. */
+constexpr float GFootprintInstanceOffset = 1.0f;
+
+/** Transform of the instances of free and dead slots, zero-scaled so that they never render. */
+static const FTransform GHiddenFootprintInstance{FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector};
 
 UFootprintControllerComponent::UFootprintControllerComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
-	PrimaryComponentTick.SetTickFunctionEnable(true);
+
+	// Ticks only while footprints or a highlight are in flight, see TickComponent.
+	PrimaryComponentTick.bStartWithTickEnabled = false;
 }
 
 void UFootprintControllerComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	if (!DecalMaterial || !MPC) return;
+	Footprints.SetCapacity(FMath::Max(MaxFootprints, 1));
+
+	if (!MPC) return;
+
+	if (bUseCrowdSubsystem)
+	{
+		if (!FootprintMesh || !InstancedMaterial) return;
+
+		CrowdSubsystem = GetWorld()->GetSubsystem<UFootprintCrowdSubsystem>();
+		CrowdBatch = CrowdSubsystem->RegisterBatch(FootprintMesh, InstancedMaterial, DecalSize,
+			RegularFootprintLifetime + FadeTime);
+	}
+	else if (RenderMode == EFootprintRenderMode::Instanced)
+	{
+		if (!FootprintMesh || !InstancedMaterial) return;
+
+		SetupFootprintInstances();
+	}
+	else
+	{
+		if (!DecalMaterial) return;
+
+		DecalPool.Initialize(GetWorld(), Footprints.GetCapacity(), DecalSize);
+	}
 	
 	if (UMaterialParameterCollectionInstance* MPCI = GetWorld()->GetParameterCollectionInstance(MPC))
 	{
 		MPCI->SetScalarParameterValue(TEXT("_Footprint_Highlight_Fade_Time"), HighlightFadeTime);
 	}
 
+	if (UTerrainScanMPCSubsystem* MPCSubsystem = GetWorld()->GetSubsystem<UTerrainScanMPCSubsystem>())
+	{
+		MPCBlock = MPCSubsystem->GetBlock(MPC);
+	}
+
 	Scanner = GetOwner()->GetComponentByClass<UScannerControllerComponent>();
 	Icons = GetOwner()->GetComponentByClass<UScannerIconsControllerComponent>();
 	
+	// No highlight until the first scan.
+	if (MPCBlock)
+	{
+		MPCBlock->SetScalar(ETerrainScanScalar::FootprintRelativeHighlightTime, HighlightFadeTime);
+	}
+
 	// Setup the DMIs
-	LeftFootstep = CreateFootstepDMI(false, false);
-	LeftFootstepHighlight = CreateFootstepDMI(false, true);
-	RightFootstep = CreateFootstepDMI(true, false);
-	RightFootstepHighlight = CreateFootstepDMI(true, true);
+	if (RenderMode == EFootprintRenderMode::Decals && !CrowdSubsystem)
+	{
+		LeftFootstep = CreateFootstepDMI(false, false);
+		LeftFootstepHighlight = CreateFootstepDMI(false, true);
+		RightFootstep = CreateFootstepDMI(true, false);
+		RightFootstepHighlight = CreateFootstepDMI(true, true);
+	}
 
 	// Footprints do not show up on the player character's mesh
 	if (auto* PlayerCharacter = GetOwner<ACharacter>())
@@ -45,142 +92,392 @@ void UFootprintControllerComponent::BeginPlay()
 	}
 }
 
-void UFootprintControllerComponent::TickComponent(float DeltaTime, ELevelTick TickType,
-	FActorComponentTickFunction* ThisTickFunction)
+void UFootprintControllerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	for (FFootprintData& Footprint : Footprints)
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	// The footprints stay on the ground after their character, until the last one is faded out.
+	double LastDeathTime = CurrentTime;
+	for (int32 Index = 0; Index < Footprints.Num(); ++Index)
 	{
-		Footprint.Age += DeltaTime;
+		const int32 Slot = Footprints.GetSlot(Index);
+		LastDeathTime = FMath::Max(LastDeathTime, Footprints.BirthTimes[Slot] + Footprints.Lifetimes[Slot]);
 	}
 
-	if (!IsValid(Scanner) || !IsValid(Icons)) return;
-	
+	DecalPool.Shutdown(static_cast<float>(LastDeathTime - CurrentTime));
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UFootprintControllerComponent::TickComponent(float DeltaTime, ELevelTick TickType,
+	FActorComponentTickFunction* ThisTickFunction)
+{
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_FootprintsTick);
+
 	double CurrentTime = GetWorld()->GetTimeSeconds();
-	double ElapsedTime = CurrentTime - Scanner->GetCurrentFrameScannerState().StartTime;
-	double RelativeHighlightTime = ElapsedTime - Icons->TotalEffectDuration();
-	
-	UMaterialParameterCollectionInstance* MPCI = GetWorld()->GetParameterCollectionInstance(MPC);
-	MPCI->SetScalarParameterValue(TEXT("_Footprint_Relative_Highlight_Time"),
-		FMath::Clamp(static_cast<float>(RelativeHighlightTime), 0.f, HighlightFadeTime));
 
-	// Clean array from dead footprints
-	Footprints.RemoveAll([this](const FFootprintData& Footprint)
+	// Footprints of last frame's footsteps, in order, before any expiry or eviction.
+	FootstepTraces.Poll(GetWorld(), [this](const FHitResult* Hit, const FPendingFootstep& Step)
+	{
+		if (!Hit) return;
+
+		PlaceFootprint(FFootprintData{Hit->Location, MakeFootprintRotation(Step.Forward, Hit->Normal), Step.Type});
+	});
+
+	// Drop dead footprints, their decals are already faded out.
+	Footprints.ExpireOldest(CurrentTime, [this](int32 Slot)
 	{
-		return Footprint.Age >= Footprint.Lifetime;
+		ReleaseFootprint(Slot);
 	});
+
+	if (FootprintInstances && bFootprintInstancesDirty)
+	{
+		UpdateFootprintInstances();
+	}
+
+	bool bHighlightInFlight = false;
+
+	if (IsValid(Scanner) && IsValid(Icons) && MPCBlock)
+	{
+		double ElapsedTime = CurrentTime - Scanner->GetCurrentFrameScannerState().StartTime;
+		double RelativeHighlightTime = ElapsedTime - Icons->TotalEffectDuration();
+
+		MPCBlock->SetScalar(ETerrainScanScalar::FootprintRelativeHighlightTime,
+			FMath::Clamp(static_cast<float>(RelativeHighlightTime), 0.f, HighlightFadeTime));
+
+		bHighlightInFlight = RelativeHighlightTime < HighlightFadeTime;
+	}
+
+	// Idle until the next footstep or scan. Crowd footprints are left to the subsystem.
+	if (!bHighlightInFlight && FootstepTraces.IsEmpty() && Footprints.IsEmpty() && !bFootprintInstancesDirty)
+	{
+		SetComponentTickEnabled(false);
+	}
 }
 
 void UFootprintControllerComponent::HandleFootstep(EFootstepType FootstepType)
 {
-	TOptional<FFootprintData> Hit = CheckFootstepCollision(FootstepType);
-	if (!Hit) return;
-	
-	FFootprintData Footprint = Hit.GetValue();
-		
+	if (bIgnoreAnimFootsteps) return;
+
+	FVector TraceStart, TraceEnd;
+	if (!GetFootstepTrace(FootstepType, TraceStart, TraceEnd)) return;
+
+	HandleFootstepTrace(FootstepType, TraceStart, TraceEnd, GetOwner()->GetActorForwardVector());
+}
+
+void UFootprintControllerComponent::HandleFootstepTrace(EFootstepType FootstepType, const FVector& TraceStart,
+	const FVector& TraceEnd, const FVector& Forward)
+{
+	OnFootstepTraceRequested.Broadcast(FootstepType, TraceStart, TraceEnd, Forward);
+
+	if (CrowdSubsystem)
+	{
+		FFootprintCrowdStep Step;
+		Step.Batch = CrowdBatch;
+		Step.Type = FootstepType;
+		Step.TraceStart = TraceStart;
+		Step.TraceEnd = TraceEnd;
+		Step.Forward = Forward;
+
+		CrowdSubsystem->QueueFootstep(Step);
+		return;
+	}
+
+	FootstepTraces.Request(GetWorld(), TraceStart, TraceEnd, FPendingFootstep{FootstepType, Forward});
+	SetComponentTickEnabled(true);
+}
+
+void UFootprintControllerComponent::PlaceFootprint(FFootprintData Footprint)
+{
 	if (Icons->IsEffectActive() && Scanner->IsPointInsideScanArea(Footprint.Location))
 	{
 		Footprint.IsHighlighted = true;
 	}
 
-	UMaterialInstanceDynamic* FootprintDMI = GetFootprintMaterial(Footprint);
+	EFootprintFlags Flags = EFootprintFlags::None;
+	if (Footprint.Type == EFootstepType::Right) Flags |= EFootprintFlags::Right;
+	if (Footprint.IsHighlighted) Flags |= EFootprintFlags::Highlighted;
 
 	Footprint.Lifetime = ComputeLifetime(Footprint.IsHighlighted);
 
-	UDecalComponent* FootprintDecal = UGameplayStatics::SpawnDecalAtLocation(GetWorld(),
-		FootprintDMI, DecalSize, Footprint.Location, Footprint.Rotation, Footprint.Lifetime);
-		
-	FootprintDecal->SetFadeOut(Footprint.Lifetime - FadeTime, FadeTime, false);
-		
-	Footprint.Decal = FootprintDecal;
+	// Make room first, so that a dropped decal is recycled for this footprint.
+	if (Footprints.IsFull())
+	{
+		MakeRoomForFootprint();
+	}
 
 	// Save footprint in the controller's memory
-	if (Footprints.Num() == GMaxFootprints)
+	const int32 Slot = Footprints.Add(Footprint.Location, Footprint.Rotation, Flags, GetWorld()->GetTimeSeconds(),
+		Footprint.Lifetime);
+
+	FootprintHash.Add(Slot, Footprint.Location);
+	if (Footprint.IsHighlighted) HighlightedSlots.Add(Slot);
+
+	// Expires the footprint.
+	SetComponentTickEnabled(true);
+
+	if (RenderMode == EFootprintRenderMode::Instanced)
 	{
-		UDecalComponent* Decal = Footprints[0].Decal;
-			
-		Footprints.RemoveAt(0, EAllowShrinking::No);
-			
-		Decal->DestroyComponent();
-		if (AActor* Owner = Decal->GetOwner())
+		MarkFootprintInstanceDirty(Slot);
+		return;
+	}
+
+	Footprints.Decals[Slot] = DecalPool.Acquire(GetFootprintMaterial(Flags), Footprint.Location, Footprint.Rotation,
+		Footprint.Lifetime, FadeTime);
+}
+
+void UFootprintControllerComponent::MakeRoomForFootprint()
+{
+	// Footprints dying out of order, e.g. regular ones behind highlighted ones, go before any live one.
+	Footprints.RemoveDead(GetWorld()->GetTimeSeconds(), [this](int32 Slot)
+	{
+		ReleaseFootprint(Slot);
+	}, [this](int32 FromSlot, int32 ToSlot)
+	{
+		MoveFootprint(FromSlot, ToSlot);
+	});
+
+	if (Footprints.IsFull())
+	{
+		EvictOldestFootprint();
+	}
+}
+
+void UFootprintControllerComponent::EvictOldestFootprint()
+{
+	ReleaseFootprint(Footprints.GetOldestSlot());
+	Footprints.PopOldest();
+}
+
+void UFootprintControllerComponent::SetupFootprintInstances()
+{
+	FootprintInstances = NewObject<UInstancedStaticMeshComponent>(GetOwner(), TEXT("FootprintInstances"));
+	FootprintInstances->SetStaticMesh(FootprintMesh);
+	FootprintInstances->SetMaterial(0, InstancedMaterial);
+	FootprintInstances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	FootprintInstances->SetCastShadow(false);
+	FootprintInstances->SetNumCustomDataFloats(GFootprintCustomDataFloats);
+
+	// Instances are placed in world space, never follow the owner.
+	FootprintInstances->SetUsingAbsoluteLocation(true);
+	FootprintInstances->SetUsingAbsoluteRotation(true);
+	FootprintInstances->SetUsingAbsoluteScale(true);
+	FootprintInstances->RegisterComponent();
+
+	ResetFootprintInstances();
+}
+
+void UFootprintControllerComponent::ResetFootprintInstances()
+{
+	const int32 Capacity = Footprints.GetCapacity();
+
+	// One instance per store slot, hidden until a footprint is placed in it. Zeroed custom data is a dead footprint.
+	TArray<FTransform> Transforms;
+	Transforms.Init(GHiddenFootprintInstance, Capacity);
+
+	FootprintInstances->ClearInstances();
+	FootprintInstances->AddInstances(Transforms, false, true);
+
+	DirtyFootprintInstances.Init(false, Capacity);
+	bFootprintInstancesDirty = false;
+}
+
+void UFootprintControllerComponent::MarkFootprintInstanceDirty(int32 Slot)
+{
+	if (!FootprintInstances) return;
+
+	DirtyFootprintInstances[Slot] = true;
+	bFootprintInstancesDirty = true;
+}
+
+void UFootprintControllerComponent::UpdateFootprintInstances()
+{
+	bFootprintInstancesDirty = false;
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	// Custom data and transforms are written without render updates: the whole component is updated once at the end.
+	for (TConstSetBitIterator<> It(DirtyFootprintInstances); It; ++It)
+	{
+		const int32 Slot = It.GetIndex();
+
+		if (!Footprints.IsStored(Slot) || !Footprints.IsAlive(Slot, CurrentTime))
 		{
-			Owner->Destroy();
+			FootprintInstances->UpdateInstanceTransform(Slot, GHiddenFootprintInstance, true, false, true);
+			continue;
 		}
+
+		FootprintInstances->UpdateInstanceTransform(Slot,
+			MakeFootprintInstanceTransform(Footprints.Locations[Slot], Footprints.Rotations[Slot], DecalSize),
+			true, false, true);
+
+		const EFootprintFlags Flags = Footprints.Flags[Slot];
+		const float CustomData[GFootprintCustomDataFloats] = {
+			EnumHasAnyFlags(Flags, EFootprintFlags::Right) ? 1.0f : 0.0f,
+			EnumHasAnyFlags(Flags, EFootprintFlags::Highlighted) ? 1.0f : 0.0f,
+			static_cast<float>(Footprints.BirthTimes[Slot]),
+			Footprints.Lifetimes[Slot]
+		};
+		FootprintInstances->SetCustomData(Slot, CustomData, false);
 	}
-	Footprints.Add(Footprint);
+
+	DirtyFootprintInstances.SetRange(0, DirtyFootprintInstances.Num(), false);
+
+	FootprintInstances->MarkRenderStateDirty();
 }
 
 void UFootprintControllerComponent::StartFootprintsLifecycle()
 {
-	for (FFootprintData& Footprint : Footprints)
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_StartFootprints);
+
+	// Advances the highlight time.
+	SetComponentTickEnabled(true);
+
+	// A scan reveals the footprints of every crowd character, whichever mode the scanner itself uses.
+	if (UFootprintCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UFootprintCrowdSubsystem>())
 	{
-		if (!Footprint.Decal) break;
-		
-		bool bWasHighlighted = Footprint.IsHighlighted;
-		Footprint.IsHighlighted = Scanner->IsPointInsideScanArea(Footprint.Location);
-		
-		bool bHighlightChange = Footprint.IsHighlighted != bWasHighlighted;
+		Crowd->HighlightFootprints(Scanner, Icons, HighlightFadeTime);
+	}
 
-		if (bHighlightChange || Footprint.IsHighlighted)
-		{
-			Footprint.Age = 0.f;
-			Footprint.Lifetime = ComputeLifetime(Footprint.IsHighlighted);
+	// Crowd characters have no footprints of their own.
+	if (CrowdSubsystem) return;
 
-			if (bHighlightChange)
-			{
-				UMaterialInstanceDynamic* NewMaterial = GetFootprintMaterial(Footprint);
-				Footprint.Decal->SetDecalMaterial(NewMaterial);
-			}
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+	const float Range = Scanner->GetScannerFinalRange();
 
-			Footprint.Decal->SetLifeSpan(Footprint.Lifetime);
-			Footprint.Decal->SetFadeOut(Footprint.Lifetime - FadeTime, FadeTime, false);
-		}
+	// Only the footprints near the scan cone can be highlighted, and only the ones highlighted
+	// since the last scan need their highlight cleared: nothing else is visited.
+	TArray<int32> Slots = MoveTemp(HighlightedSlots);
+	HighlightedSlots.Reset();
+	FootprintHash.Query(Scanner->GetScanAreaBounds(Range), Slots);
+
+	Slots.Sort();
+	Slots.SetNum(Algo::Unique(Slots), EAllowShrinking::No);
+
+	TArray<FVector> Locations;
+	Locations.Reserve(Slots.Num());
+	for (int32 Slot : Slots)
+	{
+		Locations.Add(Footprints.Locations[Slot]);
+	}
+
+	TBitArray<> InsideScanArea;
+	Scanner->IsPointsInsideScanArea(Locations, InsideScanArea, Range);
+	
+	for (int32 Index = 0; Index < Slots.Num(); ++Index)
+	{
+		const int32 Slot = Slots[Index];
+
+		// Dead, waiting for the older footprints to expire.
+		if (!Footprints.IsAlive(Slot, CurrentTime)) continue;
+
+		UpdateFootprintHighlight(Slot, InsideScanArea[Index], CurrentTime);
 	}
 }
 
-TOptional<FFootprintData> UFootprintControllerComponent::CheckFootstepCollision(EFootstepType FootstepType) const
+void UFootprintControllerComponent::UpdateFootprintHighlight(int32 Slot, bool bIsHighlighted, double CurrentTime)
 {
-	auto* PlayerCharacter = GetOwner<ACharacter>();
-	if (!PlayerCharacter) return TOptional<FFootprintData>();
+	EFootprintFlags& Flags = Footprints.Flags[Slot];
 
-	FHitResult RaycastResult;
-	
-	FName BoneSocketName = FootstepType == EFootstepType::Left ? FName{"foot_l_Socket"} : FName{"foot_r_Socket"};
-	FVector TraceStart = PlayerCharacter->GetMesh()->GetSocketLocation(BoneSocketName) + FVector{0.0f, 0.0f, 20.0f};
-	FVector TraceEnd = TraceStart - FVector{0.0f, 0.0f, 50.0f};
+	const bool bWasHighlighted = EnumHasAnyFlags(Flags, EFootprintFlags::Highlighted);
+	if (!bIsHighlighted && !bWasHighlighted) return;
 
-	// If raycast hits...
-	if (GetWorld()->LineTraceSingleByChannel(RaycastResult, TraceStart, TraceEnd, ECC_Visibility))
+	if (bIsHighlighted)
 	{
-		FVector FootstepLocation = RaycastResult.Location;
-		
-		FVector HitNormal = RaycastResult.Normal;
-		FVector PlayerForwardVector = PlayerCharacter->GetActorForwardVector();
-
-		// Orient the decal correctly along the terrain.
-		FRotator FootstepRotation = FRotationMatrix::MakeFromXZ(
-			PlayerForwardVector.GetSafeNormal(), HitNormal.GetSafeNormal()).Rotator();
-		FootstepRotation.Pitch -= +90.0f;
-		FootstepRotation.Yaw += 90.0f;
-		
-		return FFootprintData{FootstepLocation, FootstepRotation, FootstepType};
+		Flags |= EFootprintFlags::Highlighted;
+		HighlightedSlots.Add(Slot);
 	}
 	else
 	{
-		return TOptional<FFootprintData>();
+		Flags &= ~EFootprintFlags::Highlighted;
 	}
+
+	Footprints.BirthTimes[Slot] = CurrentTime;
+	Footprints.Lifetimes[Slot] = ComputeLifetime(bIsHighlighted);
+
+	// Instances read the new state from their custom data.
+	if (RenderMode == EFootprintRenderMode::Instanced)
+	{
+		MarkFootprintInstanceDirty(Slot);
+		return;
+	}
+
+	// A missing decal only affects its own footprint.
+	UDecalComponent* Decal = Footprints.Decals[Slot].Get();
+	if (!Decal) return;
+
+	if (bIsHighlighted != bWasHighlighted)
+	{
+		Decal->SetDecalMaterial(GetFootprintMaterial(Flags));
+	}
+
+	FFootprintDecalPool::RestartFade(Decal, Footprints.Lifetimes[Slot], FadeTime);
 }
 
-UMaterialInstanceDynamic* UFootprintControllerComponent::GetFootprintMaterial(const FFootprintData& Footprint) const
+void UFootprintControllerComponent::ReleaseFootprint(int32 Slot)
 {
-	switch (Footprint.Type)
+	FootprintHash.Remove(Slot, Footprints.Locations[Slot]);
+	DecalPool.Release(Footprints.Decals[Slot].Get());
+	MarkFootprintInstanceDirty(Slot);
+}
+
+void UFootprintControllerComponent::MoveFootprint(int32 FromSlot, int32 ToSlot)
+{
+	const FVector& Location = Footprints.Locations[FromSlot];
+	FootprintHash.Remove(FromSlot, Location);
+	FootprintHash.Add(ToSlot, Location);
+
+	// Moves only go to older slots, a remapped entry is never moved twice by the same compaction.
+	for (int32& Slot : HighlightedSlots)
 	{
-		case EFootstepType::Left:
-			return Footprint.IsHighlighted ? LeftFootstepHighlight : LeftFootstep;
-		case EFootstepType::Right:
-			return Footprint.IsHighlighted ? RightFootstepHighlight : RightFootstep;
-		default:
-			return nullptr;
+		if (Slot == FromSlot) Slot = ToSlot;
 	}
+
+	MarkFootprintInstanceDirty(FromSlot);
+	MarkFootprintInstanceDirty(ToSlot);
+}
+
+bool UFootprintControllerComponent::GetFootstepTrace(EFootstepType FootstepType, FVector& OutTraceStart,
+	FVector& OutTraceEnd) const
+{
+	auto* PlayerCharacter = GetOwner<ACharacter>();
+	if (!PlayerCharacter) return false;
+
+	FName BoneSocketName = FootstepType == EFootstepType::Left ? FName{"foot_l_Socket"} : FName{"foot_r_Socket"};
+	OutTraceStart = PlayerCharacter->GetMesh()->GetSocketLocation(BoneSocketName) + FVector{0.0f, 0.0f, 20.0f};
+	OutTraceEnd = OutTraceStart - FVector{0.0f, 0.0f, 50.0f};
+	return true;
+}
+
+FRotator MakeFootprintRotation(const FVector& Forward, const FVector& SurfaceNormal)
+{
+	// Orient the decal correctly along the terrain.
+	FRotator FootstepRotation = FRotationMatrix::MakeFromXZ(
+		Forward.GetSafeNormal(), SurfaceNormal.GetSafeNormal()).Rotator();
+	FootstepRotation.Pitch -= +90.0f;
+	FootstepRotation.Yaw += 90.0f;
+	return FootstepRotation;
+}
+
+FTransform MakeFootprintInstanceTransform(const FVector& Location, const FRotator& Rotation, const FVector& DecalSize)
+{
+	// Footprint rotations orient decals, projecting along X: lay the mesh plane on the projection plane.
+	static const FQuat MeshToDecal = FRotator{90.0f, 0.0f, 0.0f}.Quaternion();
+
+	const FQuat MeshRotation = Rotation.Quaternion() * MeshToDecal;
+	const FVector Scale{DecalSize.Z / 50.0f, DecalSize.Y / 50.0f, 1.0f};
+	return FTransform{MeshRotation, Location + MeshRotation.GetUpVector() * GFootprintInstanceOffset, Scale};
+}
+
+UMaterialInstanceDynamic* UFootprintControllerComponent::GetFootprintMaterial(EFootprintFlags Flags) const
+{
+	const bool bHighlighted = EnumHasAnyFlags(Flags, EFootprintFlags::Highlighted);
+
+	if (EnumHasAnyFlags(Flags, EFootprintFlags::Right))
+	{
+		return bHighlighted ? RightFootstepHighlight : RightFootstep;
+	}
+	return bHighlighted ? LeftFootstepHighlight : LeftFootstep;
 }
 
 float UFootprintControllerComponent::ComputeLifetime(bool bHighlighted) const
@@ -205,31 +502,3 @@ UMaterialInstanceDynamic* UFootprintControllerComponent::CreateFootstepDMI(bool
 	DMI->SetScalarParameterValue(TEXT("IsHighlighted"), bHighlighted ? 1.f : 0.f);
 	return DMI;
 }
-
-void DEBUG_PrintTArray(const TArray<FFootprintData>& Footprints)
-{
-	FString Output = TEXT("[");
-
-	for (int32 i = 0; i < Footprints.Num(); ++i)
-	{
-		const FFootprintData& FP = Footprints[i];
-
-		Output += FString::Printf(TEXT("{%d%s}"), 
-			i, 
-			FP.IsHighlighted ? TEXT(",h") : TEXT(""));
-
-		if (i < Footprints.Num() - 1)
-		{
-			Output += TEXT(", ");
-		}
-	}
-
-	Output += TEXT("]");
-
-	UE_LOG(LogTemp, Warning, TEXT("Footprints: %s"), *Output);
-
-	if (GEngine)
-	{
-		GEngine->AddOnScreenDebugMessage(-1, 3.f, FColor::Yellow, Output);
-	}
-}
@@ -2,10 +2,18 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "FootprintStore.h"
+#include "FootprintDecalPool.h"
+#include "FootprintSpatialHash.h"
+#include "FootstepTraceQueue.h"
 #include "FootprintControllerComponent.generated.h"
 
 class UScannerControllerComponent;
 class UScannerIconsControllerComponent;
+class FTerrainScanMPCBlock;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+class UFootprintCrowdSubsystem;
 
 UENUM(BlueprintType)
 enum class EFootstepType : uint8
@@ -14,6 +22,24 @@ enum class EFootstepType : uint8
 	Right
 };
 
+UENUM()
+enum class EFootprintRenderMode : uint8
+{
+	/** One pooled decal component per footprint. */
+	Decals,
+
+	/**
+	 * All the footprints of the character in a single instanced mesh, one instance per store slot.
+	 * Per-instance custom data holds side (0 left, 1 right), highlighted state, birth time and
+	 * lifetime: the material computes fade and highlight from them. No such material ships with
+	 * the plugin, InstancedMaterial must be authored for this mode.
+	 */
+	Instanced
+};
+
+DECLARE_MULTICAST_DELEGATE_FourParams(FOnFootstepTraceRequested, EFootstepType /*FootstepType*/,
+	const FVector& /*TraceStart*/, const FVector& /*TraceEnd*/, const FVector& /*Forward*/);
+
 USTRUCT()
 struct FFootprintData
 {
@@ -25,15 +51,10 @@ struct FFootprintData
 
 	EFootstepType Type;
 
-	float Age;
-
-	/** Expected lifetime: footprint dies when Age >= Lifetime. */
+	/** Expected lifetime, in seconds from placement. */
 	float Lifetime;
 
 	bool IsHighlighted;
-
-	UPROPERTY()
-	UDecalComponent* Decal;
 };
 
 UCLASS(ClassGroup=(Custom), Blueprintable, meta=(BlueprintSpawnableComponent))
@@ -54,6 +75,27 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Decal", meta = (AllowPrivateAccess = "true"))
 	FVector DecalSize;
 
+	/** How footprints are rendered. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Decal", meta = (AllowPrivateAccess = "true"))
+	EFootprintRenderMode RenderMode = EFootprintRenderMode::Decals;
+
+	/** Footprint mesh of the Instanced render mode: a 100x100 Unreal Units plane facing +Z. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Decal", meta = (AllowPrivateAccess = "true",
+		EditCondition = "RenderMode == EFootprintRenderMode::Instanced"))
+	TObjectPtr<UStaticMesh> FootprintMesh;
+
+	/**
+	 * Footprint material of the Instanced render mode, reading the custom data described in EFootprintRenderMode.
+	 * User-authored: the decal material does not work on meshes, and the mode renders nothing without this one.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Decal", meta = (AllowPrivateAccess = "true",
+		EditCondition = "RenderMode == EFootprintRenderMode::Instanced"))
+	TObjectPtr<UMaterialInterface> InstancedMaterial;
+
+	/** Maximum number of footprints of this character. The oldest one is removed to make room. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Decal", meta = (AllowPrivateAccess = "true", ClampMin = "1"))
+	int32 MaxFootprints = 99;
+
 
  	/** Time in seconds for the lifetime of a regular footprint, not including fade time. */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Time", meta = (AllowPrivateAccess = "true"))
@@ -71,34 +113,128 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "MPC", meta = (AllowPrivateAccess = "true"))
 	TObjectPtr<UMaterialParameterCollection> MPC;
 
+
+	/**
+	 * If true, footprints are handed to the UFootprintCrowdSubsystem, which owns, traces and renders
+	 * the footprints of every character in the world under a global budget. Rendering is always
+	 * instanced (FootprintMesh and InstancedMaterial), and MaxFootprints is ignored. Meant for NPC crowds.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Crowd", meta = (AllowPrivateAccess = "true"))
+	bool bUseCrowdSubsystem = false;
+
 protected:
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
 		FActorComponentTickFunction* ThisTickFunction) override;
 
 	/**
-	 * Handles footprint spawning in response to player's walking.
+	 * Handles footprint spawning in response to player's walking. The ground trace is asynchronous:
+	 * the footprint is placed when its result arrives, at the next tick.
 	 * @param FootstepType left or right.
 	 */
 	void HandleFootstep(EFootstepType FootstepType);
 
+	/**
+	 * Places a footprint where the given ground trace hits, as HandleFootstep does for the foot sockets.
+	 * @param Forward walking direction of the character.
+	 */
+	void HandleFootstepTrace(EFootstepType FootstepType, const FVector& TraceStart, const FVector& TraceEnd,
+		const FVector& Forward);
+
+	/** If set, HandleFootstep is ignored: footprints only come from HandleFootstepTrace, e.g. during a replay. */
+	void SetIgnoreAnimFootsteps(bool bIgnore) { bIgnoreAnimFootsteps = bIgnore; }
+
+	/** Broadcast for every footstep, before its ground trace. */
+	FOnFootstepTraceRequested OnFootstepTraceRequested;
+
+	/** Highlights the footprints inside the scan area: this component's own ones and every crowd footprint. */
 	void StartFootprintsLifecycle();
 
 private:
+
+	/** Drives the private footprint functions directly. */
+	friend class FTerrainScanBenchmark;
 	
-	TOptional<FFootprintData> CheckFootstepCollision(EFootstepType FootstepType) const;
+	/** Footstep waiting for its ground trace. */
+	struct FPendingFootstep
+	{
+		EFootstepType Type = EFootstepType::Left;
+
+		/** Walking direction of the character when the foot landed. */
+		FVector Forward = FVector::ForwardVector;
+	};
+
+	/** Stores the footprint of a traced footstep, highlighting it if inside an active scan. */
+	void PlaceFootprint(FFootprintData Footprint);
+
+	/** Ground trace below the given foot. */
+	bool GetFootstepTrace(EFootstepType FootstepType, FVector& OutTraceStart, FVector& OutTraceEnd) const;
 
 	float ComputeLifetime(bool bHighlighted) const;
 
 	UMaterialInstanceDynamic* CreateFootstepDMI(bool bRight, bool bHighlighted);
 
+	/** Frees a slot of the full store: drops the dead footprints, or else evicts the oldest live one. */
+	void MakeRoomForFootprint();
+
+	/** Removes the oldest footprint and releases its decal. */
+	void EvictOldestFootprint();
+
+	/** Drops a footprint leaving the store from the spatial hash and releases its decal. */
+	void ReleaseFootprint(int32 Slot);
+
+	/** Follows a footprint moved to another slot by the store, in the spatial hash and the highlighted slots. */
+	void MoveFootprint(int32 FromSlot, int32 ToSlot);
+
+	/** Applies a scan to one footprint, highlighting it or clearing its highlight. */
+	void UpdateFootprintHighlight(int32 Slot, bool bIsHighlighted, double CurrentTime);
+
+	void SetupFootprintInstances();
+
+	/** Matches the footprint instances to the store capacity, all hidden. */
+	void ResetFootprintInstances();
+
+	/** Queues the instance of a slot for the next UpdateFootprintInstances. */
+	void MarkFootprintInstanceDirty(int32 Slot);
+
+	/** Writes the dirty slots to their instances, in a single render state update. */
+	void UpdateFootprintInstances();
+
 	/**
 	 * Collection of all the footprints currently present in-game.
 	 */
-	TArray<FFootprintData> Footprints;
+	FFootprintStore Footprints;
+
+	/** Slots of the stored footprints by location, so that a scan only visits the footprints near its cone. */
+	FFootprintSpatialHash FootprintHash;
+
+	/**
+	 * Slots highlighted since the last scan, whose highlight the next scan may clear. Slots
+	 * reused by newer footprints are harmless, they are tested against the scan like any other.
+	 */
+	TArray<int32> HighlightedSlots;
+
+	/** Ground traces of the footsteps, delivered in footstep order. */
+	TFootstepTraceQueue<FPendingFootstep> FootstepTraces;
+
+	/** Decals of the footprints, recycled instead of spawned per step. */
+	UPROPERTY()
+	FFootprintDecalPool DecalPool;
+
+	/** Footprints of the Instanced render mode. */
+	UPROPERTY()
+	TObjectPtr<UInstancedStaticMeshComponent> FootprintInstances;
+
+	/** Slots whose footprint changed since the last instance update, indexed like the store. */
+	TBitArray<> DirtyFootprintInstances;
+
+	/** Set when any slot is dirty, the instances are updated once at the next tick. */
+	bool bFootprintInstancesDirty = false;
 
 	UPROPERTY()
 	UScannerControllerComponent* Scanner;
@@ -106,6 +242,16 @@ private:
 	UPROPERTY()
 	UScannerIconsControllerComponent* Icons;
 
+	TSharedPtr<FTerrainScanMPCBlock> MPCBlock;
+
+	UPROPERTY()
+	TObjectPtr<UFootprintCrowdSubsystem> CrowdSubsystem;
+
+	/** Crowd subsystem batch drawing the footprints of this component. */
+	int32 CrowdBatch = INDEX_NONE;
+
+	bool bIgnoreAnimFootsteps = false;
+
 private: // Decal DMIs
 
 	// Each DMI drives a different batch of footprints. All the footprints in the batch
@@ -123,5 +269,14 @@ private: // Decal DMIs
 	UPROPERTY()
 	UMaterialInstanceDynamic* RightFootstepHighlight;
 	
-	UMaterialInstanceDynamic* GetFootprintMaterial(const FFootprintData& Footprint) const;
+	UMaterialInstanceDynamic* GetFootprintMaterial(EFootprintFlags Flags) const;
 };
+
+/** Per-instance custom data floats of the Instanced render mode, see EFootprintRenderMode. */
+constexpr int32 GFootprintCustomDataFloats = 4;
+
+/** Decal rotation of a footprint on a surface, for a character walking along Forward. */
+FRotator MakeFootprintRotation(const FVector& Forward, const FVector& SurfaceNormal);
+
+/** Instance transform of a footprint in the Instanced render mode. */
+FTransform MakeFootprintInstanceTransform(const FVector& Location, const FRotator& Rotation, const FVector& DecalSize);
@@ -0,0 +1,330 @@
+﻿#include "FootprintCrowdSubsystem.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "ScannerControllerComponent.h"
+#include "ScannerIconsControllerComponent.h"
+#include "TerrainScanStats.h"
+#include <algorithm>
+
+static TAutoConsoleVariable<int32> CVarCrowdFootprintBudget(
+	TEXT("TerrainScan.CrowdFootprintBudget"),
+	4096,
+	TEXT("Maximum number of crowd footprints in the world. Footprints farthest from the camera are removed first."));
+
+
+int32 UFootprintCrowdSubsystem::RegisterBatch(UStaticMesh* Mesh, UMaterialInterface* Material, const FVector& DecalSize,
+	float RegularLifetime)
+{
+	const int32 Existing = Batches.IndexOfByPredicate([&](const FBatch& Batch)
+	{
+		return Batch.Mesh == Mesh && Batch.Material == Material && Batch.DecalSize == DecalSize
+			&& Batch.RegularLifetime == RegularLifetime;
+	});
+	if (Existing != INDEX_NONE) return Existing;
+
+	FBatch& Batch = Batches.AddDefaulted_GetRef();
+	Batch.Mesh = Mesh;
+	Batch.Material = Material;
+	Batch.DecalSize = DecalSize;
+	Batch.RegularLifetime = RegularLifetime;
+
+	// No owner: the instances are placed in world space and belong to no character.
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(this);
+	Instances->SetStaticMesh(Mesh);
+	Instances->SetMaterial(0, Material);
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Instances->SetCastShadow(false);
+	Instances->SetNumCustomDataFloats(GFootprintCustomDataFloats);
+	Instances->RegisterComponentWithWorld(GetWorld());
+	BatchInstances.Add(Instances);
+
+	return Batches.Num() - 1;
+}
+
+void UFootprintCrowdSubsystem::QueueFootstep(const FFootprintCrowdStep& Step)
+{
+	if (!Batches.IsValidIndex(Step.Batch)) return;
+
+	FootstepTraces.Request(GetWorld(), Step.TraceStart, Step.TraceEnd, Step);
+}
+
+void UFootprintCrowdSubsystem::HighlightFootprints(UScannerControllerComponent* Scanner,
+	UScannerIconsControllerComponent* Icons, float InHighlightFadeTime)
+{
+	if (!Scanner || !Icons) return;
+
+	HighlightScanner = Scanner;
+	HighlightIcons = Icons;
+	HighlightFadeTime = InHighlightFadeTime;
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	TBitArray<> InsideScanArea;
+	Scanner->IsPointsInsideScanArea(Locations, InsideScanArea);
+
+	for (int32 Index = 0; Index < Locations.Num(); ++Index)
+	{
+		const bool bWasHighlighted = EnumHasAnyFlags(Flags[Index], EFootprintFlags::Highlighted);
+		const bool bIsHighlighted = InsideScanArea[Index];
+		if (!bWasHighlighted && !bIsHighlighted) continue;
+
+		const FBatch& Batch = Batches[FootprintBatches[Index]];
+
+		if (bIsHighlighted) Flags[Index] |= EFootprintFlags::Highlighted;
+		else Flags[Index] &= ~EFootprintFlags::Highlighted;
+
+		BirthTimes[Index] = CurrentTime;
+		Lifetimes[Index] = bIsHighlighted ? ComputeHighlightedLifetime(Batch, CurrentTime) : Batch.RegularLifetime;
+		MarkInstanceDirty(Batches[FootprintBatches[Index]], FootprintInstances[Index]);
+	}
+}
+
+void UFootprintCrowdSubsystem::Tick(float DeltaTime)
+{
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_CrowdTick);
+
+	Super::Tick(DeltaTime);
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	PlaceTracedFootsteps(CurrentTime);
+	RemoveDeadFootprints(CurrentTime);
+	EnforceBudget(FMath::Max(CVarCrowdFootprintBudget.GetValueOnGameThread(), 0));
+	UpdateInstances(CurrentTime);
+}
+
+TStatId UFootprintCrowdSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UFootprintCrowdSubsystem, STATGROUP_Tickables);
+}
+
+void UFootprintCrowdSubsystem::Deinitialize()
+{
+	for (UInstancedStaticMeshComponent* Instances : BatchInstances)
+	{
+		if (Instances) Instances->DestroyComponent();
+	}
+	BatchInstances.Empty();
+	Batches.Empty();
+
+	DEC_DWORD_STAT_BY(STAT_TerrainScan_LiveFootprints, Locations.Num());
+
+	Super::Deinitialize();
+}
+
+void UFootprintCrowdSubsystem::PlaceTracedFootsteps(double CurrentTime)
+{
+	if (FootstepTraces.IsEmpty()) return;
+
+	const bool bHighlightActive = IsHighlightActive();
+
+	FootstepTraces.Poll(GetWorld(), [&](const FHitResult* Hit, const FFootprintCrowdStep& Step)
+	{
+		// Batches only go away with the subsystem, but stay safe.
+		if (!Hit || !Batches.IsValidIndex(Step.Batch)) return;
+
+		const FBatch& Batch = Batches[Step.Batch];
+
+		EFootprintFlags FootprintFlags = Step.Type == EFootstepType::Right ? EFootprintFlags::Right : EFootprintFlags::None;
+		float Lifetime = Batch.RegularLifetime;
+
+		if (bHighlightActive && HighlightScanner->IsPointInsideScanArea(Hit->Location))
+		{
+			FootprintFlags |= EFootprintFlags::Highlighted;
+			Lifetime = ComputeHighlightedLifetime(Batch, CurrentTime);
+		}
+
+		AddFootprint(Step.Batch, Hit->Location, MakeFootprintRotation(Step.Forward, Hit->Normal), FootprintFlags,
+			CurrentTime, Lifetime);
+	});
+}
+
+void UFootprintCrowdSubsystem::AddFootprint(int32 Batch, const FVector& Location, const FRotator& Rotation,
+	EFootprintFlags FootprintFlags, double BirthTime, float Lifetime)
+{
+	Locations.Add(Location);
+	Rotations.Add(Rotation);
+	BirthTimes.Add(BirthTime);
+	Lifetimes.Add(Lifetime);
+	Flags.Add(FootprintFlags);
+	FootprintBatches.Add(Batch);
+
+	const int32 Instance = Batches[Batch].InstanceFootprints.Add(Locations.Num() - 1);
+	FootprintInstances.Add(Instance);
+	MarkInstanceDirty(Batches[Batch], Instance);
+
+	INC_DWORD_STAT(STAT_TerrainScan_LiveFootprints);
+}
+
+void UFootprintCrowdSubsystem::RemoveFootprint(int32 Index)
+{
+	FBatch& Batch = Batches[FootprintBatches[Index]];
+
+	// The last instance of the batch takes the place of the removed one.
+	const int32 Instance = FootprintInstances[Index];
+	const int32 LastInstanceFootprint = Batch.InstanceFootprints.Pop(EAllowShrinking::No);
+	if (Instance < Batch.InstanceFootprints.Num())
+	{
+		Batch.InstanceFootprints[Instance] = LastInstanceFootprint;
+		FootprintInstances[LastInstanceFootprint] = Instance;
+		MarkInstanceDirty(Batch, Instance);
+	}
+
+	// The last footprint takes the place of the removed one below, its instance is unchanged.
+	const int32 LastFootprint = Locations.Num() - 1;
+	if (Index != LastFootprint)
+	{
+		Batches[FootprintBatches[LastFootprint]].InstanceFootprints[FootprintInstances[LastFootprint]] = Index;
+	}
+
+	Locations.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Rotations.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	BirthTimes.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Lifetimes.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Flags.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	FootprintBatches.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	FootprintInstances.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+
+	DEC_DWORD_STAT(STAT_TerrainScan_LiveFootprints);
+}
+
+void UFootprintCrowdSubsystem::MarkInstanceDirty(FBatch& Batch, int32 Instance)
+{
+	if (Instance >= Batch.DirtyInstances.Num())
+	{
+		Batch.DirtyInstances.Add(false, Instance + 1 - Batch.DirtyInstances.Num());
+	}
+
+	Batch.DirtyInstances[Instance] = true;
+	Batch.bDirty = true;
+}
+
+void UFootprintCrowdSubsystem::RemoveDeadFootprints(double CurrentTime)
+{
+	// Backwards, so that swapped-in footprints were already visited.
+	for (int32 Index = Locations.Num() - 1; Index >= 0; --Index)
+	{
+		if (CurrentTime >= BirthTimes[Index] + Lifetimes[Index])
+		{
+			RemoveFootprint(Index);
+		}
+	}
+}
+
+void UFootprintCrowdSubsystem::EnforceBudget(int32 Budget)
+{
+	const int32 NumExcess = Locations.Num() - Budget;
+	if (NumExcess <= 0) return;
+
+	// Without a camera every footprint is equally far: the excess is removed arbitrarily.
+	FVector CameraLocation = FVector::ZeroVector;
+	if (const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController())
+	{
+		if (PlayerController->PlayerCameraManager)
+		{
+			CameraLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+		}
+	}
+
+	TArray<TPair<double, int32>> Distances;
+	Distances.Reserve(Locations.Num());
+	for (int32 Index = 0; Index < Locations.Num(); ++Index)
+	{
+		Distances.Emplace(FVector::DistSquared(Locations[Index], CameraLocation), Index);
+	}
+
+	// Only the farthest NumExcess need to be found, not sorted.
+	std::nth_element(Distances.GetData(), Distances.GetData() + NumExcess, Distances.GetData() + Distances.Num(),
+		[](const TPair<double, int32>& A, const TPair<double, int32>& B) { return A.Key > B.Key; });
+
+	TArray<int32> Evicted;
+	Evicted.Reserve(NumExcess);
+	for (int32 Rank = 0; Rank < NumExcess; ++Rank)
+	{
+		Evicted.Add(Distances[Rank].Value);
+	}
+
+	// Highest indices first, so that swap-removals never move a footprint still to be removed.
+	Evicted.Sort(TGreater<int32>());
+	for (int32 Index : Evicted)
+	{
+		RemoveFootprint(Index);
+	}
+}
+
+void UFootprintCrowdSubsystem::UpdateInstances(double CurrentTime)
+{
+	for (int32 BatchIndex = 0; BatchIndex < Batches.Num(); ++BatchIndex)
+	{
+		FBatch& Batch = Batches[BatchIndex];
+		UInstancedStaticMeshComponent* Instances = BatchInstances[BatchIndex];
+		if (!Batch.bDirty || !Instances) continue;
+
+		Batch.bDirty = false;
+
+		const int32 NumFootprints = Batch.InstanceFootprints.Num();
+		const int32 NumInstances = Instances->GetInstanceCount();
+
+		if (NumInstances > NumFootprints)
+		{
+			// Only the trailing instances go, highest first: no instance moves, whatever the removal mode.
+			TArray<int32> Removed;
+			Removed.Reserve(NumInstances - NumFootprints);
+			for (int32 Instance = NumInstances - 1; Instance >= NumFootprints; --Instance)
+			{
+				Removed.Add(Instance);
+			}
+			Instances->RemoveInstances(Removed);
+		}
+		else if (NumInstances < NumFootprints)
+		{
+			// Placeholders, new instances are dirty and written below.
+			TArray<FTransform> Added;
+			Added.SetNum(NumFootprints - NumInstances);
+			Instances->AddInstances(Added, false, true);
+		}
+
+		// Same single render state update as UFootprintControllerComponent::UpdateFootprintInstances.
+		for (TConstSetBitIterator<> It(Batch.DirtyInstances); It && It.GetIndex() < NumFootprints; ++It)
+		{
+			const int32 Instance = It.GetIndex();
+			const int32 Index = Batch.InstanceFootprints[Instance];
+
+			Instances->UpdateInstanceTransform(Instance,
+				MakeFootprintInstanceTransform(Locations[Index], Rotations[Index], Batch.DecalSize), true, false, true);
+
+			const float CustomData[GFootprintCustomDataFloats] = {
+				EnumHasAnyFlags(Flags[Index], EFootprintFlags::Right) ? 1.0f : 0.0f,
+				EnumHasAnyFlags(Flags[Index], EFootprintFlags::Highlighted) ? 1.0f : 0.0f,
+				static_cast<float>(BirthTimes[Index]),
+				Lifetimes[Index]
+			};
+			Instances->SetCustomData(Instance, CustomData, false);
+		}
+
+		Batch.DirtyInstances.SetRange(0, Batch.DirtyInstances.Num(), false);
+
+		Instances->MarkRenderStateDirty();
+	}
+}
+
+float UFootprintCrowdSubsystem::ComputeHighlightedLifetime(const FBatch& Batch, double CurrentTime) const
+{
+	// Same as UFootprintControllerComponent::ComputeLifetime.
+	float Lifetime = Batch.RegularLifetime + HighlightFadeTime;
+
+	if (HighlightScanner.IsValid() && HighlightIcons.IsValid())
+	{
+		const double ElapsedTime = CurrentTime - HighlightScanner->GetCurrentFrameScannerState().StartTime;
+		Lifetime += FMath::Max(0.f, HighlightIcons->TotalEffectDuration() - ElapsedTime);
+	}
+
+	return Lifetime;
+}
+
+bool UFootprintCrowdSubsystem::IsHighlightActive() const
+{
+	return HighlightScanner.IsValid() && HighlightIcons.IsValid() && HighlightIcons->IsEffectActive();
+}
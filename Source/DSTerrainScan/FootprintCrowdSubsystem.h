@@ -0,0 +1,146 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "FootprintControllerComponent.h"
+#include "FootprintCrowdSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UScannerControllerComponent;
+class UScannerIconsControllerComponent;
+
+
+/** Footstep of a crowd character, waiting for its ground trace. */
+struct FFootprintCrowdStep
+{
+	/** See UFootprintCrowdSubsystem::RegisterBatch. */
+	int32 Batch = INDEX_NONE;
+
+	EFootstepType Type = EFootstepType::Left;
+
+	FVector TraceStart = FVector::ZeroVector;
+
+	FVector TraceEnd = FVector::ZeroVector;
+
+	/** Walking direction of the character. */
+	FVector Forward = FVector::ForwardVector;
+};
+
+
+/**
+ *	Owns the footprints of every crowd character of the world (see UFootprintControllerComponent::
+ *	bUseCrowdSubsystem). Footsteps are queued by the characters and traced asynchronously, in one batch per frame.
+ *	Footprints live in a single store capped by TerrainScan.CrowdFootprintBudget: over budget, the
+ *	ones farthest from the camera are removed first. Footprints sharing mesh, material and size are
+ *	drawn by one instanced mesh, where only the instances of changed footprints are rewritten, at
+ *	most once per frame.
+ */
+UCLASS()
+class DSTERRAINSCAN_API UFootprintCrowdSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Returns the batch drawing footprints with the given settings, creating it on first request.
+	 * @param RegularLifetime lifetime of a footprint that is not highlighted, fade included.
+	 */
+	int32 RegisterBatch(UStaticMesh* Mesh, UMaterialInterface* Material, const FVector& DecalSize, float RegularLifetime);
+
+	/** Requests the ground trace of a footstep, its footprint is placed when the result arrives at the next tick. */
+	void QueueFootstep(const FFootprintCrowdStep& Step);
+
+	/**
+	 * Highlights the footprints inside the scan area, restarting their lifetime. Footprints placed
+	 * while the scan effect is active are highlighted as well.
+	 */
+	void HighlightFootprints(UScannerControllerComponent* Scanner, UScannerIconsControllerComponent* Icons,
+		float HighlightFadeTime);
+
+	int32 GetNumFootprints() const { return Locations.Num(); }
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	struct FBatch
+	{
+		/** Kept alive by the instanced mesh. */
+		TWeakObjectPtr<UStaticMesh> Mesh;
+
+		TWeakObjectPtr<UMaterialInterface> Material;
+
+		FVector DecalSize = FVector::OneVector;
+
+		float RegularLifetime = 0.0f;
+
+		/** Footprint index of every instance, densely packed: removals swap the last instance in, as the store does. */
+		TArray<int32> InstanceFootprints;
+
+		/** Instances to rewrite at the next update. */
+		TBitArray<> DirtyInstances;
+
+		bool bDirty = false;
+	};
+
+	/** Places the footprints of the completed footstep traces. */
+	void PlaceTracedFootsteps(double CurrentTime);
+
+	void AddFootprint(int32 Batch, const FVector& Location, const FRotator& Rotation, EFootprintFlags Flags,
+		double BirthTime, float Lifetime);
+
+	/** Swap-removes the footprint, and its instance from its batch. */
+	void RemoveFootprint(int32 Index);
+
+	void MarkInstanceDirty(FBatch& Batch, int32 Instance);
+
+	void RemoveDeadFootprints(double CurrentTime);
+
+	/** Removes the footprints farthest from the camera until the budget is met. */
+	void EnforceBudget(int32 Budget);
+
+	void UpdateInstances(double CurrentTime);
+
+	/** Lifetime of a footprint highlighted now. */
+	float ComputeHighlightedLifetime(const FBatch& Batch, double CurrentTime) const;
+
+	bool IsHighlightActive() const;
+
+	TArray<FBatch> Batches;
+
+	/** Instanced meshes of the batches, same indices. */
+	UPROPERTY()
+	TArray<TObjectPtr<UInstancedStaticMeshComponent>> BatchInstances;
+
+	TFootstepTraceQueue<FFootprintCrowdStep> FootstepTraces;
+
+	/* Footprints, densely packed in no particular order. */
+
+	TArray<FVector> Locations;
+
+	TArray<FRotator> Rotations;
+
+	TArray<double> BirthTimes;
+
+	TArray<float> Lifetimes;
+
+	TArray<EFootprintFlags> Flags;
+
+	TArray<int32> FootprintBatches;
+
+	/** Instance of the footprint in its batch. */
+	TArray<int32> FootprintInstances;
+
+	/* Last scan, for footprints placed while its effect is active. */
+
+	TWeakObjectPtr<UScannerControllerComponent> HighlightScanner;
+
+	TWeakObjectPtr<UScannerIconsControllerComponent> HighlightIcons;
+
+	float HighlightFadeTime = 0.0f;
+};
@@ -0,0 +1,114 @@
+﻿#include "FootprintDecalPool.h"
+#include "Components/DecalComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "TerrainScanStats.h"
+
+FFootprintDecalPool::~FFootprintDecalPool()
+{
+	// The decals themselves go away with the pool actor, see Shutdown.
+	DEC_DWORD_STAT_BY(STAT_TerrainScan_DecalPoolSize, AllDecals.Num());
+}
+
+void FFootprintDecalPool::Initialize(UWorld* World, int32 NumDecals, const FVector& InDecalSize)
+{
+	DecalSize = InDecalSize;
+
+	if (!World) return;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	Owner = World->SpawnActor<AActor>(SpawnParameters);
+
+	if (!Owner) return;
+
+	AllDecals.Reserve(NumDecals);
+	FreeDecals.Reserve(NumDecals);
+
+	while (AllDecals.Num() < NumDecals)
+	{
+		FreeDecals.Add(CreateDecal());
+	}
+}
+
+UDecalComponent* FFootprintDecalPool::CreateDecal()
+{
+	UDecalComponent* Decal = NewObject<UDecalComponent>(Owner);
+	Decal->DecalSize = DecalSize;
+
+	// Placed in world space, never follows the owner.
+	Decal->SetUsingAbsoluteLocation(true);
+	Decal->SetUsingAbsoluteRotation(true);
+	Decal->SetUsingAbsoluteScale(true);
+	Decal->SetVisibility(false);
+	Decal->RegisterComponent();
+
+	AllDecals.Add(Decal);
+	INC_DWORD_STAT(STAT_TerrainScan_DecalPoolAllocations);
+	INC_DWORD_STAT(STAT_TerrainScan_DecalPoolSize);
+
+	return Decal;
+}
+
+UDecalComponent* FFootprintDecalPool::Acquire(UMaterialInterface* Material, const FVector& Location,
+	const FRotator& Rotation, float Lifetime, float FadeTime)
+{
+	if (!Owner) return nullptr;
+
+	UDecalComponent* Decal = nullptr;
+
+	if (FreeDecals.Num() > 0)
+	{
+		Decal = FreeDecals.Pop(EAllowShrinking::No);
+		++NumHits;
+		INC_DWORD_STAT(STAT_TerrainScan_DecalPoolHits);
+	}
+	else
+	{
+		Decal = CreateDecal();
+		++NumMisses;
+		INC_DWORD_STAT(STAT_TerrainScan_DecalPoolMisses);
+	}
+
+	HighWaterMark = FMath::Max(HighWaterMark, AllDecals.Num() - FreeDecals.Num());
+
+	Decal->SetWorldLocationAndRotation(Location, Rotation);
+	Decal->SetDecalMaterial(Material);
+
+	RestartFade(Decal, Lifetime, FadeTime);
+	Decal->SetVisibility(true);
+
+	return Decal;
+}
+
+void FFootprintDecalPool::RestartFade(UDecalComponent* Decal, float Lifetime, float FadeTime)
+{
+	// Restarts the fade, which is timed from the render state creation.
+	Decal->SetFadeOut(Lifetime - FadeTime, FadeTime, false);
+
+	// SetFadeOut also arms the lifespan timer, which would destroy the component at the end of the fade.
+	Decal->SetLifeSpan(0.0f);
+}
+
+void FFootprintDecalPool::Release(UDecalComponent* Decal)
+{
+	if (!Decal) return;
+
+	Decal->SetVisibility(false);
+	FreeDecals.Add(Decal);
+}
+
+void FFootprintDecalPool::Shutdown(float Delay)
+{
+	if (IsValid(Owner))
+	{
+		if (Delay > 0.0f) Owner->SetLifeSpan(Delay);
+		else Owner->Destroy();
+	}
+
+	DEC_DWORD_STAT_BY(STAT_TerrainScan_DecalPoolSize, AllDecals.Num());
+
+	Owner = nullptr;
+	AllDecals.Reset();
+	FreeDecals.Reset();
+}
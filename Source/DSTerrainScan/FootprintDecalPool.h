@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "FootprintDecalPool.generated.h"
+
+class UDecalComponent;
+class UMaterialInterface;
+
+
+/**
+ *	Recycled footprint decals. Decal components are created once on an actor of the pool and
+ *	repositioned on every step, instead of spawning a decal actor per footprint and destroying
+ *	it on eviction. Released decals are hidden until acquired again. The pool actor belongs to
+ *	the world, not to the character leaving the footprints, which may go away before them.
+ */
+USTRUCT()
+struct DSTERRAINSCAN_API FFootprintDecalPool
+{
+	GENERATED_BODY()
+
+	~FFootprintDecalPool();
+
+	/**
+	 * Spawns the pool actor and creates the first decals.
+	 * @param World world the decals are placed in.
+	 * @param NumDecals decals to preallocate, usually the maximum number of footprints.
+	 * @param InDecalSize size of every decal.
+	 */
+	void Initialize(UWorld* World, int32 NumDecals, const FVector& InDecalSize);
+
+	/**
+	 * Empties the pool, leaving its decals in the world for Delay more seconds: the pool actor
+	 * destroys itself, and every decal with it, once they are faded out.
+	 */
+	void Shutdown(float Delay);
+
+	/**
+	 * Places a free decal, creating one if none is left.
+	 * @param Lifetime seconds before the decal is fully faded out.
+	 * @param FadeTime fade out duration, at the end of the lifetime.
+	 */
+	UDecalComponent* Acquire(UMaterialInterface* Material, const FVector& Location, const FRotator& Rotation,
+		float Lifetime, float FadeTime);
+
+	/** Hides the decal and makes it available again. */
+	void Release(UDecalComponent* Decal);
+
+	/**
+	 * Restarts the fade out of a pooled decal. Unlike UDecalComponent::SetFadeOut, the decal is
+	 * not destroyed at the end of the fade: it stays in the pool until released.
+	 */
+	static void RestartFade(UDecalComponent* Decal, float Lifetime, float FadeTime);
+
+	/** Acquisitions served by a free decal. */
+	int32 GetNumHits() const { return NumHits; }
+
+	/** Acquisitions that had to create a decal. */
+	int32 GetNumMisses() const { return NumMisses; }
+
+	/** Maximum number of decals in use at once. */
+	int32 GetHighWaterMark() const { return HighWaterMark; }
+
+	int32 GetNumAllocated() const { return AllDecals.Num(); }
+
+private:
+
+	UDecalComponent* CreateDecal();
+
+	/** Spawned by Initialize, owns the decal components. */
+	UPROPERTY()
+	TObjectPtr<AActor> Owner;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UDecalComponent>> AllDecals;
+
+	UPROPERTY()
+	TArray<TObjectPtr<UDecalComponent>> FreeDecals;
+
+	FVector DecalSize = FVector::OneVector;
+
+	int32 NumHits = 0;
+
+	int32 NumMisses = 0;
+
+	int32 HighWaterMark = 0;
+};
@@ -0,0 +1,72 @@
+﻿#include "FootprintSpatialHash.h"
+
+FFootprintSpatialHash::FFootprintSpatialHash(float InCellSize)
+	: CellSize(FMath::Max(InCellSize, 1.0f))
+{
+}
+
+void FFootprintSpatialHash::Add(int32 Id, const FVector& Location)
+{
+	Cells.FindOrAdd(GetCell(FVector2D{Location})).Add(Id);
+	++NumIds;
+}
+
+void FFootprintSpatialHash::Remove(int32 Id, const FVector& Location)
+{
+	const FIntPoint Cell = GetCell(FVector2D{Location});
+
+	TArray<int32>* Ids = Cells.Find(Cell);
+	if (!Ids || Ids->RemoveSingleSwap(Id, EAllowShrinking::No) == 0) return;
+
+	--NumIds;
+
+	// Footprints trail across the whole map, do not keep the cells they left behind.
+	if (Ids->IsEmpty())
+	{
+		Cells.Remove(Cell);
+	}
+}
+
+void FFootprintSpatialHash::Empty()
+{
+	Cells.Empty();
+	NumIds = 0;
+}
+
+void FFootprintSpatialHash::Query(const FBox2D& Bounds, TArray<int32>& OutIds) const
+{
+	if (!Bounds.bIsValid || Cells.IsEmpty()) return;
+
+	const FIntPoint MinCell = GetCell(Bounds.Min);
+	const FIntPoint MaxCell = GetCell(Bounds.Max);
+	const int64 NumQueryCells = int64(MaxCell.X - MinCell.X + 1) * int64(MaxCell.Y - MinCell.Y + 1);
+
+	// Boxes larger than the occupied area are cheaper to answer from the stored cells.
+	if (NumQueryCells > Cells.Num())
+	{
+		for (const TPair<FIntPoint, TArray<int32>>& Cell : Cells)
+		{
+			if (Cell.Key.X >= MinCell.X && Cell.Key.X <= MaxCell.X && Cell.Key.Y >= MinCell.Y && Cell.Key.Y <= MaxCell.Y)
+			{
+				OutIds.Append(Cell.Value);
+			}
+		}
+		return;
+	}
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			if (const TArray<int32>* Ids = Cells.Find(FIntPoint{X, Y}))
+			{
+				OutIds.Append(*Ids);
+			}
+		}
+	}
+}
+
+FIntPoint FFootprintSpatialHash::GetCell(const FVector2D& Location) const
+{
+	return FIntPoint{FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize)};
+}
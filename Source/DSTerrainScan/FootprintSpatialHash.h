@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+ *	Uniform 2D grid over the XY plane, mapping cells to the ids of the points inside them. Only
+ *	non-empty cells are stored, so the grid is unbounded. Queries return every id of the cells
+ *	overlapping a box: a superset of the points inside it, to be tested exactly by the caller.
+ */
+class DSTERRAINSCAN_API FFootprintSpatialHash
+{
+public:
+
+	explicit FFootprintSpatialHash(float InCellSize = 500.0f);
+
+	/** Inserts an id at a location. An id must be inserted once. */
+	void Add(int32 Id, const FVector& Location);
+
+	/** Removes an id, Location must be the one it was inserted with. */
+	void Remove(int32 Id, const FVector& Location);
+
+	void Empty();
+
+	/** Appends to OutIds the ids of every cell overlapping Bounds. */
+	void Query(const FBox2D& Bounds, TArray<int32>& OutIds) const;
+
+	int32 Num() const { return NumIds; }
+
+	float GetCellSize() const { return CellSize; }
+
+private:
+
+	FIntPoint GetCell(const FVector2D& Location) const;
+
+	float CellSize;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	int32 NumIds = 0;
+};
@@ -0,0 +1,118 @@
+﻿#include "FootprintStore.h"
+#include "Components/DecalComponent.h"
+#include "TerrainScanStats.h"
+
+FFootprintStore::FFootprintStore(int32 InCapacity)
+{
+	SetCapacity(InCapacity);
+}
+
+FFootprintStore::~FFootprintStore()
+{
+	DEC_DWORD_STAT_BY(STAT_TerrainScan_LiveFootprints, Count);
+	DEC_MEMORY_STAT_BY(STAT_TerrainScan_FootprintMemory, AllocatedBytes);
+}
+
+void FFootprintStore::SetCapacity(int32 InCapacity)
+{
+	DEC_DWORD_STAT_BY(STAT_TerrainScan_LiveFootprints, Count);
+
+	Capacity = FMath::Max(InCapacity, 0);
+	Head = 0;
+	Count = 0;
+
+	Locations.SetNumUninitialized(Capacity);
+	Rotations.SetNumUninitialized(Capacity);
+	BirthTimes.SetNumUninitialized(Capacity);
+	Lifetimes.SetNumUninitialized(Capacity);
+	Flags.SetNumZeroed(Capacity);
+
+	Decals.Reset();
+	Decals.SetNum(Capacity);
+
+	DEC_MEMORY_STAT_BY(STAT_TerrainScan_FootprintMemory, AllocatedBytes);
+	AllocatedBytes = Locations.GetAllocatedSize() + Rotations.GetAllocatedSize() + BirthTimes.GetAllocatedSize()
+		+ Lifetimes.GetAllocatedSize() + Flags.GetAllocatedSize() + Decals.GetAllocatedSize();
+	INC_MEMORY_STAT_BY(STAT_TerrainScan_FootprintMemory, AllocatedBytes);
+}
+
+int32 FFootprintStore::Add(const FVector& Location, const FRotator& Rotation, EFootprintFlags InFlags, double BirthTime,
+	float Lifetime)
+{
+	check(!IsFull());
+
+	const int32 Slot = GetSlot(Count++);
+	INC_DWORD_STAT(STAT_TerrainScan_LiveFootprints);
+
+	Locations[Slot] = Location;
+	Rotations[Slot] = Rotation;
+	BirthTimes[Slot] = BirthTime;
+	Lifetimes[Slot] = Lifetime;
+	Flags[Slot] = InFlags;
+	Decals[Slot] = nullptr;
+
+	return Slot;
+}
+
+void FFootprintStore::PopOldest()
+{
+	check(!IsEmpty());
+
+	Decals[Head] = nullptr;
+
+	Head = GetSlot(1);
+	--Count;
+	DEC_DWORD_STAT(STAT_TerrainScan_LiveFootprints);
+}
+
+int32 FFootprintStore::ExpireOldest(double Time, TFunctionRef<void(int32 Slot)> OnExpired)
+{
+	int32 NumExpired = 0;
+
+	while (Count > 0 && !IsAlive(Head, Time))
+	{
+		OnExpired(Head);
+		PopOldest();
+		++NumExpired;
+	}
+
+	return NumExpired;
+}
+
+int32 FFootprintStore::RemoveDead(double Time, TFunctionRef<void(int32 Slot)> OnExpired,
+	TFunctionRef<void(int32 FromSlot, int32 ToSlot)> OnMoved)
+{
+	// Live footprints are written back at NumLive, which never passes the one being read.
+	int32 NumLive = 0;
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const int32 Slot = GetSlot(Index);
+
+		if (!IsAlive(Slot, Time))
+		{
+			OnExpired(Slot);
+			Decals[Slot] = nullptr;
+			continue;
+		}
+
+		const int32 NewSlot = GetSlot(NumLive++);
+		if (NewSlot == Slot) continue;
+
+		OnMoved(Slot, NewSlot);
+
+		Locations[NewSlot] = Locations[Slot];
+		Rotations[NewSlot] = Rotations[Slot];
+		BirthTimes[NewSlot] = BirthTimes[Slot];
+		Lifetimes[NewSlot] = Lifetimes[Slot];
+		Flags[NewSlot] = Flags[Slot];
+		Decals[NewSlot] = MoveTemp(Decals[Slot]);
+		Decals[Slot] = nullptr;
+	}
+
+	const int32 NumRemoved = Count - NumLive;
+	Count = NumLive;
+	DEC_DWORD_STAT_BY(STAT_TerrainScan_LiveFootprints, NumRemoved);
+
+	return NumRemoved;
+}
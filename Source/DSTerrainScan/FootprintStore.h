@@ -0,0 +1,119 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UDecalComponent;
+
+
+enum class EFootprintFlags : uint8
+{
+	None = 0,
+
+	/** Right foot, left otherwise. */
+	Right = 1 << 0,
+
+	Highlighted = 1 << 1
+};
+ENUM_CLASS_FLAGS(EFootprintFlags);
+
+
+/**
+ *	Fixed-capacity ring buffer of footprints, in insertion order, stored as separate arrays
+ *	per field. Footprints keep their birth time instead of an age, so nothing is updated
+ *	per frame: expiry only advances the oldest cursor. Adding to a full store is up to the
+ *	caller, which removes the dead footprints first, see RemoveDead(), and only then evicts
+ *	the oldest live one.
+ */
+class DSTERRAINSCAN_API FFootprintStore
+{
+public:
+
+	explicit FFootprintStore(int32 InCapacity = 0);
+
+	~FFootprintStore();
+
+	/** Resizes the store, dropping every footprint. */
+	void SetCapacity(int32 InCapacity);
+
+	int32 GetCapacity() const { return Capacity; }
+
+	/** Number of stored footprints. Some may be dead already, see IsAlive(). */
+	int32 Num() const { return Count; }
+
+	bool IsEmpty() const { return Count == 0; }
+
+	bool IsFull() const { return Count == Capacity; }
+
+	/** Storage slot of the Index-th oldest footprint. */
+	int32 GetSlot(int32 Index) const
+	{
+		const int32 Slot = Head + Index;
+		return Slot < Capacity ? Slot : Slot - Capacity;
+	}
+
+	int32 GetOldestSlot() const { return Head; }
+
+	/** Whether a slot holds a footprint, alive or not. */
+	bool IsStored(int32 Slot) const
+	{
+		const int32 Index = Slot >= Head ? Slot - Head : Slot + Capacity - Head;
+		return Index < Count;
+	}
+
+	/**
+	 * Appends a footprint. The store must not be full.
+	 * @return slot of the new footprint.
+	 */
+	int32 Add(const FVector& Location, const FRotator& Rotation, EFootprintFlags Flags, double BirthTime, float Lifetime);
+
+	/** Removes the oldest footprint. */
+	void PopOldest();
+
+	bool IsAlive(int32 Slot, double Time) const { return Time < BirthTimes[Slot] + Lifetimes[Slot]; }
+
+	/**
+	 * Drops the dead footprints at the oldest end, in O(1) per footprint. Footprints dying out of
+	 * order, e.g. regular ones behind highlighted ones, stay stored until they reach it.
+	 * @param OnExpired called with the slot of every dropped footprint, before it is dropped.
+	 * @return number of dropped footprints.
+	 */
+	int32 ExpireOldest(double Time, TFunctionRef<void(int32 Slot)> OnExpired);
+
+	/**
+	 * Drops every dead footprint, wherever it is, in O(Num()). The live footprints behind the
+	 * first dead one move towards the oldest end, keeping their insertion order.
+	 * @param OnExpired called with the slot of every dropped footprint, before it is dropped.
+	 * @param OnMoved called with the old and new slot of every moved footprint, before it moves.
+	 * @return number of dropped footprints.
+	 */
+	int32 RemoveDead(double Time, TFunctionRef<void(int32 Slot)> OnExpired,
+		TFunctionRef<void(int32 FromSlot, int32 ToSlot)> OnMoved);
+
+	/* Footprint data, indexed by slot. */
+
+	TArray<FVector> Locations;
+
+	TArray<FRotator> Rotations;
+
+	/** World time the footprint was placed, or last highlighted by a scan. */
+	TArray<double> BirthTimes;
+
+	/** Footprint dies once the world time reaches BirthTime + Lifetime. */
+	TArray<float> Lifetimes;
+
+	TArray<EFootprintFlags> Flags;
+
+	TArray<TWeakObjectPtr<UDecalComponent>> Decals;
+
+private:
+
+	int32 Capacity = 0;
+
+	/** Slot of the oldest footprint. */
+	int32 Head = 0;
+
+	int32 Count = 0;
+
+	/** Reported in stat TerrainScan. */
+	int64 AllocatedBytes = 0;
+};
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/World.h"
+#include "TerrainScanStats.h"
+
+
+/**
+ *	Asynchronous footstep ground traces. Requests go through UWorld::AsyncLineTraceByChannel, so
+ *	every trace of a frame runs in the same batch, off the game thread, and the results are read
+ *	on the next frame. Results are delivered in request order: a trace that is not ready yet holds
+ *	back the later ones, so footprints are stored (and evicted) in footstep order.
+ */
+template<typename PayloadType>
+class TFootstepTraceQueue
+{
+public:
+
+	/** Queues a ground trace. The payload is handed back with the result. */
+	void Request(UWorld* World, const FVector& TraceStart, const FVector& TraceEnd, const PayloadType& Payload)
+	{
+		static const FCollisionQueryParams QueryParams{SCENE_QUERY_STAT(FootstepTrace)};
+
+		FPendingTrace& Pending = PendingTraces.AddDefaulted_GetRef();
+		Pending.Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, TraceStart, TraceEnd, ECC_Visibility,
+			QueryParams);
+		Pending.RequestTime = FPlatformTime::Seconds();
+		Pending.Payload = Payload;
+
+		INC_DWORD_STAT(STAT_TerrainScan_FootstepTraces);
+	}
+
+	/**
+	 * Delivers the completed traces, oldest first.
+	 * @param OnResult called as OnResult(const FHitResult* Hit, const PayloadType& Payload), Hit is null if nothing was hit.
+	 */
+	template<typename FunctorType>
+	void Poll(UWorld* World, FunctorType&& OnResult)
+	{
+		int32 NumDone = 0;
+
+		for (; NumDone < PendingTraces.Num(); ++NumDone)
+		{
+			const FPendingTrace& Pending = PendingTraces[NumDone];
+
+			FTraceDatum Datum;
+			if (!World->QueryTraceData(Pending.Handle, Datum))
+			{
+				// Not done yet: keep it and every later request for the next poll.
+				if (World->IsTraceHandleValid(Pending.Handle, false)) break;
+
+				// Results are only kept for a frame, and were missed.
+				INC_DWORD_STAT(STAT_TerrainScan_FootstepTracesDropped);
+				continue;
+			}
+
+			SET_FLOAT_STAT(STAT_TerrainScan_FootstepTraceLatency, (FPlatformTime::Seconds() - Pending.RequestTime) * 1000.0);
+
+			const FHitResult* Hit = Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit ? &Datum.OutHits[0] : nullptr;
+			OnResult(Hit, Pending.Payload);
+		}
+
+		PendingTraces.RemoveAt(0, NumDone, EAllowShrinking::No);
+	}
+
+	bool IsEmpty() const { return PendingTraces.IsEmpty(); }
+
+private:
+
+	struct FPendingTrace
+	{
+		FTraceHandle Handle;
+
+		double RequestTime = 0.0;
+
+		PayloadType Payload;
+	};
+
+	TArray<FPendingTrace> PendingTraces;
+};
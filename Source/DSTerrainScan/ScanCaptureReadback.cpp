@@ -0,0 +1,388 @@
+﻿#include "ScanCaptureReadback.h"
+#include "Async/Async.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "RHIGPUReadback.h"
+#include "RenderingThread.h"
+#include "TextureResource.h"
+#include "TerrainScanStats.h"
+
+namespace
+{
+	enum class ESlotStatus : uint8
+	{
+		Free,
+
+		/** Requested on the game thread, copy not yet queued on the render thread. */
+		Copying,
+
+		/** Copy queued, waiting for the GPU. */
+		Requested,
+
+		/** Read back, waiting for delivery on the game thread. */
+		Completing
+	};
+
+	double ToMilliseconds(double Seconds) { return Seconds * 1000.0; }
+
+	void ConvertPixels(const uint8* Data, int32 RowPitchInPixels, EPixelFormat Format, FIntPoint Size,
+		FScanCaptureImage& OutImage)
+	{
+		OutImage.Width = Size.X;
+		OutImage.Height = Size.Y;
+		OutImage.Pixels.SetNumZeroed(Size.X * Size.Y);
+
+		for (int32 Y = 0; Y < Size.Y; ++Y)
+		{
+			FLinearColor* OutRow = &OutImage.Pixels[Y * Size.X];
+
+			switch (Format)
+			{
+				case PF_FloatRGBA:
+				{
+					const FFloat16Color* Row = reinterpret_cast<const FFloat16Color*>(Data) + Y * RowPitchInPixels;
+					for (int32 X = 0; X < Size.X; ++X) OutRow[X] = FLinearColor{Row[X]};
+					break;
+				}
+
+				case PF_A32B32G32R32F:
+				{
+					const FLinearColor* Row = reinterpret_cast<const FLinearColor*>(Data) + Y * RowPitchInPixels;
+					FMemory::Memcpy(OutRow, Row, Size.X * sizeof(FLinearColor));
+					break;
+				}
+
+				case PF_B8G8R8A8:
+				{
+					// Raw values: ID captures encode integers, not colors.
+					const FColor* Row = reinterpret_cast<const FColor*>(Data) + Y * RowPitchInPixels;
+					for (int32 X = 0; X < Size.X; ++X) OutRow[X] = Row[X].ReinterpretAsLinear();
+					break;
+				}
+
+				case PF_R32_FLOAT:
+				{
+					const float* Row = reinterpret_cast<const float*>(Data) + Y * RowPitchInPixels;
+					for (int32 X = 0; X < Size.X; ++X) OutRow[X] = FLinearColor{Row[X], 0.0f, 0.0f, 1.0f};
+					break;
+				}
+
+				case PF_R16F:
+				{
+					const FFloat16* Row = reinterpret_cast<const FFloat16*>(Data) + Y * RowPitchInPixels;
+					for (int32 X = 0; X < Size.X; ++X) OutRow[X] = FLinearColor{Row[X].GetFloat(), 0.0f, 0.0f, 1.0f};
+					break;
+				}
+
+				default:
+					UE_LOG(LogTemp, Warning, TEXT("Scan capture readback: unsupported pixel format %s."),
+						GetPixelFormatString(Format));
+					return;
+			}
+		}
+	}
+
+	/** Inverse of ConvertPixels for one pixel. @return false if the format is not supported. */
+	bool EncodePixel(const FLinearColor& Color, EPixelFormat Format, uint8* OutPixel)
+	{
+		switch (Format)
+		{
+			case PF_FloatRGBA:
+				*reinterpret_cast<FFloat16Color*>(OutPixel) = FFloat16Color{Color};
+				return true;
+
+			case PF_A32B32G32R32F:
+				*reinterpret_cast<FLinearColor*>(OutPixel) = Color;
+				return true;
+
+			case PF_B8G8R8A8:
+				// Raw values, as read back.
+				*reinterpret_cast<FColor*>(OutPixel) = Color.QuantizeRound();
+				return true;
+
+			case PF_R32_FLOAT:
+				*reinterpret_cast<float*>(OutPixel) = Color.R;
+				return true;
+
+			case PF_R16F:
+				*reinterpret_cast<FFloat16*>(OutPixel) = FFloat16{Color.R};
+				return true;
+
+			default:
+				return false;
+		}
+	}
+}
+
+const FLinearColor& FScanCaptureImage::Sample(float U, float V) const
+{
+	const int32 X = FMath::Clamp(FMath::FloorToInt32(U * Width), 0, Width - 1);
+	const int32 Y = FMath::Clamp(FMath::FloorToInt32(V * Height), 0, Height - 1);
+	return Pixels[Y * Width + X];
+}
+
+
+struct FScanCaptureReadback::FRingState
+{
+	struct FSlot
+	{
+		std::atomic<ESlotStatus> Status{ESlotStatus::Free};
+
+		/** Set if no readback is possible, e.g. under the null RHI. */
+		bool bStub = false;
+
+		TUniquePtr<FRHIGPUTextureReadback> Readbacks[NumTargets];
+
+		/** Written on the render thread when the copy is queued. */
+		EPixelFormat Formats[NumTargets] = {};
+
+		FIntPoint Sizes[NumTargets] = {};
+
+		FScanCaptureFrame Metadata;
+	};
+
+	TArray<TUniquePtr<FSlot>> Slots;
+
+	FOnScanCaptureReadback OnReadback;
+};
+
+
+FScanCaptureReadback::FScanCaptureReadback(int32 RingSize)
+	: State(MakeShared<FRingState, ESPMode::ThreadSafe>())
+{
+	for (int32 SlotIndex = 0; SlotIndex < FMath::Max(RingSize, 1); ++SlotIndex)
+	{
+		TUniquePtr<FRingState::FSlot>& Slot = State->Slots.Add_GetRef(MakeUnique<FRingState::FSlot>());
+
+		for (int32 Target = 0; Target < NumTargets; ++Target)
+		{
+			Slot->Readbacks[Target] = MakeUnique<FRHIGPUTextureReadback>(TEXT("TerrainScanCaptureReadback"));
+		}
+	}
+}
+
+FScanCaptureReadback::~FScanCaptureReadback()
+{
+	// Pending render commands keep the ring alive, but nothing is delivered anymore.
+	State->OnReadback.Unbind();
+}
+
+FOnScanCaptureReadback& FScanCaptureReadback::OnReadback()
+{
+	return State->OnReadback;
+}
+
+bool FScanCaptureReadback::HasPendingRequests() const
+{
+	for (const TUniquePtr<FRingState::FSlot>& Slot : State->Slots)
+	{
+		if (Slot->Status != ESlotStatus::Free) return true;
+	}
+	return false;
+}
+
+bool FScanCaptureReadback::Request(const FTargets& Targets, const FScanCaptureFrame& Metadata)
+{
+	int32 SlotIndex = State->Slots.IndexOfByPredicate([](const TUniquePtr<FRingState::FSlot>& Slot)
+	{
+		return Slot->Status == ESlotStatus::Free;
+	});
+
+	if (SlotIndex == INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_TerrainScan_ReadbackDropped);
+		return false;
+	}
+
+	FRingState::FSlot& Slot = *State->Slots[SlotIndex];
+	Slot.Metadata = Metadata;
+	Slot.Metadata.FrameId = NextFrameId++;
+	Slot.Metadata.RequestTime = FPlatformTime::Seconds();
+	Slot.bStub = !FApp::CanEverRender();
+
+	for (int32 Target = 0; Target < NumTargets; ++Target)
+	{
+		Slot.Sizes[Target] = Targets[Target] ? FIntPoint{Targets[Target]->SizeX, Targets[Target]->SizeY} : FIntPoint::ZeroValue;
+	}
+
+	Slot.Status = ESlotStatus::Copying;
+
+	if (Slot.bStub) return true;
+
+	FTextureRenderTargetResource* Resources[NumTargets];
+	for (int32 Target = 0; Target < NumTargets; ++Target)
+	{
+		Resources[Target] = Targets[Target] ? Targets[Target]->GameThread_GetRenderTargetResource() : nullptr;
+	}
+
+	// Queued after the CaptureScene() commands, so the copies see the captured images.
+	ENQUEUE_RENDER_COMMAND(TerrainScanReadbackCopy)(
+		[RingState = State, SlotIndex, Resources](FRHICommandListImmediate& RHICmdList)
+		{
+			FRingState::FSlot& Slot = *RingState->Slots[SlotIndex];
+
+			for (int32 Target = 0; Target < NumTargets; ++Target)
+			{
+				FRHITexture* Texture = Resources[Target] ? Resources[Target]->GetRenderTargetTexture() : nullptr;
+				if (!Texture)
+				{
+					Slot.Sizes[Target] = FIntPoint::ZeroValue;
+					continue;
+				}
+
+				Slot.Formats[Target] = Texture->GetFormat();
+				Slot.Sizes[Target] = Texture->GetSizeXY();
+				Slot.Readbacks[Target]->EnqueueCopy(RHICmdList, Texture);
+			}
+
+			Slot.Metadata.CopyTime = FPlatformTime::Seconds();
+			SET_FLOAT_STAT(STAT_TerrainScan_ReadbackCopyLatency,
+				ToMilliseconds(Slot.Metadata.CopyTime - Slot.Metadata.RequestTime));
+
+			Slot.Status = ESlotStatus::Requested;
+		});
+
+	return true;
+}
+
+void FScanCaptureReadback::Tick()
+{
+	bool bAnyRequested = false;
+
+	for (TUniquePtr<FRingState::FSlot>& SlotPtr : State->Slots)
+	{
+		FRingState::FSlot& Slot = *SlotPtr;
+
+		// Stub producer: deliver placeholder images on the tick after the request.
+		if (Slot.bStub && Slot.Status == ESlotStatus::Copying)
+		{
+			TSharedRef<FScanCaptureFrame> Frame = MakeShared<FScanCaptureFrame>(Slot.Metadata);
+			Frame->CopyTime = Frame->ReadyTime = FPlatformTime::Seconds();
+			Frame->bStub = true;
+
+			for (int32 Target = 0; Target < NumTargets; ++Target)
+			{
+				FScanCaptureImage& Image = Frame->Images[Target];
+				Image.Width = Slot.Sizes[Target].X;
+				Image.Height = Slot.Sizes[Target].Y;
+				Image.Pixels.Init(Target == static_cast<int32>(EScanCaptureTarget::Normals)
+					? FLinearColor{0.0f, 0.0f, 1.0f, 1.0f} : FLinearColor::Transparent, Image.Width * Image.Height);
+			}
+
+			Slot.Status = ESlotStatus::Free;
+			State->OnReadback.ExecuteIfBound(Frame);
+			continue;
+		}
+
+		bAnyRequested |= Slot.Status == ESlotStatus::Requested;
+	}
+
+	if (!bAnyRequested) return;
+
+	ENQUEUE_RENDER_COMMAND(TerrainScanReadbackPoll)(
+		[RingState = State](FRHICommandListImmediate& RHICmdList)
+		{
+			for (int32 SlotIndex = 0; SlotIndex < RingState->Slots.Num(); ++SlotIndex)
+			{
+				FRingState::FSlot& Slot = *RingState->Slots[SlotIndex];
+				if (Slot.Status != ESlotStatus::Requested) continue;
+
+				bool bReady = true;
+				for (int32 Target = 0; Target < NumTargets && bReady; ++Target)
+				{
+					bReady = Slot.Sizes[Target] == FIntPoint::ZeroValue || Slot.Readbacks[Target]->IsReady();
+				}
+
+				// Not ready yet: poll again next frame, never wait for the GPU.
+				if (!bReady) continue;
+
+				TSharedRef<FScanCaptureFrame> Frame = MakeShared<FScanCaptureFrame>(Slot.Metadata);
+				Frame->ReadyTime = FPlatformTime::Seconds();
+				SET_FLOAT_STAT(STAT_TerrainScan_ReadbackGPULatency, ToMilliseconds(Frame->ReadyTime - Frame->CopyTime));
+
+				for (int32 Target = 0; Target < NumTargets; ++Target)
+				{
+					if (Slot.Sizes[Target] == FIntPoint::ZeroValue) continue;
+
+					int32 RowPitchInPixels = 0;
+					if (const uint8* Data = static_cast<const uint8*>(Slot.Readbacks[Target]->Lock(RowPitchInPixels)))
+					{
+						ConvertPixels(Data, RowPitchInPixels, Slot.Formats[Target], Slot.Sizes[Target],
+							Frame->Images[Target]);
+					}
+					Slot.Readbacks[Target]->Unlock();
+				}
+
+				Slot.Status = ESlotStatus::Completing;
+
+				AsyncTask(ENamedThreads::GameThread,
+					[WeakState = TWeakPtr<FRingState, ESPMode::ThreadSafe>(RingState), SlotIndex, Frame]()
+					{
+						const TSharedPtr<FRingState, ESPMode::ThreadSafe> PinnedState = WeakState.Pin();
+						if (!PinnedState) return;
+
+						PinnedState->Slots[SlotIndex]->Status = ESlotStatus::Free;
+
+						SET_FLOAT_STAT(STAT_TerrainScan_ReadbackDeliveryLatency,
+							ToMilliseconds(FPlatformTime::Seconds() - Frame->ReadyTime));
+
+						PinnedState->OnReadback.ExecuteIfBound(Frame);
+					});
+			}
+		});
+}
+
+
+void FScanCaptureWriter::Write(UTextureRenderTarget2D* Target, FScanCaptureImage&& Image, const FVector2f& UVMin,
+	const FVector2f& UVMax)
+{
+	if (!Target || !Image.IsValid() || !FApp::CanEverRender()) return;
+
+	FTextureRenderTargetResource* Resource = Target->GameThread_GetRenderTargetResource();
+	if (!Resource) return;
+
+	// Expanded on the render thread, where the actual format and size of the target are known.
+	ENQUEUE_RENDER_COMMAND(TerrainScanCaptureWrite)(
+		[Resource, Image = MoveTemp(Image), UVMin, UVMax](FRHICommandListImmediate& RHICmdList)
+		{
+			FRHITexture* Texture = Resource->GetRenderTargetTexture();
+			if (!Texture) return;
+
+			const EPixelFormat Format = Texture->GetFormat();
+			const FIntPoint Size = Texture->GetSizeXY();
+			const int32 BytesPerPixel = GPixelFormats[Format].BlockBytes;
+			const FVector2f UVSize = UVMax - UVMin;
+
+			// Source column of every target column.
+			TArray<int32> Columns;
+			Columns.SetNumUninitialized(Size.X);
+			for (int32 X = 0; X < Size.X; ++X)
+			{
+				const float U = ((X + 0.5f) / Size.X - UVMin.X) / UVSize.X;
+				Columns[X] = FMath::Clamp(FMath::FloorToInt32(U * Image.Width), 0, Image.Width - 1);
+			}
+
+			TArray<uint8> Data;
+			Data.SetNumUninitialized(Size.X * Size.Y * BytesPerPixel);
+
+			for (int32 Y = 0; Y < Size.Y; ++Y)
+			{
+				const float V = ((Y + 0.5f) / Size.Y - UVMin.Y) / UVSize.Y;
+				const FLinearColor* SourceRow = &Image.Pixels[
+					FMath::Clamp(FMath::FloorToInt32(V * Image.Height), 0, Image.Height - 1) * Image.Width];
+				uint8* Row = &Data[Y * Size.X * BytesPerPixel];
+
+				for (int32 X = 0; X < Size.X; ++X)
+				{
+					if (!EncodePixel(SourceRow[Columns[X]], Format, Row + X * BytesPerPixel))
+					{
+						UE_LOG(LogTemp, Warning, TEXT("Scan capture writer: unsupported pixel format %s."),
+							GetPixelFormatString(Format));
+						return;
+					}
+				}
+			}
+
+			const FUpdateTextureRegion2D Region{0, 0, 0, 0, static_cast<uint32>(Size.X), static_cast<uint32>(Size.Y)};
+			RHICmdList.UpdateTexture2D(Texture, 0, Region, Size.X * BytesPerPixel, Data.GetData());
+		});
+}
@@ -0,0 +1,145 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UTextureRenderTarget2D;
+class FRHIGPUTextureReadback;
+
+
+/** Scene captures taken by UScannerIconsControllerComponent at every scan. */
+enum class EScanCaptureTarget : uint8
+{
+	Depth,
+	Normals,
+	IDs,
+	CustomDepth,
+
+	Num
+};
+
+
+/**
+ *	CPU copy of a single capture render target, converted to linear floats.
+ */
+struct FScanCaptureImage
+{
+	int32 Width = 0;
+
+	int32 Height = 0;
+
+	TArray<FLinearColor> Pixels;
+
+	bool IsValid() const { return Width > 0 && Height > 0 && Pixels.Num() == Width * Height; }
+
+	/** Nearest pixel at the given UV coordinates, clamped to the image. */
+	const FLinearColor& Sample(float U, float V) const;
+};
+
+
+/**
+ *	All the capture targets of one scan, read back to the CPU.
+ */
+struct FScanCaptureFrame
+{
+	/** Incremented at every request. */
+	uint32 FrameId = 0;
+
+	/** Capture camera location and rotation. */
+	FVector CaptureLocation = FVector::ZeroVector;
+
+	FRotator CaptureRotation = FRotator::ZeroRotator;
+
+	float OrthoWidth = 0.0f;
+
+	/** Yaw of the scan direction: the top of the images points along it. */
+	float ScanYaw = 0.0f;
+
+	/** If true, the Depth image holds the packed capture (see EScanCaptureMode) and the others are empty. */
+	bool bPacked = false;
+
+	/** If true, nothing was captured: the images are placeholders of the null RHI stub producer. */
+	bool bStub = false;
+
+	/** FPlatformTime::Seconds() of each pipeline stage. */
+	double RequestTime = 0.0;
+
+	double CopyTime = 0.0;
+
+	double ReadyTime = 0.0;
+
+	FScanCaptureImage Images[static_cast<int32>(EScanCaptureTarget::Num)];
+
+	const FScanCaptureImage& GetImage(EScanCaptureTarget Target) const { return Images[static_cast<int32>(Target)]; }
+};
+
+
+DECLARE_DELEGATE_OneParam(FOnScanCaptureReadback, TSharedRef<const FScanCaptureFrame>);
+
+
+/**
+ *	Non-blocking readback of the scan capture render targets. Copies are queued on the
+ *	render thread right after the captures, in a small ring of FRHIGPUTextureReadback, and
+ *	polled every frame without flushing: the game thread receives each frame one or two
+ *	frames later through OnReadback. Under the null RHI a stub producer delivers empty
+ *	images instead, so CPU consumers still run headless.
+ */
+class DSTERRAINSCAN_API FScanCaptureReadback
+{
+public:
+
+	static constexpr int32 NumTargets = static_cast<int32>(EScanCaptureTarget::Num);
+
+	using FTargets = TStaticArray<UTextureRenderTarget2D*, NumTargets>;
+
+	explicit FScanCaptureReadback(int32 RingSize = 3);
+
+	~FScanCaptureReadback();
+
+	/**
+	 * Queues the readback of the given targets. Call right after their CaptureScene().
+	 * The request is dropped if every ring slot is still in flight.
+	 *
+	 * @param Targets render targets, indexed by EScanCaptureTarget.
+	 * @param Metadata capture information copied into the delivered frame.
+	 * @return false if the request was dropped.
+	 */
+	bool Request(const FTargets& Targets, const FScanCaptureFrame& Metadata);
+
+	/** Polls the pending copies. Completed frames are delivered on the game thread. */
+	void Tick();
+
+	bool HasPendingRequests() const;
+
+	FOnScanCaptureReadback& OnReadback();
+
+private:
+
+	struct FRingState;
+
+	TSharedRef<FRingState, ESPMode::ThreadSafe> State;
+
+	uint32 NextFrameId = 0;
+};
+
+
+/**
+ *	Writes CPU images into capture render targets, the reverse of FScanCaptureReadback. Lets
+ *	cached terrain reach the consumers of the captures without capturing the scene.
+ */
+class DSTERRAINSCAN_API FScanCaptureWriter
+{
+public:
+
+	/**
+	 * Queues the upload of an image into a render target, converted to its pixel format. The image is
+	 * stretched with nearest filtering over the given UV rectangle, and clamped to its edges outside.
+	 * Nothing is written under the null RHI.
+	 *
+	 * @param Target render target to overwrite.
+	 * @param Image image to write, usually smaller than the target.
+	 * @param UVMin UV coordinates of the image top-left corner.
+	 * @param UVMax UV coordinates of the image bottom-right corner.
+	 */
+	static void Write(UTextureRenderTarget2D* Target, FScanCaptureImage&& Image, const FVector2f& UVMin,
+		const FVector2f& UVMax);
+};
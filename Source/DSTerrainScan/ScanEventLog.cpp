@@ -0,0 +1,178 @@
+﻿#include "ScanEventLog.h"
+#include "HAL/FileManager.h"
+
+void FScanFrameEvent::SetScannerState(const FScannerState& State)
+{
+	AnimationState = State.AnimationState;
+	ElapsedTime = State.ElapsedTime;
+	Range = State.Range;
+	Speed = State.Speed;
+	Opacity = State.Opacity;
+	DarkCircleOpacity = State.DarkCircleOpacity;
+}
+
+bool FScanFrameEvent::MatchesScannerState(const FScannerState& State, float Tolerance) const
+{
+	return AnimationState == State.AnimationState
+		&& FMath::IsNearlyEqual(ElapsedTime, State.ElapsedTime, Tolerance)
+		&& FMath::IsNearlyEqual(Range, State.Range, Tolerance)
+		&& FMath::IsNearlyEqual(Speed, State.Speed, Tolerance)
+		&& FMath::IsNearlyEqual(Opacity, State.Opacity, Tolerance)
+		&& FMath::IsNearlyEqual(DarkCircleOpacity, State.DarkCircleOpacity, Tolerance);
+}
+
+FArchive& operator<<(FArchive& Ar, FScanFrameEvent& Event)
+{
+	Ar << Event.WorldTime << Event.PlayerLocation << Event.PlayerRotation;
+	Ar << Event.AnimationState << Event.ElapsedTime << Event.Range << Event.Speed << Event.Opacity;
+	Ar << Event.DarkCircleOpacity;
+	return Ar;
+}
+
+
+FScanEventLogWriter::~FScanEventLogWriter()
+{
+	Close();
+}
+
+bool FScanEventLogWriter::Open(const FString& Filename, float FixedTimestep)
+{
+	Close();
+
+	Archive.Reset(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Archive)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Cannot create scan event log %s."), *Filename);
+		return false;
+	}
+
+	FScanEventLogHeader Header;
+	Header.FixedTimestep = FixedTimestep;
+	*Archive << Header;
+
+	NumFrames = 0;
+	return true;
+}
+
+void FScanEventLogWriter::Close()
+{
+	if (!Archive) return;
+
+	Archive->Close();
+	Archive.Reset();
+}
+
+void FScanEventLogWriter::WriteFrame(FScanFrameEvent& Event)
+{
+	if (!Archive) return;
+
+	EScanEventType Type = EScanEventType::Frame;
+	*Archive << Type << Event;
+	++NumFrames;
+}
+
+void FScanEventLogWriter::WriteScanStart(FScanStartEvent& Event)
+{
+	if (!Archive) return;
+
+	EScanEventType Type = EScanEventType::ScanStart;
+	*Archive << Type << Event;
+}
+
+void FScanEventLogWriter::WriteFootstep(FFootstepEvent& Event)
+{
+	if (!Archive) return;
+
+	EScanEventType Type = EScanEventType::Footstep;
+	*Archive << Type << Event;
+}
+
+
+bool FScanEventLogReader::Open(const FString& Filename)
+{
+	Close();
+
+	Archive.Reset(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Archive)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Cannot open scan event log %s."), *Filename);
+		return false;
+	}
+
+	*Archive << Header;
+
+	if (Archive->IsError() || Header.Magic != FScanEventLogHeader::ExpectedMagic
+		|| Header.Version != FScanEventLogHeader::CurrentVersion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s is not a scan event log of version %u."), *Filename,
+			FScanEventLogHeader::CurrentVersion);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void FScanEventLogReader::Close()
+{
+	Archive.Reset();
+	NextType.Reset();
+}
+
+bool FScanEventLogReader::ReadFrame(FScanFrameEvent& OutFrame, TArray<FScanStartEvent>& OutScans,
+	TArray<FFootstepEvent>& OutFootsteps)
+{
+	OutScans.Reset();
+	OutFootsteps.Reset();
+
+	if (!Archive) return false;
+
+	// Only the first frame is not announced by the previous one.
+	if (!NextType)
+	{
+		if (Archive->AtEnd()) return false;
+
+		EScanEventType Type;
+		*Archive << Type;
+		NextType = Type;
+	}
+
+	if (NextType.GetValue() != EScanEventType::Frame)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Scan event log is corrupted, expected a frame record."));
+		Close();
+		return false;
+	}
+
+	*Archive << OutFrame;
+	NextType.Reset();
+
+	while (!Archive->AtEnd())
+	{
+		EScanEventType Type;
+		*Archive << Type;
+
+		if (Type == EScanEventType::Frame)
+		{
+			NextType = Type;
+			break;
+		}
+
+		if (Type == EScanEventType::ScanStart)
+		{
+			*Archive << OutScans.AddDefaulted_GetRef();
+		}
+		else if (Type == EScanEventType::Footstep)
+		{
+			*Archive << OutFootsteps.AddDefaulted_GetRef();
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("Scan event log is corrupted, unknown record %d."), static_cast<int32>(Type));
+			Close();
+			return false;
+		}
+	}
+
+	return !Archive->IsError();
+}
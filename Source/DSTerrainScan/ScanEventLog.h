@@ -0,0 +1,158 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ScannerControllerComponent.h"
+#include "FootprintControllerComponent.h"
+
+
+/**
+ *	Binary log of a play session, as written by UScanEventRecorderComponent: a header followed by
+ *	one record per frame, each one followed by the scans and footsteps that happened during that
+ *	frame. Records are appended at the end of every frame, and read back one frame at a time.
+ */
+struct FScanEventLogHeader
+{
+	static constexpr uint32 ExpectedMagic = 0x54535243; // "TSRC"
+
+	/** Bump whenever a record layout changes: older logs are then rejected. */
+	static constexpr uint32 CurrentVersion = 2;
+
+	uint32 Magic = ExpectedMagic;
+
+	uint32 Version = CurrentVersion;
+
+	/** Delta time of every frame, zero if the session ran with a variable frame rate. */
+	float FixedTimestep = 0.0f;
+
+	friend FArchive& operator<<(FArchive& Ar, FScanEventLogHeader& Header)
+	{
+		return Ar << Header.Magic << Header.Version << Header.FixedTimestep;
+	}
+};
+
+enum class EScanEventType : uint8
+{
+	Frame,
+	ScanStart,
+	Footstep
+};
+
+/** Player transform at the start of a frame, and scanner state at its end. */
+struct FScanFrameEvent
+{
+	double WorldTime = 0.0;
+
+	FVector PlayerLocation = FVector::ZeroVector;
+
+	FRotator PlayerRotation = FRotator::ZeroRotator;
+
+	/* Scanner state after the scans of the frame started and the scanner ticked. */
+
+	EScannerAnimationState AnimationState = EScannerAnimationState::Inactive;
+
+	float ElapsedTime = 0.0f;
+
+	float Range = 0.0f;
+
+	float Speed = 0.0f;
+
+	float Opacity = 0.0f;
+
+	float DarkCircleOpacity = 0.0f;
+
+	void SetScannerState(const FScannerState& State);
+
+	/** Returns true if the scanner values match the given state within Tolerance. */
+	bool MatchesScannerState(const FScannerState& State, float Tolerance) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FScanFrameEvent& Event);
+};
+
+struct FScanStartEvent
+{
+	FVector Origin = FVector::ZeroVector;
+
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	friend FArchive& operator<<(FArchive& Ar, FScanStartEvent& Event)
+	{
+		return Ar << Event.Origin << Event.Rotation;
+	}
+};
+
+/** Ground trace of a footstep, see UFootprintControllerComponent::HandleFootstepTrace. */
+struct FFootstepEvent
+{
+	EFootstepType Type = EFootstepType::Left;
+
+	FVector TraceStart = FVector::ZeroVector;
+
+	FVector TraceEnd = FVector::ZeroVector;
+
+	FVector Forward = FVector::ForwardVector;
+
+	friend FArchive& operator<<(FArchive& Ar, FFootstepEvent& Event)
+	{
+		return Ar << Event.Type << Event.TraceStart << Event.TraceEnd << Event.Forward;
+	}
+};
+
+
+/** Appends records to a scan event log. */
+class DSTERRAINSCAN_API FScanEventLogWriter
+{
+public:
+
+	~FScanEventLogWriter();
+
+	/** Creates the log, replacing any existing one. */
+	bool Open(const FString& Filename, float FixedTimestep);
+
+	void Close();
+
+	bool IsOpen() const { return Archive.IsValid(); }
+
+	/** Starts a new frame: the next scans and footsteps belong to it. */
+	void WriteFrame(FScanFrameEvent& Event);
+
+	void WriteScanStart(FScanStartEvent& Event);
+
+	void WriteFootstep(FFootstepEvent& Event);
+
+	int32 GetNumFrames() const { return NumFrames; }
+
+private:
+
+	TUniquePtr<FArchive> Archive;
+
+	int32 NumFrames = 0;
+};
+
+
+/** Reads a scan event log one frame at a time. */
+class DSTERRAINSCAN_API FScanEventLogReader
+{
+public:
+
+	/** @return false if the file is missing, malformed or from another version. */
+	bool Open(const FString& Filename);
+
+	void Close();
+
+	float GetFixedTimestep() const { return Header.FixedTimestep; }
+
+	/**
+	 * Reads the next frame record and the events that belong to it.
+	 * @return false at the end of the log.
+	 */
+	bool ReadFrame(FScanFrameEvent& OutFrame, TArray<FScanStartEvent>& OutScans, TArray<FFootstepEvent>& OutFootsteps);
+
+private:
+
+	TUniquePtr<FArchive> Archive;
+
+	FScanEventLogHeader Header;
+
+	/** Type of the record after the current frame, already read while looking for the frame end. */
+	TOptional<EScanEventType> NextType;
+};
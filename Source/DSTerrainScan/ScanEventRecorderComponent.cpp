@@ -0,0 +1,282 @@
+﻿#include "ScanEventRecorderComponent.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+#include "Engine/World.h"
+#include "ScannerControllerComponent.h"
+#include "ScannerIconsControllerComponent.h"
+#include "FootprintControllerComponent.h"
+
+UScanEventRecorderComponent::UScanEventRecorderComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+void UScanEventRecorderComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FString Filename = LogFilename;
+
+	// The command line wins over the component settings.
+	FString CommandLineFilename;
+	if (FParse::Value(FCommandLine::Get(), TEXT("TerrainScanReplay="), CommandLineFilename))
+	{
+		Mode = EScanEventRecorderMode::Replay;
+		Filename = CommandLineFilename;
+		bExitAfterReplay = true;
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("TerrainScanRecord="), CommandLineFilename))
+	{
+		Mode = EScanEventRecorderMode::Record;
+		Filename = CommandLineFilename;
+	}
+
+	if (Mode == EScanEventRecorderMode::Disabled) return;
+
+	if (!Start(Mode, Filename) && bExitAfterReplay)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, 1);
+	}
+}
+
+bool UScanEventRecorderComponent::Start(EScanEventRecorderMode InMode, const FString& Filename)
+{
+	Mode = InMode;
+	if (Mode == EScanEventRecorderMode::Disabled) return false;
+
+	const FString Path = FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / Filename : Filename;
+
+	Scanner = GetOwner()->GetComponentByClass<UScannerControllerComponent>();
+	Icons = GetOwner()->GetComponentByClass<UScannerIconsControllerComponent>();
+	Footprints = GetOwner()->GetComponentByClass<UFootprintControllerComponent>();
+
+	const bool bStarted = Mode == EScanEventRecorderMode::Record ? StartRecording(Path) : StartReplay(Path);
+	if (!bStarted)
+	{
+		Mode = EScanEventRecorderMode::Disabled;
+		return false;
+	}
+
+	// Events of a frame are recorded, or replayed, before the components react to them.
+	for (UActorComponent* Component : TArray<UActorComponent*>{Scanner, Icons, Footprints})
+	{
+		if (Component) Component->PrimaryComponentTick.AddPrerequisite(this, PrimaryComponentTick);
+	}
+
+	bFramePending = false;
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this,
+		&UScanEventRecorderComponent::HandleWorldPostActorTick);
+
+	SetComponentTickEnabled(true);
+	return true;
+}
+
+void UScanEventRecorderComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Writer.IsOpen())
+	{
+		UE_LOG(LogTemp, Display, TEXT("Scan event recording stopped after %d frames."), Writer.GetNumFrames());
+		Writer.Close();
+	}
+
+	Reader.Close();
+	SetFixedTimestep(0.0f);
+
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	if (Scanner) Scanner->OnScanStarted.RemoveAll(this);
+	if (Footprints) Footprints->OnFootstepTraceRequested.RemoveAll(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UScanEventRecorderComponent::TickComponent(float DeltaTime, ELevelTick TickType,
+	FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (Mode == EScanEventRecorderMode::Record)
+	{
+		RecordFrame();
+	}
+	else if (Mode == EScanEventRecorderMode::Replay)
+	{
+		ReplayFrame();
+	}
+}
+
+bool UScanEventRecorderComponent::StartRecording(const FString& Filename)
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Filename), true);
+	if (!Writer.Open(Filename, FixedTimestep)) return false;
+
+	PendingScans.Reset();
+	PendingFootsteps.Reset();
+
+	SetFixedTimestep(FixedTimestep);
+
+	if (Scanner)
+	{
+		Scanner->OnScanStarted.AddUObject(this, &UScanEventRecorderComponent::HandleScanStarted);
+	}
+
+	if (Footprints)
+	{
+		Footprints->OnFootstepTraceRequested.AddUObject(this,
+			&UScanEventRecorderComponent::HandleFootstepTraceRequested);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Recording scan events to %s."), *Filename);
+	return true;
+}
+
+bool UScanEventRecorderComponent::StartReplay(const FString& Filename)
+{
+	if (!Reader.Open(Filename)) return false;
+
+	SetFixedTimestep(Reader.GetFixedTimestep());
+
+	// The log drives the owner: no movement, and footprints only from recorded footsteps.
+	if (ACharacter* Character = GetOwner<ACharacter>())
+	{
+		Character->GetCharacterMovement()->DisableMovement();
+	}
+
+	if (Footprints) Footprints->SetIgnoreAnimFootsteps(true);
+
+	NumReplayedFrames = 0;
+	NumMismatchedFrames = 0;
+
+	UE_LOG(LogTemp, Display, TEXT("Replaying scan events from %s."), *Filename);
+	return true;
+}
+
+void UScanEventRecorderComponent::RecordFrame()
+{
+	// The scanner state is only known once the frame ran, see HandleWorldPostActorTick.
+	CurrentFrame.WorldTime = GetWorld()->GetTimeSeconds();
+	CurrentFrame.PlayerLocation = GetOwner()->GetActorLocation();
+	CurrentFrame.PlayerRotation = GetOwner()->GetActorRotation();
+	bFramePending = true;
+}
+
+void UScanEventRecorderComponent::ReplayFrame()
+{
+	if (!Reader.ReadFrame(CurrentFrame, ReplayScans, ReplayFootsteps))
+	{
+		FinishReplay();
+		return;
+	}
+
+	++NumReplayedFrames;
+	bFramePending = true;
+
+	GetOwner()->SetActorLocationAndRotation(CurrentFrame.PlayerLocation, CurrentFrame.PlayerRotation, false, nullptr,
+		ETeleportType::TeleportPhysics);
+
+	// Icons and footprints are started by the owner, see AScannerCharacter::HandleScanStarted. The
+	// log holds the scans of this machine: they never go through the server.
+	for (const FScanStartEvent& Scan : ReplayScans)
+	{
+		if (Scanner) Scanner->StartScannerLifecycleLocally(Scan.Origin, Scan.Rotation);
+	}
+
+	if (Footprints)
+	{
+		for (const FFootstepEvent& Footstep : ReplayFootsteps)
+		{
+			Footprints->HandleFootstepTrace(Footstep.Type, Footstep.TraceStart, Footstep.TraceEnd, Footstep.Forward);
+		}
+	}
+}
+
+void UScanEventRecorderComponent::HandleWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld() || !bFramePending) return;
+
+	bFramePending = false;
+
+	if (Mode == EScanEventRecorderMode::Record)
+	{
+		if (Scanner) CurrentFrame.SetScannerState(Scanner->GetCurrentFrameScannerState());
+
+		Writer.WriteFrame(CurrentFrame);
+
+		// Every event since the previous record, whether it happened before or after this frame's tick.
+		for (FScanStartEvent& Scan : PendingScans)
+		{
+			Writer.WriteScanStart(Scan);
+		}
+
+		for (FFootstepEvent& Footstep : PendingFootsteps)
+		{
+			Writer.WriteFootstep(Footstep);
+		}
+
+		PendingScans.Reset();
+		PendingFootsteps.Reset();
+	}
+	else if (Mode == EScanEventRecorderMode::Replay)
+	{
+		// Both sampled after the scans of the frame started and the scanner ticked.
+		if (Scanner && !CurrentFrame.MatchesScannerState(Scanner->GetCurrentFrameScannerState(), StateTolerance))
+		{
+			if (NumMismatchedFrames++ == 0)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Scan replay diverged from the log at frame %d (time %.3f)."),
+					NumReplayedFrames - 1, CurrentFrame.WorldTime);
+			}
+		}
+	}
+}
+
+void UScanEventRecorderComponent::FinishReplay()
+{
+	UE_LOG(LogTemp, Display, TEXT("Scan replay finished: %d frames, %d diverged from the log."), NumReplayedFrames,
+		NumMismatchedFrames);
+
+	Reader.Close();
+	SetFixedTimestep(0.0f);
+	Mode = EScanEventRecorderMode::Disabled;
+	SetComponentTickEnabled(false);
+
+	if (Footprints) Footprints->SetIgnoreAnimFootsteps(false);
+
+	if (bExitAfterReplay)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, NumMismatchedFrames > 0 ? 1 : 0);
+	}
+}
+
+void UScanEventRecorderComponent::HandleScanStarted(const FScannerState& State)
+{
+	PendingScans.Add(FScanStartEvent{State.Origin, State.Rotation});
+}
+
+void UScanEventRecorderComponent::HandleFootstepTraceRequested(EFootstepType FootstepType, const FVector& TraceStart,
+	const FVector& TraceEnd, const FVector& Forward)
+{
+	PendingFootsteps.Add(FFootstepEvent{FootstepType, TraceStart, TraceEnd, Forward});
+}
+
+void UScanEventRecorderComponent::SetFixedTimestep(float Timestep)
+{
+	if (Timestep > 0.0f)
+	{
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(Timestep);
+		bFixedTimestepForced = true;
+	}
+	else if (bFixedTimestepForced)
+	{
+		FApp::SetUseFixedTimeStep(false);
+		bFixedTimestepForced = false;
+	}
+}
@@ -0,0 +1,152 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ScanEventLog.h"
+#include "ScanEventRecorderComponent.generated.h"
+
+class UScannerControllerComponent;
+class UScannerIconsControllerComponent;
+class UFootprintControllerComponent;
+
+UENUM()
+enum class EScanEventRecorderMode : uint8
+{
+	Disabled,
+
+	/** Writes the session to the log: player transform and scanner state per frame, scans and footsteps. */
+	Record,
+
+	/**
+	 * Drives the owner's scanner, icons and footprints from the log instead of the player, and
+	 * compares the scanner state at the end of every frame with the recorded one.
+	 */
+	Replay
+};
+
+/**
+ *	Records a play session to a compact binary log (see FScanEventLogHeader) and replays it with a
+ *	fixed timestep, for reproducible performance runs and golden-state comparisons with no one at
+ *	the controls. Both modes can be forced from the command line, which also works headless:
+ *	-TerrainScanRecord=<file> and -TerrainScanReplay=<file>. A command line replay exits the game
+ *	when done, with a non-zero code if any frame diverged from the log.
+ */
+UCLASS(ClassGroup=(Custom), Blueprintable, meta=(BlueprintSpawnableComponent))
+class DSTERRAINSCAN_API UScanEventRecorderComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UScanEventRecorderComponent();
+
+private:
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recording", meta = (AllowPrivateAccess = "true"))
+	EScanEventRecorderMode Mode = EScanEventRecorderMode::Disabled;
+
+	/** Log file, relative to the project Saved directory unless absolute. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recording", meta = (AllowPrivateAccess = "true"))
+	FString LogFilename = TEXT("TerrainScan/Session.tsrec");
+
+	/**
+	 * Delta time forced while recording, so that a replay reproduces the same frames. Zero records
+	 * at the natural frame rate. Replays always use the timestep of their log.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recording", meta = (AllowPrivateAccess = "true",
+		ClampMin = "0.0", Units = "s"))
+	float FixedTimestep = 1.0f / 60.0f;
+
+	/** Largest difference between a replayed and a recorded scanner value still considered equal. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recording", meta = (AllowPrivateAccess = "true",
+		ClampMin = "0.0"))
+	float StateTolerance = 0.001f;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
+		FActorComponentTickFunction* ThisTickFunction) override;
+
+	/**
+	 * Starts recording or replaying, as BeginPlay does for the configured Mode.
+	 *
+	 * @param Filename log file, relative to the project Saved directory unless absolute.
+	 * @return false if the log cannot be opened.
+	 */
+	bool Start(EScanEventRecorderMode InMode, const FString& Filename);
+
+	bool IsReplaying() const { return Mode == EScanEventRecorderMode::Replay; }
+
+	int32 GetNumReplayedFrames() const { return NumReplayedFrames; }
+
+	/** Frames of the replay whose scanner state differed from the log. */
+	int32 GetNumMismatchedFrames() const { return NumMismatchedFrames; }
+
+private:
+
+	bool StartRecording(const FString& Filename);
+
+	bool StartReplay(const FString& Filename);
+
+	void RecordFrame();
+
+	void ReplayFrame();
+
+	void FinishReplay();
+
+	/** Ends the frame started by RecordFrame or ReplayFrame, once every actor ticked. */
+	void HandleWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	void HandleScanStarted(const FScannerState& State);
+
+	void HandleFootstepTraceRequested(EFootstepType FootstepType, const FVector& TraceStart, const FVector& TraceEnd,
+		const FVector& Forward);
+
+	/** Forces the engine to advance the world by Timestep every frame, zero restores the variable timestep. */
+	void SetFixedTimestep(float Timestep);
+
+	UPROPERTY()
+	TObjectPtr<UScannerControllerComponent> Scanner;
+
+	UPROPERTY()
+	TObjectPtr<UScannerIconsControllerComponent> Icons;
+
+	UPROPERTY()
+	TObjectPtr<UFootprintControllerComponent> Footprints;
+
+	FScanEventLogWriter Writer;
+
+	FScanEventLogReader Reader;
+
+	/** Events of the frame being replayed, kept to reuse their memory. */
+	TArray<FScanStartEvent> ReplayScans;
+
+	TArray<FFootstepEvent> ReplayFootsteps;
+
+	/** Frame being recorded or replayed, completed at the end of the frame. */
+	FScanFrameEvent CurrentFrame;
+
+	bool bFramePending = false;
+
+	FDelegateHandle PostActorTickHandle;
+
+	/* Events of the frame being recorded, written after its record. */
+
+	TArray<FScanStartEvent> PendingScans;
+
+	TArray<FFootstepEvent> PendingFootsteps;
+
+	int32 NumReplayedFrames = 0;
+
+	int32 NumMismatchedFrames = 0;
+
+	/** Set for command line replays, which quit when done. */
+	bool bExitAfterReplay = false;
+
+	bool bFixedTimestepForced = false;
+};
@@ -0,0 +1,201 @@
+﻿#include "ScanIconsNiagaraParameters.h"
+#include "NiagaraComponent.h"
+#include "NiagaraSystem.h"
+#include "NiagaraTypes.h"
+#include "ScanProfileDataAsset.h"
+
+namespace ScanIconsNiagaraNames
+{
+	enum class EType : uint8
+	{
+		Int,
+		Float,
+		Bool,
+		Vec2,
+		Vec3,
+		Color
+	};
+
+	struct FParameter
+	{
+		const TCHAR* Name;
+
+		EType Type;
+	};
+
+	const FParameter Parameters[] =
+	{
+		{TEXT("GridX"), EType::Int},
+		{TEXT("GridY"), EType::Int},
+		{TEXT("Padding"), EType::Vec3},
+		{TEXT("ZOffset"), EType::Float},
+		{TEXT("RegularTerrainThreshold"), EType::Float},
+		{TEXT("SteepTerrainThreshold"), EType::Float},
+		{TEXT("ShallowWaterThreshold"), EType::Float},
+		{TEXT("DeepWaterThreshold"), EType::Float},
+		{TEXT("Default Size"), EType::Vec2},
+		{TEXT("Danger Icon Size"), EType::Vec2},
+		{TEXT("Water Icons Size"), EType::Vec2},
+		{TEXT("Flare Size"), EType::Vec2},
+		{TEXT("Rocky Icons Size"), EType::Vec2},
+		{TEXT("Vegetation Icons Size"), EType::Vec2},
+		{TEXT("Path Icons Size"), EType::Vec2},
+		{TEXT("Icon Blue"), EType::Color},
+		{TEXT("Icon Yellow"), EType::Color},
+		{TEXT("Icon Red"), EType::Color},
+		{TEXT("Icon Green"), EType::Color},
+		{TEXT("TotalAnimationCycles"), EType::Int},
+		{TEXT("OpacityAnimationSpeed"), EType::Float},
+		{TEXT("FadeAnimationWidth"), EType::Float},
+		{TEXT("DangerIconFadeoutTime"), EType::Float},
+		{TEXT("DangerIconAppearOffset"), EType::Float},
+		{TEXT("FlareDuration"), EType::Float},
+		{TEXT("DirectionVector"), EType::Vec3},
+		{TEXT("CameraZ"), EType::Float},
+		{TEXT("HalfAngle"), EType::Float},
+		{TEXT("ScanEndTime"), EType::Float},
+		{TEXT("ScanGeneration"), EType::Int},
+		{TEXT("CurrentRange"), EType::Float}
+	};
+	static_assert(UE_ARRAY_COUNT(Parameters) == static_cast<int32>(EScanIconsParameter::Num));
+
+	FNiagaraTypeDefinition GetTypeDefinition(EType Type)
+	{
+		switch (Type)
+		{
+		case EType::Int: return FNiagaraTypeDefinition::GetIntDef();
+		case EType::Bool: return FNiagaraTypeDefinition::GetBoolDef();
+		case EType::Vec2: return FNiagaraTypeDefinition::GetVec2Def();
+		case EType::Vec3: return FNiagaraTypeDefinition::GetVec3Def();
+		case EType::Color: return FNiagaraTypeDefinition::GetColorDef();
+		default: return FNiagaraTypeDefinition::GetFloatDef();
+		}
+	}
+}
+
+void FScanIconsNiagaraParameters::Bind(UNiagaraComponent* InComponent)
+{
+	Component = InComponent;
+	Resolve();
+}
+
+void FScanIconsNiagaraParameters::Resolve()
+{
+	for (int32& Offset : Offsets)
+	{
+		Offset = INDEX_NONE;
+	}
+
+	ResolvedAsset = nullptr;
+
+	UNiagaraComponent* NiagaraComponent = Component.Get();
+	if (!NiagaraComponent) return;
+
+	ResolvedAsset = NiagaraComponent->GetAsset();
+
+	// Same names as UNiagaraComponent::SetVariable*, the store redirects them to the user namespace.
+	const FNiagaraUserRedirectionParameterStore& Store = NiagaraComponent->GetOverrideParameters();
+
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(ScanIconsNiagaraNames::Parameters); ++Index)
+	{
+		const ScanIconsNiagaraNames::FParameter& Parameter = ScanIconsNiagaraNames::Parameters[Index];
+		const FNiagaraVariable Variable{ScanIconsNiagaraNames::GetTypeDefinition(Parameter.Type), Parameter.Name};
+
+		if (const int32* Offset = Store.FindParameterOffset(Variable))
+		{
+			Offsets[Index] = *Offset;
+		}
+	}
+}
+
+template<typename ValueType>
+void FScanIconsNiagaraParameters::Write(EScanIconsParameter Parameter, const ValueType& Value)
+{
+	UNiagaraComponent* NiagaraComponent = Component.Get();
+	if (!NiagaraComponent) return;
+
+	FNiagaraUserRedirectionParameterStore& Store = NiagaraComponent->GetOverrideParameters();
+
+	// A new asset rebuilds the store, moving every parameter. Parameters added by name are appended
+	// and leave the others in place.
+	if (ResolvedAsset != NiagaraComponent->GetAsset())
+	{
+		Resolve();
+	}
+
+	const int32 Offset = Offsets[static_cast<int32>(Parameter)];
+	if (Offset == INDEX_NONE) return;
+
+	// Copies the value and marks the store dirty, as SetParameterValue does after its lookup.
+	Store.SetParameterData(reinterpret_cast<const uint8*>(&Value), Offset, sizeof(ValueType));
+}
+
+void FScanIconsNiagaraParameters::SetInt(EScanIconsParameter Parameter, int32 Value)
+{
+	Write(Parameter, Value);
+}
+
+void FScanIconsNiagaraParameters::SetFloat(EScanIconsParameter Parameter, float Value)
+{
+	Write(Parameter, Value);
+}
+
+void FScanIconsNiagaraParameters::SetBool(EScanIconsParameter Parameter, bool Value)
+{
+	Write(Parameter, FNiagaraBool{Value});
+}
+
+void FScanIconsNiagaraParameters::SetVec2(EScanIconsParameter Parameter, const FVector2f& Value)
+{
+	Write(Parameter, Value);
+}
+
+void FScanIconsNiagaraParameters::SetVec3(EScanIconsParameter Parameter, const FVector3f& Value)
+{
+	Write(Parameter, Value);
+}
+
+void FScanIconsNiagaraParameters::SetColor(EScanIconsParameter Parameter, const FLinearColor& Value)
+{
+	Write(Parameter, Value);
+}
+
+void FScanIconsNiagaraParameters::SetSettings(const FScanIconsSettings& Settings)
+{
+	// Grid settings
+	SetInt(EScanIconsParameter::GridX, Settings.GridX);
+	SetInt(EScanIconsParameter::GridY, Settings.GridY);
+	SetVec3(EScanIconsParameter::Padding, FVector3f{Settings.Padding, Settings.Padding, 0.0f});
+	SetFloat(EScanIconsParameter::ZOffset, Settings.ZOffset);
+
+	// Thresholds
+	SetFloat(EScanIconsParameter::RegularTerrainThreshold, Settings.RegularTerrainThreshold);
+	SetFloat(EScanIconsParameter::SteepTerrainThreshold, Settings.SteepTerrainThreshold);
+	SetFloat(EScanIconsParameter::ShallowWaterThreshold, Settings.ShallowWaterThreshold);
+	SetFloat(EScanIconsParameter::DeepWaterThreshold, Settings.DeepWaterThreshold);
+
+	// Sprite sizes
+	SetVec2(EScanIconsParameter::DefaultSize, FVector2f{Settings.DefaultSize});
+	SetVec2(EScanIconsParameter::DangerIconSize, FVector2f{Settings.DangerIconSize});
+	SetVec2(EScanIconsParameter::WaterIconsSize, FVector2f{Settings.WaterIconsSize});
+	SetVec2(EScanIconsParameter::FlareSize, FVector2f{Settings.FlareSize});
+	SetVec2(EScanIconsParameter::RockyIconsSize, FVector2f{Settings.RockyIconsSize});
+	SetVec2(EScanIconsParameter::VegetationIconsSize, FVector2f{Settings.VegetationIconsSize});
+	SetVec2(EScanIconsParameter::PathIconsSize, FVector2f{Settings.PathIconsSize});
+
+	// Sprite colors
+	SetColor(EScanIconsParameter::IconBlue, FLinearColor::FromSRGBColor(Settings.IconBlue));
+	SetColor(EScanIconsParameter::IconYellow, FLinearColor::FromSRGBColor(Settings.IconYellow));
+	SetColor(EScanIconsParameter::IconRed, FLinearColor::FromSRGBColor(Settings.IconRed));
+	SetColor(EScanIconsParameter::IconGreen, FLinearColor::FromSRGBColor(Settings.IconGreen));
+
+	// Opacity animation
+	SetInt(EScanIconsParameter::TotalAnimationCycles, Settings.TotalAnimationCycles);
+	SetFloat(EScanIconsParameter::OpacityAnimationSpeed, Settings.OpacityAnimationSpeed);
+	SetFloat(EScanIconsParameter::FadeAnimationWidth, Settings.FadeIntensityFactor);
+	SetFloat(EScanIconsParameter::DangerIconFadeoutTime, Settings.DangerIconFadeoutTime);
+	SetFloat(EScanIconsParameter::DangerIconAppearOffset, Settings.DangerIconAppearOffset);
+
+	// Flare animation
+	SetFloat(EScanIconsParameter::FlareDuration, Settings.FlareAnimationDuration);
+}
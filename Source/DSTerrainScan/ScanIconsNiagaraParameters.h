@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UNiagaraComponent;
+class UNiagaraSystem;
+struct FScanIconsSettings;
+
+
+/** User parameters of the icons system written at runtime. */
+enum class EScanIconsParameter : uint8
+{
+	// Profile settings, see FScanIconsSettings
+	GridX,
+	GridY,
+	Padding,
+	ZOffset,
+	RegularTerrainThreshold,
+	SteepTerrainThreshold,
+	ShallowWaterThreshold,
+	DeepWaterThreshold,
+	DefaultSize,
+	DangerIconSize,
+	WaterIconsSize,
+	FlareSize,
+	RockyIconsSize,
+	VegetationIconsSize,
+	PathIconsSize,
+	IconBlue,
+	IconYellow,
+	IconRed,
+	IconGreen,
+	TotalAnimationCycles,
+	OpacityAnimationSpeed,
+	FadeAnimationWidth,
+	DangerIconFadeoutTime,
+	DangerIconAppearOffset,
+	FlareDuration,
+
+	// Every scan
+	DirectionVector,
+	CameraZ,
+	HalfAngle,
+	ScanEndTime,
+	ScanGeneration,
+
+	// Every tick
+	CurrentRange,
+
+	Num
+};
+
+
+/**
+ *	Icons system user parameters, resolved once to their offsets in the override parameter store of
+ *	a Niagara component. Writes then copy the value in place, without the name lookup and hashing of
+ *	UNiagaraComponent::SetVariable*. The store is rebuilt from the asset of the component, so the
+ *	offsets are resolved again when the asset changes; call Bind again after anything else that
+ *	rebuilds it, e.g. ReinitializeSystem. Parameters the system does not declare are skipped,
+ *	instead of being added.
+ */
+class DSTERRAINSCAN_API FScanIconsNiagaraParameters
+{
+public:
+
+	void Bind(UNiagaraComponent* InComponent);
+
+	bool IsBound() const { return Component.IsValid(); }
+
+	void SetInt(EScanIconsParameter Parameter, int32 Value);
+
+	void SetFloat(EScanIconsParameter Parameter, float Value);
+
+	void SetBool(EScanIconsParameter Parameter, bool Value);
+
+	void SetVec2(EScanIconsParameter Parameter, const FVector2f& Value);
+
+	void SetVec3(EScanIconsParameter Parameter, const FVector3f& Value);
+
+	void SetColor(EScanIconsParameter Parameter, const FLinearColor& Value);
+
+	/** Writes every profile setting. */
+	void SetSettings(const FScanIconsSettings& Settings);
+
+private:
+
+	/** Finds the offsets of every parameter in the store of the component. */
+	void Resolve();
+
+	template<typename ValueType>
+	void Write(EScanIconsParameter Parameter, const ValueType& Value);
+
+	TWeakObjectPtr<UNiagaraComponent> Component;
+
+	/** Asset of the component when the offsets were resolved, see Resolve. */
+	TWeakObjectPtr<UNiagaraSystem> ResolvedAsset;
+
+	int32 Offsets[static_cast<int32>(EScanIconsParameter::Num)];
+};
@@ -0,0 +1,115 @@
+﻿#include "ScanKinematics.h"
+
+namespace
+{
+	/** Distance covered in T seconds by a speed going linearly from V0 to V1 over Duration seconds. */
+	float LinearRampDistance(float V0, float V1, float Duration, float T)
+	{
+		return Duration > 0.0f ? V0 * T + (V1 - V0) * T * T / (2.0f * Duration) : V0 * T;
+	}
+
+	float LinearRampSpeed(float V0, float V1, float Duration, float T)
+	{
+		return Duration > 0.0f ? FMath::Lerp(V0, V1, FMath::Clamp(T / Duration, 0.0f, 1.0f)) : V1;
+	}
+}
+
+FScanKinematics::FScanKinematics(const FScanKinematicsParams& InParams)
+	: Params(InParams)
+{
+	const float DecelerationDuration = Params.ExpansionAnimationDuration - Params.ExpansionMaxSpeedDuration;
+
+	PrewarmEndTime = Params.SpawnAnimationDuration + Params.PrewarmAnimationDuration;
+
+	SpawnEndRange = Params.SpawnInitialRange + LinearRampDistance(Params.SpawnInitialSpeed, Params.PrewarmSpeed,
+		Params.SpawnAnimationDuration, Params.SpawnAnimationDuration);
+
+	PrewarmEndRange = SpawnEndRange + Params.PrewarmAnimationDuration * Params.PrewarmSpeed;
+
+	AccelerationEndRange = PrewarmEndRange + LinearRampDistance(Params.PrewarmSpeed, Params.ExpansionMaxSpeed,
+		Params.ExpansionMaxSpeedDuration, Params.ExpansionMaxSpeedDuration);
+
+	FinalRange = AccelerationEndRange + LinearRampDistance(Params.ExpansionMaxSpeed, Params.ExpansionFinalSpeed,
+		DecelerationDuration, DecelerationDuration);
+}
+
+FScanKinematicsSample FScanKinematics::Evaluate(float TimeSinceStart) const
+{
+	FScanKinematicsSample Sample;
+
+	const float T = FMath::Max(TimeSinceStart, 0.0f);
+
+	// Spawning: speed slows down to the prewarm value, opacity grows.
+	if (T < Params.SpawnAnimationDuration)
+	{
+		Sample.AnimationState = EScannerAnimationState::Spawning;
+		Sample.ElapsedTime = T;
+		Sample.Speed = LinearRampSpeed(Params.SpawnInitialSpeed, Params.PrewarmSpeed, Params.SpawnAnimationDuration, T);
+		Sample.Range = Params.SpawnInitialRange
+			+ LinearRampDistance(Params.SpawnInitialSpeed, Params.PrewarmSpeed, Params.SpawnAnimationDuration, T);
+		Sample.Opacity = FMath::Lerp(0.0f, Params.SpawnFinalOpacity,
+			FMath::Clamp(T / Params.SpawnAnimationDuration, 0.0f, 1.0f));
+		Sample.DarkCircleOpacity = 1.0f;
+		return Sample;
+	}
+
+	// Prewarm: constant speed and opacity.
+	if (T < PrewarmEndTime)
+	{
+		const float Tau = T - Params.SpawnAnimationDuration;
+
+		Sample.AnimationState = EScannerAnimationState::Prewarm;
+		Sample.ElapsedTime = Tau;
+		Sample.Speed = Params.PrewarmSpeed;
+		Sample.Range = SpawnEndRange + Tau * Params.PrewarmSpeed;
+		Sample.Opacity = Params.SpawnFinalOpacity;
+		Sample.DarkCircleOpacity = 1.0f;
+		return Sample;
+	}
+
+	const float Tau = T - PrewarmEndTime;
+
+	// Past the end of the lifecycle the scan rests at its final range.
+	if (Tau >= Params.ExpansionAnimationDuration)
+	{
+		Sample.AnimationState = EScannerAnimationState::Inactive;
+		Sample.ElapsedTime = Tau - Params.ExpansionAnimationDuration;
+		Sample.Range = FinalRange;
+		return Sample;
+	}
+
+	// Expanding: accelerate and then slow down.
+	Sample.AnimationState = EScannerAnimationState::Expanding;
+	Sample.ElapsedTime = Tau;
+
+	if (Tau <= Params.ExpansionMaxSpeedDuration)
+	{
+		Sample.Speed = LinearRampSpeed(Params.PrewarmSpeed, Params.ExpansionMaxSpeed,
+			Params.ExpansionMaxSpeedDuration, Tau);
+		Sample.Range = PrewarmEndRange + LinearRampDistance(Params.PrewarmSpeed, Params.ExpansionMaxSpeed,
+			Params.ExpansionMaxSpeedDuration, Tau);
+	}
+	else
+	{
+		const float DecelerationDuration = Params.ExpansionAnimationDuration - Params.ExpansionMaxSpeedDuration;
+		const float DecelerationTime = Tau - Params.ExpansionMaxSpeedDuration;
+
+		Sample.Speed = LinearRampSpeed(Params.ExpansionMaxSpeed, Params.ExpansionFinalSpeed,
+			DecelerationDuration, DecelerationTime);
+		Sample.Range = AccelerationEndRange + LinearRampDistance(Params.ExpansionMaxSpeed, Params.ExpansionFinalSpeed,
+			DecelerationDuration, DecelerationTime);
+	}
+
+	const float FadeoutStartTime = Params.ExpansionAnimationDuration - Params.FadeoutDuration;
+	Sample.Opacity = Tau >= FadeoutStartTime
+		? FMath::Lerp(Params.SpawnFinalOpacity, 0.0f,
+			FMath::Clamp((Tau - FadeoutStartTime) / Params.FadeoutDuration, 0.0f, 1.0f))
+		: Params.SpawnFinalOpacity;
+
+	// Matches the previous per-tick behavior: the dark circle is dropped once its fadeout time has passed.
+	Sample.DarkCircleOpacity = Tau >= Params.DarkCircleFadeoutDuration
+		? 1.0f - FMath::Clamp(Tau / Params.DarkCircleFadeoutDuration, 0.0f, 1.0f)
+		: 1.0f;
+
+	return Sample;
+}
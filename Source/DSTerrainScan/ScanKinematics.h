@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "ScanKinematics.generated.h"
+
+
+UENUM()
+enum class EScannerAnimationState : uint8
+{
+	Inactive,
+	Spawning,
+	Prewarm,
+	Expanding
+};
+
+
+/**
+ *	Tuning values describing the piecewise-linear speed profile of a scan.
+ */
+USTRUCT(BlueprintType)
+struct FScanKinematicsParams
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations")
+	float SpawnAnimationDuration = 0.2f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations")
+	float PrewarmAnimationDuration = 0.3f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations")
+	float ExpansionAnimationDuration = 2.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations")
+	float FadeoutDuration = 1.7f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations")
+	float DarkCircleFadeoutDuration = 1.7f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawn Options")
+	float SpawnInitialRange = 500.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawn Options")
+	float SpawnInitialSpeed = 2000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawn Options")
+	float SpawnFinalOpacity = 0.55f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pre-warm Options")
+	float PrewarmSpeed = 200.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Expansion Options")
+	float ExpansionMaxSpeed = 20000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Expansion Options")
+	float ExpansionMaxSpeedDuration = 0.3f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Expansion Options")
+	float ExpansionFinalSpeed = 500.0f;
+};
+
+
+/**
+ *	Everything that shapes a single scan, e.g. for scanners started by AI or scripted events
+ *	with settings of their own (see UScannerControllerComponent::StartScannerLifecycleWithProfile).
+ */
+USTRUCT(BlueprintType)
+struct FScanProfile
+{
+	GENERATED_BODY()
+
+	/** Opening of the scan arc, in degrees. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Shape")
+	float ArcAngle = 120.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Kinematics")
+	FScanKinematicsParams Kinematics;
+};
+
+
+/**
+ *	Scanner values at a given instant of the lifecycle.
+ */
+struct FScanKinematicsSample
+{
+	EScannerAnimationState AnimationState = EScannerAnimationState::Inactive;
+
+	/** Time elapsed relative to the current animation state. */
+	float ElapsedTime = 0.0f;
+
+	float Range = 0.0f;
+
+	float Speed = 0.0f;
+
+	float Opacity = 0.0f;
+
+	float DarkCircleOpacity = 0.0f;
+};
+
+
+/**
+ *	Closed-form evaluator of the scanner lifecycle. Since speed is linear inside each
+ *	phase, range is its exact integral and can be sampled at any time in O(1), which
+ *	makes the result independent of the frame rate used to drive it.
+ */
+struct DSTERRAINSCAN_API FScanKinematics
+{
+	FScanKinematics() = default;
+
+	explicit FScanKinematics(const FScanKinematicsParams& InParams);
+
+	/**
+	 * Samples the scanner at the given time.
+	 *
+	 * @param TimeSinceStart seconds since the scan was started.
+	 * @return range, speed and opacities at that instant.
+	 */
+	FScanKinematicsSample Evaluate(float TimeSinceStart) const;
+
+	float GetFinalRange() const { return FinalRange; }
+
+	float GetTotalDuration() const { return PrewarmEndTime + Params.ExpansionAnimationDuration; }
+
+	const FScanKinematicsParams& GetParams() const { return Params; }
+
+private:
+
+	FScanKinematicsParams Params;
+
+	// Phase boundaries, precomputed once so that sampling never walks previous phases.
+
+	float PrewarmEndTime = 0.0f;
+
+	float SpawnEndRange = 0.0f;
+
+	float PrewarmEndRange = 0.0f;
+
+	float AccelerationEndRange = 0.0f;
+
+	float FinalRange = 0.0f;
+};
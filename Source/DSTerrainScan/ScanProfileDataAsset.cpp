@@ -0,0 +1,43 @@
+﻿#include "ScanProfileDataAsset.h"
+
+float FScanIconsSettings::ComputeTotalEffectDuration() const
+{
+	return (RevealAnimationDuration() + FadeAnimationDuration()) * TotalAnimationCycles
+		+  FadeAnimationDuration() + DangerIconFadeoutTime;
+}
+
+bool FScanIconsSettings::HasSameGrid(const FScanIconsSettings& Other) const
+{
+	return GridX == Other.GridX && GridY == Other.GridY && Padding == Other.Padding;
+}
+
+
+void UScanProfileDataAsset::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	UpdateDerivedValues();
+}
+
+void UScanProfileDataAsset::PostLoad()
+{
+	Super::PostLoad();
+
+	UpdateDerivedValues();
+}
+
+#if WITH_EDITOR
+void UScanProfileDataAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	UpdateDerivedValues();
+}
+#endif
+
+void UScanProfileDataAsset::UpdateDerivedValues()
+{
+	Kinematics = FScanKinematics(Scan.Kinematics);
+	TotalEffectDuration = Icons.ComputeTotalEffectDuration();
+	CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(Scan.ArcAngle * 0.5f));
+}
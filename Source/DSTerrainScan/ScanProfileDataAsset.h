@@ -0,0 +1,223 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ScanKinematics.h"
+#include "ScanProfileDataAsset.generated.h"
+
+
+/**
+ *	Look of the scan lines, written to the scanner MPC.
+ */
+USTRUCT(BlueprintType)
+struct FScanAppearance
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance")
+	float DistanceBetweenLines = 350.0f;
+
+	/** Thickness (in pixels) of a single scan line. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance")
+	float OutlineThickness = 1.2f;
+
+	/** Strength of the blending on the arc sides. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Arc")
+	float ArcBlendFactor = 2.5f;
+
+	/**
+	 * Starting point of the edge gradient as a percentage relative to the scan origin (a value of 0 means
+	 * that the gradient touches the origin and the scan cone is fully covered, and so on).
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Edge Gradient")
+	float EdgeGradientStart = 0.85f;
+
+	/** Strength of the blending of the edge gradient effect. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Edge Gradient")
+	float EdgeGradientFalloff = 2.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Dark Circle")
+	float DarkCircleSize = 800.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors")
+	FColor ScanLinesColor{219,249,255};
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors")
+	FColor FirstLineColor = FColor::White;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors")
+	FColor EdgeGradientStartColor{23,0,255};
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors")
+	FColor EdgeGradientEndColor{181, 216, 255};
+};
+
+
+/**
+ *	Settings of the scan icons system, see UScannerIconsControllerComponent::IconsSettings.
+ */
+USTRUCT(BlueprintType)
+struct FScanIconsSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grid Settings")
+	int32 GridX = 75;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grid Settings")
+	int32 GridY = 140;
+
+	/** Distance between the icons from each other in the grid. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grid Settings")
+	float Padding = 60.0f;
+
+	/** Vertical offset of the icon from the terrain. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Grid Settings")
+	float ZOffset = 40.0f;
+
+	/**
+	 * Maximum slope of regular terrain, derived from normals. Keep in mind
+	 * that a value of 1.0 means a perfectly flat surface, and a value of 0.0
+	 * a perpendicular surface, i.e. fully vertical, for example a wall.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thresholds")
+	float RegularTerrainThreshold = 0.8f;
+
+	/** Maximum slope of steep terrain. See RegularTerrainThreshold for more info. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thresholds")
+	float SteepTerrainThreshold = 0.7f;
+
+	/** Maximum water depth (in Unreal Units) for shallow water. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thresholds")
+	float ShallowWaterThreshold = 100.0f;
+
+	/** Maximum water depth (in Unreal Units) for deep water. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Thresholds")
+	float DeepWaterThreshold = 500.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite Sizes")
+	float DefaultSize = 2.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite Sizes")
+	float DangerIconSize = 10.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite Sizes")
+	float WaterIconsSize = 10.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite Sizes")
+	float RockyIconsSize = 10.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite Sizes")
+	float VegetationIconsSize = 10.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite Sizes")
+	float PathIconsSize = 10.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sprite Sizes")
+	float FlareSize = 750.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Colors")
+	FColor IconBlue{64,206,229};
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Colors")
+	FColor IconYellow{237, 223, 66};
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Colors")
+	FColor IconRed{220, 45, 67};
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Colors")
+	FColor IconGreen{68, 151, 53};
+
+	/** Each cycle consists of a single reveal-fade animation. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Opacity Animation")
+	int32 TotalAnimationCycles = 2;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Opacity Animation")
+	float OpacityAnimationSpeed = 2000.0f;
+
+	/** Strength of the fade step. With lower values you get a sharper animation. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Opacity Animation")
+	float FadeIntensityFactor = 4000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Opacity Animation")
+	float DangerIconFadeoutTime = 5.0f;
+
+	/** How much space before the scan edge (in Unreal Units) the red icons show up in the effect. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Opacity Animation")
+	float DangerIconAppearOffset = 2000.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Flare Animation")
+	float FlareAnimationDuration = 0.35f;
+
+	float IconsAreaX() const { return (GridX - 1) * Padding; }
+
+	float IconsAreaY() const { return (GridY - 1) * Padding; }
+
+	float MaxEffectDistance() const { return FMath::Sqrt(FMath::Pow(IconsAreaX(), 2.f) + FMath::Pow(IconsAreaY() / 2, 2.f)); }
+
+	float RevealAnimationDuration() const { return MaxEffectDistance() / OpacityAnimationSpeed; }
+
+	float FadeAnimationDuration() const { return (MaxEffectDistance() + FadeIntensityFactor) / OpacityAnimationSpeed; }
+
+	/** Duration of the whole icons effect, from the scan start. */
+	float ComputeTotalEffectDuration() const;
+
+	/** True if both use the same grid, i.e. the same render targets and particle count. */
+	bool HasSameGrid(const FScanIconsSettings& Other) const;
+};
+
+
+/**
+ *	Scan tuning shared by any number of scanners, see UScannerControllerComponent::ScanProfile and
+ *	UScannerIconsControllerComponent::ScanProfile. Values derived from the settings are computed once,
+ *	when the asset is loaded or edited, so that switching profile costs a pointer swap and one upload.
+ *
+ *	Not called UScanProfile: UHT drops the prefixes, and the name would clash with FScanProfile.
+ */
+UCLASS(BlueprintType)
+class DSTERRAINSCAN_API UScanProfileDataAsset : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Read-only at runtime: the derived values are not recomputed. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scanner")
+	FScanProfile Scan;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scanner")
+	FScanAppearance Appearance;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Icons")
+	FScanIconsSettings Icons;
+
+	virtual void PostInitProperties() override;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/** Evaluator of Scan.Kinematics, ready to be copied by a starting scan. */
+	const FScanKinematics& GetKinematics() const { return Kinematics; }
+
+	float GetScannerFinalRange() const { return Kinematics.GetFinalRange(); }
+
+	float GetTotalScanDuration() const { return Kinematics.GetTotalDuration(); }
+
+	float GetTotalEffectDuration() const { return TotalEffectDuration; }
+
+	/** Cosine of half Scan.ArcAngle, as tested by the scan area queries. */
+	float GetCosHalfAngle() const { return CosHalfAngle; }
+
+private:
+
+	void UpdateDerivedValues();
+
+	FScanKinematics Kinematics;
+
+	float TotalEffectDuration = 0.0f;
+
+	float CosHalfAngle = 1.0f;
+};
@@ -8,6 +8,7 @@
 #include "ScannerControllerComponent.h"
 #include "ScannerIconsControllerComponent.h"
 #include "FootprintControllerComponent.h"
+#include "ScanEventRecorderComponent.h"
 #include "DrawDebugHelpers.h"
 
 AScannerCharacter::AScannerCharacter()
@@ -48,6 +49,8 @@ AScannerCharacter::AScannerCharacter()
 	ScannerIconsController = CreateDefaultSubobject<UScannerIconsControllerComponent>(TEXT("IconsController"));
 
 	FootprintController = CreateDefaultSubobject<UFootprintControllerComponent>(TEXT("FootprintController"));
+
+	ScanEventRecorder = CreateDefaultSubobject<UScanEventRecorderComponent>(TEXT("ScanEventRecorder"));
 	
 	/* Note: The skeletal mesh and anim blueprint references on the Mesh component (inherited from Character) 
 	are set in the derived blueprint asset named ScannerCharacter (to avoid direct content references in C++). */
@@ -56,6 +59,18 @@ AScannerCharacter::AScannerCharacter()
 void AScannerCharacter::BeginPlay()
 {
 	Super::BeginPlay();
+
+	if (IsValid(ScannerController))
+	{
+		ScannerController->OnScanStarted.AddUObject(this, &AScannerCharacter::HandleScanStarted);
+	}
+}
+
+void AScannerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (IsValid(ScannerController)) ScannerController->OnScanStarted.RemoveAll(this);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AScannerCharacter::Tick(float DeltaTime)
@@ -133,18 +148,31 @@ void AScannerCharacter::Look(const FInputActionValue& Value)
 
 void AScannerCharacter::Scan()
 {
+	// The log drives the scanner during a replay.
+	if (ScanEventRecorder && ScanEventRecorder->IsReplaying()) return;
+
 	if (IsValid(ScannerController) && IsValid(ScannerIconsController))
 	{
-		if (ScannerController->GetCurrentFrameScannerState().AnimationState != EScannerAnimationState::Inactive)
+		if (!ScannerController->CanStartScan())
 		{
 			return;
 		}
 
+		// Icons and footprints follow from HandleScanStarted, once the scan actually starts.
 		if (bScannerActive)
+		{
 			ScannerController->StartScannerLifecycle();
-		if (bIconsActive)
-			ScannerIconsController->StartIconsLifecycle();
-		if (bFootprintsActive)
-			FootprintController->StartFootprintsLifecycle();
+			return;
+		}
+
+		HandleScanStarted(ScannerController->GetCurrentFrameScannerState());
 	}
 }
+
+void AScannerCharacter::HandleScanStarted(const FScannerState& State)
+{
+	if (bIconsActive && IsValid(ScannerIconsController))
+		ScannerIconsController->StartIconsLifecycle();
+	if (bFootprintsActive && IsValid(FootprintController))
+		FootprintController->StartFootprintsLifecycle();
+}
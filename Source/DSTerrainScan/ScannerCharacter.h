@@ -11,6 +11,7 @@ class UInputMappingContext;
 class UInputAction;
 class UScannerControllerComponent;
 class UScannerIconsControllerComponent;
+class UScanEventRecorderComponent;
 struct FInputActionValue;
 struct FScannerState;
 enum class EFootstepType : uint8;
@@ -70,6 +71,11 @@ private: /* Blueprint-exposed parameters*/
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Footprints", meta = (AllowPrivateAccess = "true"))
 	bool bFootprintsActive = true;
 
+
+	/** Records or replays the scanner events of a session, disabled by default. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Recording", meta = (AllowPrivateAccess = "true"))
+	TObjectPtr<UScanEventRecorderComponent> ScanEventRecorder;
+
 public:
 	
 	/**
@@ -88,6 +94,14 @@ public:
 
 protected:
 	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/**
+	 * Starts the icons and footprints of a scan. Bound to the scanner, so that scans started by
+	 * the server or by a replay show them too.
+	 */
+	void HandleScanStarted(const FScannerState& State);
 	
 	virtual void Tick(float DeltaTime) override;
     	
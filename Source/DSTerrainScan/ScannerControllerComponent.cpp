@@ -1,246 +1,486 @@
 ﻿#include "ScannerControllerComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
 #include "Materials/MaterialParameterCollection.h"
-#include "Materials/MaterialParameterCollectionInstance.h"
+#include "Net/UnrealNetwork.h"
+#include "ScanProfileDataAsset.h"
+#include "TerrainScanCustomVersion.h"
+#include "TerrainScanMPCSubsystem.h"
+#include "TerrainScanPoolSubsystem.h"
+#include "TerrainScanStats.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "UObject/CoreNet.h"
+
+void FScanStartPacket::SetRotation(const FRotator& Rotation)
+{
+	Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+}
+
+FRotator FScanStartPacket::GetRotation() const
+{
+	return FRotator{FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.0f};
+}
+
+int32 FScanStartPacket::GetNumBits() const
+{
+	FScanStartPacket Copy = *this;
+	FNetBitWriter Writer{128};
+	bool bSuccess = true;
+	Copy.NetSerialize(Writer, nullptr, bSuccess);
+	return static_cast<int32>(Writer.GetNumBits());
+}
+
+bool FScanStartPacket::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = Origin.NetSerialize(Ar, Map, bOutSuccess);
+	Ar << Yaw;
+	Ar << Pitch;
+	Ar << ServerStartTime;
+
+	// A single bit for scans using the scanner settings.
+	uint8 bProfile = bHasProfile ? 1 : 0;
+	Ar.SerializeBits(&bProfile, 1);
+	bHasProfile = bProfile != 0;
+
+	if (bHasProfile)
+	{
+		FScanProfile::StaticStruct()->SerializeBin(Ar, &Profile);
+	}
+
+	return true;
+}
+
 
 UScannerControllerComponent::UScannerControllerComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
-	PrimaryComponentTick.SetTickFunctionEnable(true);
+
+	// Ticks only while a scan is running, see StartScanLocally.
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// Only scan starts are replicated, through RPCs. The scan itself is simulated on every machine.
+	SetIsReplicatedByDefault(true);
 }
 
 void UScannerControllerComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	CurrentScannerState.Angle = MakeScanProfile().ArcAngle;
+	CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(CurrentScannerState.Angle * 0.5f));
+
 	if (!MPC) return;
 
-	// Initializes the scanner by setting starting and default parameters.
-	if (UMaterialParameterCollectionInstance* MPCInstance = GetWorld()->GetParameterCollectionInstance(MPC))
+	if (UTerrainScanMPCSubsystem* MPCSubsystem = GetWorld()->GetSubsystem<UTerrainScanMPCSubsystem>())
 	{
-		MPCInstance->SetScalarParameterValue(TEXT("_Terrain_Scan_Range"), 0.0f);
-		MPCInstance->SetScalarParameterValue(TEXT("_Effect_Opacity"), 0.0f);
-		MPCInstance->SetScalarParameterValue(TEXT("_Dark_Circle_Range"), 0.0f);
-
-		MPCInstance->SetScalarParameterValue(TEXT("_Distance_Between_Scan_Lines"), DistanceBetweenLines);
-		MPCInstance->SetScalarParameterValue(TEXT("_Outline_Thickness"), OutlineThickness);
-		MPCInstance->SetScalarParameterValue(TEXT("_Terrain_Scan_Arc_Angle"), ArcAngle);
-		CurrentScannerState.Angle = ArcAngle;
-		MPCInstance->SetScalarParameterValue(TEXT("_Terrain_Scan_Arc_Blend_Factor"), ArcBlendFactor);
-		MPCInstance->SetScalarParameterValue(TEXT("_Edge_Gradient_Start"), EdgeGradientStart);
-		MPCInstance->SetScalarParameterValue(TEXT("_Edge_Gradient_Falloff"), EdgeGradientFalloff);
-		MPCInstance->SetScalarParameterValue(TEXT("_Dark_Circle_Size"), DarkCircleSize);
-
-		MPCInstance->SetVectorParameterValue(TEXT("_Terrain_Scan_Color"),
-			FLinearColor::FromSRGBColor(ScanLinesColor));
-		MPCInstance->SetVectorParameterValue(TEXT("_First_Line_Color"),
-			FLinearColor::FromSRGBColor(FirstLineColor));
-		MPCInstance->SetVectorParameterValue(TEXT("_Edge_Gradient_Color_Start"),
-			FLinearColor::FromSRGBColor(EdgeGradientStartColor));
-		MPCInstance->SetVectorParameterValue(TEXT("_Edge_Gradient_Color_End"),
-			FLinearColor::FromSRGBColor(EdgeGradientEndColor));
+		MPCBlock = MPCSubsystem->GetBlock(MPC);
 	}
+
+	if (UTerrainScanPoolSubsystem* ScanPool = GetWorld()->GetSubsystem<UTerrainScanPoolSubsystem>())
+	{
+		ScanPool->SetParameterCollection(MPC);
+		ScanPool->BindPostProcessMaterial(PostProcessMaterial, ScanDataParameter);
+	}
+
+	// Initializes the scanner by setting starting and default parameters. Through the block: its first
+	// flush writes every parameter, and would overwrite values set on the instance directly.
+	if (MPCBlock)
+	{
+		MPCBlock->SetScalar(ETerrainScanScalar::TerrainScanRange, 0.0f);
+		MPCBlock->SetScalar(ETerrainScanScalar::EffectOpacity, 0.0f);
+		MPCBlock->SetScalar(ETerrainScanScalar::DarkCircleRange, 0.0f);
+	}
+
+	UploadProfileParameters();
+}
+
+void UScannerControllerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTerrainScanPoolSubsystem* ScanPool = GetWorld()->GetSubsystem<UTerrainScanPoolSubsystem>())
+	{
+		for (const FTerrainScanHandle& Handle : PoolScans)
+		{
+			ScanPool->RemoveScan(Handle);
+		}
+	}
+	PoolScans.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UScannerControllerComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UScannerControllerComponent, ScanProfile);
+}
+
+void UScannerControllerComponent::Serialize(FArchive& Ar)
+{
+	Ar.UsingCustomVersion(FTerrainScanCustomVersion::GUID);
+
+	Super::Serialize(Ar);
+
+#if WITH_EDITORONLY_DATA
+	if (Ar.IsLoading())
+	{
+		const bool bUpgrade = Ar.CustomVer(FTerrainScanCustomVersion::GUID) < FTerrainScanCustomVersion::EmbeddedComponentSettings;
+		FTerrainScanCustomVersion::SyncDeprecatedSettings(this, FScanProfile::StaticStruct(), &ScanSettings, bUpgrade);
+		FTerrainScanCustomVersion::SyncDeprecatedSettings(this, FScanKinematicsParams::StaticStruct(),
+			&ScanSettings.Kinematics, bUpgrade);
+		FTerrainScanCustomVersion::SyncDeprecatedSettings(this, FScanAppearance::StaticStruct(), &Appearance, bUpgrade);
+	}
+#endif
+}
+
+void UScannerControllerComponent::SetScanProfile(UScanProfileDataAsset* NewProfile)
+{
+	if (ScanProfile == NewProfile) return;
+
+	ScanProfile = NewProfile;
+	UploadProfileParameters();
+}
+
+void UScannerControllerComponent::OnRep_ScanProfile()
+{
+	UploadProfileParameters();
+}
+
+void UScannerControllerComponent::UploadProfileParameters()
+{
+	if (!MPCBlock) return;
+
+	const FScanAppearance& Current = GetScanAppearance();
+
+	MPCBlock->SetScalar(ETerrainScanScalar::TerrainScanArcAngle, MakeScanProfile().ArcAngle);
+	MPCBlock->SetScalar(ETerrainScanScalar::DistanceBetweenScanLines, Current.DistanceBetweenLines);
+	MPCBlock->SetScalar(ETerrainScanScalar::OutlineThickness, Current.OutlineThickness);
+	MPCBlock->SetScalar(ETerrainScanScalar::ArcBlendFactor, Current.ArcBlendFactor);
+	MPCBlock->SetScalar(ETerrainScanScalar::EdgeGradientStart, Current.EdgeGradientStart);
+	MPCBlock->SetScalar(ETerrainScanScalar::EdgeGradientFalloff, Current.EdgeGradientFalloff);
+	MPCBlock->SetScalar(ETerrainScanScalar::DarkCircleSize, Current.DarkCircleSize);
+
+	MPCBlock->SetVector(ETerrainScanVector::TerrainScanColor, FLinearColor::FromSRGBColor(Current.ScanLinesColor));
+	MPCBlock->SetVector(ETerrainScanVector::FirstLineColor, FLinearColor::FromSRGBColor(Current.FirstLineColor));
+	MPCBlock->SetVector(ETerrainScanVector::EdgeGradientColorStart,
+		FLinearColor::FromSRGBColor(Current.EdgeGradientStartColor));
+	MPCBlock->SetVector(ETerrainScanVector::EdgeGradientColorEnd,
+		FLinearColor::FromSRGBColor(Current.EdgeGradientEndColor));
 }
 
 void UScannerControllerComponent::TickComponent(float DeltaTime, ELevelTick TickType,
                                                 FActorComponentTickFunction* ThisTickFunction)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_ScannerTick);
 
-	if (!MPC) return;
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
 	// Avoids subsequent, unmeaningful updates to the Inactive state
 	if (CurrentScannerState.AnimationState == EScannerAnimationState::Inactive)
 	{
+		SetComponentTickEnabled(false);
 		return;
 	}
 
-	CurrentScannerState.ElapsedTime += DeltaTime;
+	// Sample the lifecycle at the absolute time since start, so the result does not depend on frame rate.
+	ApplyKinematicsSample(SampleScanAt(GetWorld()->GetTimeSeconds()));
 
-	// If conditions are met, switch to the successive state
-	switch (CurrentScannerState.AnimationState)
+	// The final state is written, nothing changes until the next scan.
+	if (CurrentScannerState.AnimationState == EScannerAnimationState::Inactive)
 	{
-		// Spawning -> Prewarm
-		case EScannerAnimationState::Spawning:
-			if (CurrentScannerState.ElapsedTime >= SpawnAnimationDuration)
-			{
-				CurrentScannerState.ElapsedTime -= SpawnAnimationDuration;
-				CurrentScannerState.AnimationState = EScannerAnimationState::Prewarm;
-			}
-			break;
-
-		// Prewarm -> Expanding
-		case EScannerAnimationState::Prewarm:
-			if (CurrentScannerState.ElapsedTime >= PrewarmAnimationDuration)
-			{
-				CurrentScannerState.ElapsedTime -= PrewarmAnimationDuration;
-				CurrentScannerState.AnimationState = EScannerAnimationState::Expanding;
-			}
-			break;
-
-		// Expanding -> Inactive
-		case EScannerAnimationState::Expanding:
-			if (CurrentScannerState.ElapsedTime >= ExpansionAnimationDuration)
-			{
-				CurrentScannerState.AnimationState = EScannerAnimationState::Inactive;
-			}
-			break;
-
-		default: return;
+		SetComponentTickEnabled(false);
 	}
-
-	UpdateScanSpeedAndRange(DeltaTime);
-	
-	UpdateScanOpacity(DeltaTime);
 }
 
 void UScannerControllerComponent::StartScannerLifecycle()
 {
-	if (!IsValid(MPC)) return;
-	
-	// Scanner should be previously inactive
-	if (CurrentScannerState.AnimationState != EScannerAnimationState::Inactive)
+	StartScannerLifecycleAt(GetOwner()->GetActorLocation(), GetOwnerViewRotation());
+}
+
+void UScannerControllerComponent::StartScannerLifecycleAt(const FVector& Origin, const FRotator& Rotation)
+{
+	RequestScan(Origin, Rotation, nullptr);
+}
+
+void UScannerControllerComponent::StartScannerLifecycleWithProfile(const FVector& Origin, const FRotator& Rotation,
+	const FScanProfile& Profile)
+{
+	RequestScan(Origin, Rotation, &Profile);
+}
+
+void UScannerControllerComponent::StartScannerLifecycleLocally(const FVector& Origin, const FRotator& Rotation)
+{
+	if (!CanStartScan()) return;
+
+	StartScanLocally(Origin, Rotation, nullptr, GetWorld()->GetTimeSeconds());
+}
+
+FScanProfile UScannerControllerComponent::MakeScanProfile() const
+{
+	return ScanProfile ? ScanProfile->Scan : ScanSettings;
+}
+
+void UScannerControllerComponent::RequestScan(const FVector& Origin, const FRotator& Rotation,
+	const FScanProfile* Profile)
+{
+	if (!CanStartScan()) return;
+
+	if (GetNetMode() == NM_Standalone)
 	{
+		StartScanLocally(Origin, Rotation, Profile, GetWorld()->GetTimeSeconds());
 		return;
 	}
 
-	// Set spawn state
-	CurrentScannerState.AnimationState = EScannerAnimationState::Spawning;
-	CurrentScannerState.ElapsedTime = 0.0f;
-	CurrentScannerState.StartTime = GetWorld()->GetTimeSeconds();
-	CurrentScannerState.Range = SpawnInitialRange;
-	CurrentScannerState.Speed = SpawnInitialSpeed;
-	
-	CurrentScannerState.Origin = GetOwner()->GetActorLocation();
+	FScanStartPacket Packet;
+	Packet.Origin = Origin;
+	Packet.SetRotation(Rotation);
+	Packet.bHasProfile = Profile != nullptr;
+	if (Profile) Packet.Profile = *Profile;
 
-	APlayerCameraManager* CameraManager = GetWorld()->GetFirstPlayerController()->PlayerCameraManager;
-	CurrentScannerState.Rotation = CameraManager->GetCameraRotation();
-	
-	// Note that this code assumes the owner to be the player character.
-	// To generalize it for any character, one would need to find some
-	// way to get its internal camera rotation.
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		StartScanOnServer(Packet);
+	}
+	else if (GetOwnerRole() == ROLE_AutonomousProxy)
+	{
+		if (Profile)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: scans with a custom profile can only be started by the server."),
+				*GetOwner()->GetName());
+			return;
+		}
+
+		// Nothing is shown until the server answers, so that every machine runs the same scan.
+		ServerStartScan(Packet);
+	}
+}
+
+void UScannerControllerComponent::ServerStartScan_Implementation(const FScanStartPacket& Packet)
+{
+	if (!CanStartScan()) return;
 
-	if (UMaterialParameterCollectionInstance* MPCInstance = GetWorld()->GetParameterCollectionInstance(MPC))
+	// Profiles are not checked, and could hold any speed or duration: clients use the scanner settings.
+	if (Packet.bHasProfile)
 	{
-		MPCInstance->SetVectorParameterValue(TEXT("_Terrain_Scan_Origin"), CurrentScannerState.Origin);
-		MPCInstance->SetVectorParameterValue(TEXT("_Terrain_Scan_Direction"),
-			CurrentScannerState.Rotation.Vector());
+		UE_LOG(LogTemp, Warning, TEXT("%s: client scan request with a custom profile, rejected."),
+			*GetOwner()->GetName());
+		return;
+	}
+
+	// The client only proposes an origin: it must lie around its character as the server sees it.
+	FScanStartPacket CheckedPacket = Packet;
+	const FVector OwnerLocation = GetOwner()->GetActorLocation();
+	const FVector Offset = FVector{Packet.Origin} - OwnerLocation;
+
+	if (Offset.SizeSquared() > FMath::Square(MaxClientOriginError))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: client scan origin %.0f units away from the character, clamped."),
+			*GetOwner()->GetName(), Offset.Size());
+		CheckedPacket.Origin = OwnerLocation + Offset.GetClampedToMaxSize(MaxClientOriginError);
 	}
+
+	StartScanOnServer(CheckedPacket);
 }
 
-constexpr float UScannerControllerComponent::GetScannerFinalRange() const
+void UScannerControllerComponent::StartScanOnServer(FScanStartPacket Packet)
 {
-	// For each phase, range is either constant or a linear growth function
-	return SpawnInitialRange
-	+ SpawnAnimationDuration * ((SpawnInitialSpeed + PrewarmSpeed) / 2)
-	+ PrewarmAnimationDuration * PrewarmSpeed
-	+ ExpansionMaxSpeedDuration * ((PrewarmSpeed + ExpansionMaxSpeed) / 2)
-	+ (ExpansionAnimationDuration - ExpansionMaxSpeedDuration) * ((ExpansionMaxSpeed + ExpansionFinalSpeed) / 2);
-} 
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	Packet.ServerStartTime = static_cast<float>(GameState ? GameState->GetServerWorldTimeSeconds()
+		: GetWorld()->GetTimeSeconds());
+
+	const int32 NumBits = Packet.GetNumBits();
+	INC_DWORD_STAT(STAT_TerrainScan_NetScanStarts);
+	INC_DWORD_STAT_BY(STAT_TerrainScan_NetScanBits, NumBits);
+	UE_LOG(LogTemp, Verbose, TEXT("%s: replicating scan start, %d bits."), *GetOwner()->GetName(), NumBits);
+
+	MulticastStartScan(Packet);
+}
 
-void UScannerControllerComponent::UpdateScanSpeedAndRange(float DeltaTime)
+void UScannerControllerComponent::MulticastStartScan_Implementation(const FScanStartPacket& Packet)
 {
-	if (DeltaTime > CurrentScannerState.ElapsedTime) 
+	const double LocalTime = GetWorld()->GetTimeSeconds();
+	double StartTime = LocalTime;
+
+	// The server time is converted to the local clock. Late packets start the scan in the past, and the
+	// kinematics catch up at the first tick.
+	if (const AGameStateBase* GameState = GetWorld()->GetGameState())
 	{
-		// Part of DeltaTime passed at the previous speed value.
-		// Add that value before changing speed.
-		CurrentScannerState.Range += (DeltaTime - CurrentScannerState.ElapsedTime) * CurrentScannerState.Speed;
+		const double ServerToLocal = LocalTime - GameState->GetServerWorldTimeSeconds();
+		StartTime = FMath::Min(Packet.ServerStartTime + ServerToLocal, LocalTime);
 	}
-	
-	switch (CurrentScannerState.AnimationState)
+
+	// The server runs the quantized values as well, so that it agrees with the clients.
+	StartScanLocally(Packet.Origin, Packet.GetRotation(), Packet.bHasProfile ? &Packet.Profile : nullptr, StartTime);
+}
+
+void UScannerControllerComponent::StartScanLocally(const FVector& Origin, const FRotator& Rotation,
+	const FScanProfile* Profile, double StartTime)
+{
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_StartScanner);
+
+	// Set spawn state. A profile asset has everything precomputed, only custom profiles are evaluated here.
+	if (Profile)
 	{
-		case EScannerAnimationState::Spawning:
-			CurrentScannerState.Speed = FMath::Lerp(SpawnInitialSpeed, PrewarmSpeed,
-				FMath::Clamp(CurrentScannerState.ElapsedTime / SpawnAnimationDuration, 0.0f, 1.0f));
-			break;
-		
-		case EScannerAnimationState::Prewarm:
-			break; // Leave speed as it is
-		
-		case EScannerAnimationState::Expanding:
-			// Accelerate and then slow down
-			if (CurrentScannerState.ElapsedTime <= ExpansionMaxSpeedDuration)
-			{
-				CurrentScannerState.Speed = FMath::Lerp(PrewarmSpeed, ExpansionMaxSpeed,
-					FMath::Clamp(CurrentScannerState.ElapsedTime / ExpansionMaxSpeedDuration, 0.0f, 1.0f));
-			}
-			else
-			{
-				float DecelerationProgress = (CurrentScannerState.ElapsedTime - ExpansionMaxSpeedDuration) /
-					(ExpansionAnimationDuration - ExpansionMaxSpeedDuration);
-
-				CurrentScannerState.Speed = FMath::Lerp(ExpansionMaxSpeed, ExpansionFinalSpeed, FMath::Clamp(
-					DecelerationProgress, 0.0f, 1.0f));
-			}
-			break;
-
-		case EScannerAnimationState::Inactive:
-		default:
-			CurrentScannerState.Speed = 0.0f;
-			break;
+		Kinematics = FScanKinematics(Profile->Kinematics);
+		CurrentScannerState.Angle = Profile->ArcAngle;
+		CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(Profile->ArcAngle * 0.5f));
 	}
-
-	// As per the first comment above...
-	if (DeltaTime > CurrentScannerState.ElapsedTime)
+	else if (ScanProfile)
 	{
-		CurrentScannerState.Range += CurrentScannerState.ElapsedTime * CurrentScannerState.Speed;
+		Kinematics = ScanProfile->GetKinematics();
+		CurrentScannerState.Angle = ScanProfile->Scan.ArcAngle;
+		CosHalfAngle = ScanProfile->GetCosHalfAngle();
 	}
 	else
 	{
-		CurrentScannerState.Range += DeltaTime * CurrentScannerState.Speed;
+		Kinematics = FScanKinematics(ScanSettings.Kinematics);
+		CurrentScannerState.Angle = ScanSettings.ArcAngle;
+		CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(ScanSettings.ArcAngle * 0.5f));
 	}
 
-	if (UMaterialParameterCollectionInstance* MPCInstance = GetWorld()->GetParameterCollectionInstance(MPC))
+	bHasStartedScan = true;
+	SetComponentTickEnabled(true);
+
+	CurrentScannerState.StartTime = StartTime;
+	ApplyKinematicsSample(SampleScanAt(GetWorld()->GetTimeSeconds()));
+	
+	CurrentScannerState.Origin = Origin;
+	CurrentScannerState.Rotation = Rotation;
+
+	if (MPCBlock)
+	{
+		MPCBlock->SetVector(ETerrainScanVector::TerrainScanOrigin, CurrentScannerState.Origin);
+		MPCBlock->SetVector(ETerrainScanVector::TerrainScanDirection, CurrentScannerState.Rotation.Vector());
+		MPCBlock->SetScalar(ETerrainScanScalar::TerrainScanArcAngle, CurrentScannerState.Angle);
+
+		// Listeners capture the scene right away, before the subsystem flush of this frame.
+		MPCBlock->Flush();
+	}
+
+	// The pool renders this scan alongside any other one still running, scanners without a collection are not drawn.
+	UTerrainScanPoolSubsystem* ScanPool = MPC ? GetWorld()->GetSubsystem<UTerrainScanPoolSubsystem>() : nullptr;
+	if (ScanPool)
 	{
-		MPCInstance->SetScalarParameterValue(TEXT("_Terrain_Scan_Range"), CurrentScannerState.Range);
+		// Without overlaps, e.g. a start replicated before the local scan ended, the new scan replaces the old one.
+		PoolScans.RemoveAll([this, ScanPool](const FTerrainScanHandle& Handle)
+		{
+			if (!bAllowOverlappingScans) ScanPool->RemoveScan(Handle);
+			return !ScanPool->IsScanActive(Handle);
+		});
+
+		PoolScans.Add(ScanPool->AddScan(CurrentScannerState.Origin, CurrentScannerState.Rotation,
+			CurrentScannerState.Angle, CurrentScannerState.StartTime, Kinematics));
 	}
+
+	OnScanStarted.Broadcast(CurrentScannerState);
+}
+
+bool UScannerControllerComponent::CanStartScan() const
+{
+	// Without overlapping scans, the scanner should be previously inactive
+	return bAllowOverlappingScans || CurrentScannerState.AnimationState == EScannerAnimationState::Inactive;
 }
 
-void UScannerControllerComponent::UpdateScanOpacity(float DeltaTime)
+FBox2D UScannerControllerComponent::GetScanAreaBounds(float MaxRange) const
 {
-	switch (CurrentScannerState.AnimationState)
+	const FVector2D Origin{CurrentScannerState.Origin};
+	const float Range = MaxRange < 0.0f ? GetScannerFinalRange() : MaxRange;
+	const float HalfAngle = CurrentScannerState.Angle * 0.5f;
+
+	// The direction is projected on XY, as in IsPointsInsideScanArea.
+	const FVector2D DirectionXY = FVector2D{CurrentScannerState.Rotation.Vector()}.GetSafeNormal();
+	const float Yaw = FMath::RadiansToDegrees(FMath::Atan2(DirectionXY.Y, DirectionXY.X));
+
+	const auto PointAt = [&](float AngleDegrees)
+	{
+		float Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, FMath::DegreesToRadians(AngleDegrees));
+		return Origin + FVector2D{Cos, Sin} * Range;
+	};
+
+	// Apex and arc ends, plus every axis extreme of the circle that lies on the arc.
+	FBox2D Bounds{Origin, Origin};
+	Bounds += PointAt(Yaw - HalfAngle);
+	Bounds += PointAt(Yaw + HalfAngle);
+
+	for (float AxisAngle = 0.0f; AxisAngle < 360.0f; AxisAngle += 90.0f)
 	{
-		case EScannerAnimationState::Spawning:
-			CurrentScannerState.Opacity = FMath::Lerp(0.0f, SpawnFinalOpacity,
-				FMath::Clamp(CurrentScannerState.ElapsedTime / SpawnAnimationDuration, 0.0f, 1.0f));
-			CurrentScannerState.DarkCircleOpacity = 1.0f;
-			break;
-
-		case EScannerAnimationState::Prewarm:
-			break; // Leave opacity as it is
-
-		case EScannerAnimationState::Expanding:
-			{
-				float FadeoutStartTime = ExpansionAnimationDuration - FadeoutDuration;
-				if (CurrentScannerState.ElapsedTime >= FadeoutStartTime)
-				{
-					CurrentScannerState.Opacity = FMath::Lerp(SpawnFinalOpacity, 0.0f,
-						FMath::Clamp((CurrentScannerState.ElapsedTime - FadeoutStartTime) / FadeoutDuration, 0.0f, 1.0f));
-				}
-
-				if (CurrentScannerState.ElapsedTime >= DarkCircleFadeoutDuration)
-				{
-					CurrentScannerState.DarkCircleOpacity = 1.0f - FMath::Clamp(
-						CurrentScannerState.ElapsedTime / DarkCircleFadeoutDuration, 0.0f, 1.0f);
-				}
-			}
-			break;
-
-		case EScannerAnimationState::Inactive:
-			CurrentScannerState.Opacity = 0.0f;
-			CurrentScannerState.DarkCircleOpacity = 0.0f;
-			break;
+		if (FMath::Abs(FRotator::NormalizeAxis(AxisAngle - Yaw)) <= HalfAngle)
+		{
+			Bounds += PointAt(AxisAngle);
+		}
 	}
 
-	if (UMaterialParameterCollectionInstance* MPCInstance = GetWorld()->GetParameterCollectionInstance(MPC))
+	return Bounds;
+}
+
+float UScannerControllerComponent::GetScannerFinalRange() const
+{
+	if (bHasStartedScan) return Kinematics.GetFinalRange();
+	if (ScanProfile) return ScanProfile->GetScannerFinalRange();
+
+	return FScanKinematics(ScanSettings.Kinematics).GetFinalRange();
+}
+
+float UScannerControllerComponent::GetTotalScanDuration() const
+{
+	if (bHasStartedScan) return Kinematics.GetTotalDuration();
+	if (ScanProfile) return ScanProfile->GetTotalScanDuration();
+
+	const FScanKinematicsParams& Params = ScanSettings.Kinematics;
+	return Params.SpawnAnimationDuration + Params.PrewarmAnimationDuration + Params.ExpansionAnimationDuration;
+}
+
+FScanKinematicsSample UScannerControllerComponent::SampleScanAt(double WorldTimeSeconds) const
+{
+	if (!bHasStartedScan) return FScanKinematicsSample{};
+
+	return Kinematics.Evaluate(static_cast<float>(WorldTimeSeconds - CurrentScannerState.StartTime));
+}
+
+FRotator UScannerControllerComponent::GetOwnerViewRotation() const
+{
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	if (!Pawn) return GetOwner()->GetActorRotation();
+
+	const APlayerController* PlayerController = Cast<APlayerController>(Pawn->GetController());
+	if (PlayerController && PlayerController->PlayerCameraManager)
 	{
-		MPCInstance->SetScalarParameterValue(TEXT("_Effect_Opacity"), CurrentScannerState.Opacity);
-		MPCInstance->SetScalarParameterValue(TEXT("_Dark_Circle_Opacity"), CurrentScannerState.DarkCircleOpacity);
+		return PlayerController->PlayerCameraManager->GetCameraRotation();
 	}
+
+	return Pawn->GetViewRotation();
 }
 
-constexpr float UScannerControllerComponent::GetTotalScanDuration() const
+void UScannerControllerComponent::ApplyKinematicsSample(const FScanKinematicsSample& Sample)
 {
-	return SpawnAnimationDuration + PrewarmAnimationDuration + ExpansionAnimationDuration;
+#if UE_TRACE_ENABLED
+	// Phase transitions show up as bookmarks on the Insights timeline.
+	if (Sample.AnimationState != CurrentScannerState.AnimationState && UE_TRACE_CHANNELEXPR_IS_ENABLED(TerrainScanChannel))
+	{
+		const FString Phase = StaticEnum<EScannerAnimationState>()->GetNameStringByValue(
+			static_cast<int64>(Sample.AnimationState));
+		TRACE_BOOKMARK(TEXT("TerrainScan %s"), *Phase);
+	}
+#endif
+
+	CurrentScannerState.AnimationState = Sample.AnimationState;
+	CurrentScannerState.ElapsedTime = Sample.ElapsedTime;
+	CurrentScannerState.Range = Sample.Range;
+	CurrentScannerState.Speed = Sample.Speed;
+	CurrentScannerState.Opacity = Sample.Opacity;
+	CurrentScannerState.DarkCircleOpacity = Sample.DarkCircleOpacity;
+
+	// Values are flushed to the collection once per frame by UTerrainScanMPCSubsystem.
+	if (MPCBlock)
+	{
+		MPCBlock->SetScalar(ETerrainScanScalar::TerrainScanRange, CurrentScannerState.Range);
+		MPCBlock->SetScalar(ETerrainScanScalar::EffectOpacity, CurrentScannerState.Opacity);
+		MPCBlock->SetScalar(ETerrainScanScalar::DarkCircleOpacity, CurrentScannerState.DarkCircleOpacity);
+	}
 }
 
 bool UScannerControllerComponent::IsPointInsideScanArea(const FVector& Point) const
@@ -250,7 +490,74 @@ bool UScannerControllerComponent::IsPointInsideScanArea(const FVector& Point) co
 	FVector2D ScannerDirectionVectorXY = FVector2D{CurrentScannerState.Rotation.Vector()};
 	float CosineAngleBetweenDirections = ScannerDirectionVectorXY.GetSafeNormal().Dot(
 		PointDirectionVectorXY.GetSafeNormal());
-	float HalfAngle = CurrentScannerState.Angle * 0.5f;
 
-	return CosineAngleBetweenDirections >= FMath::Cos(FMath::DegreesToRadians(HalfAngle));
+	return CosineAngleBetweenDirections >= CosHalfAngle;
+}
+
+void UScannerControllerComponent::IsPointsInsideScanArea(TConstArrayView<FVector> Points, TBitArray<>& OutResults,
+	float MaxRange) const
+{
+	const int32 NumPoints = Points.Num();
+	OutResults.Init(false, NumPoints);
+
+	const FVector& Origin = CurrentScannerState.Origin;
+	const FVector2D ScannerDirectionXY = FVector2D{CurrentScannerState.Rotation.Vector()}.GetSafeNormal();
+	const float Range = MaxRange < 0.0f ? GetScannerFinalRange() : MaxRange;
+
+	// Dot >= CosHalfAngle * Length is tested as Dot * |Dot| >= CosHalfAngle * |CosHalfAngle| * Length^2.
+	// x * |x| is monotonic, so comparing signed squares keeps the result and avoids the square roots.
+	const float SignedCosSquared = CosHalfAngle * FMath::Abs(CosHalfAngle);
+	const float RangeSquared = Range * Range;
+
+	const VectorRegister4Float DirectionX = VectorSetFloat1(static_cast<float>(ScannerDirectionXY.X));
+	const VectorRegister4Float DirectionY = VectorSetFloat1(static_cast<float>(ScannerDirectionXY.Y));
+	const VectorRegister4Float SignedCosSquaredV = VectorSetFloat1(SignedCosSquared);
+	const VectorRegister4Float RangeSquaredV = VectorSetFloat1(RangeSquared);
+	const VectorRegister4Float MinLengthSquaredV = VectorSetFloat1(UE_SMALL_NUMBER);
+
+	int32 Index = 0;
+	for (; Index + 4 <= NumPoints; Index += 4)
+	{
+		// Offsets are computed in double precision first, large world coordinates would not fit a float.
+		const FVector& P0 = Points[Index];
+		const FVector& P1 = Points[Index + 1];
+		const FVector& P2 = Points[Index + 2];
+		const FVector& P3 = Points[Index + 3];
+
+		const VectorRegister4Float X = MakeVectorRegisterFloat(
+			static_cast<float>(P0.X - Origin.X), static_cast<float>(P1.X - Origin.X),
+			static_cast<float>(P2.X - Origin.X), static_cast<float>(P3.X - Origin.X));
+		const VectorRegister4Float Y = MakeVectorRegisterFloat(
+			static_cast<float>(P0.Y - Origin.Y), static_cast<float>(P1.Y - Origin.Y),
+			static_cast<float>(P2.Y - Origin.Y), static_cast<float>(P3.Y - Origin.Y));
+
+		const VectorRegister4Float Dot = VectorMultiplyAdd(X, DirectionX, VectorMultiply(Y, DirectionY));
+		const VectorRegister4Float LengthSquared = VectorMultiplyAdd(X, X, VectorMultiply(Y, Y));
+
+		const VectorRegister4Float InsideCone = VectorCompareGE(VectorMultiply(Dot, VectorAbs(Dot)),
+			VectorMultiply(SignedCosSquaredV, LengthSquared));
+		const VectorRegister4Float InsideRange = VectorCompareLE(LengthSquared, RangeSquaredV);
+		const VectorRegister4Float NotOrigin = VectorCompareGT(LengthSquared, MinLengthSquaredV);
+
+		const int32 Mask = VectorMaskBits(VectorBitwiseAnd(InsideCone, VectorBitwiseAnd(InsideRange, NotOrigin)));
+
+		OutResults[Index] = (Mask & 1) != 0;
+		OutResults[Index + 1] = (Mask & 2) != 0;
+		OutResults[Index + 2] = (Mask & 4) != 0;
+		OutResults[Index + 3] = (Mask & 8) != 0;
+	}
+
+	// Remaining points, same test in scalar form.
+	for (; Index < NumPoints; ++Index)
+	{
+		const float X = static_cast<float>(Points[Index].X - Origin.X);
+		const float Y = static_cast<float>(Points[Index].Y - Origin.Y);
+
+		const float Dot = X * static_cast<float>(ScannerDirectionXY.X) + Y * static_cast<float>(ScannerDirectionXY.Y);
+		const float LengthSquared = X * X + Y * Y;
+
+		OutResults[Index] = Dot * FMath::Abs(Dot) >= SignedCosSquared * LengthSquared
+			&& LengthSquared <= RangeSquared
+			&& LengthSquared > UE_SMALL_NUMBER;
+	}
 }
@@ -2,21 +2,17 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "ScanKinematics.h"
+#include "ScanProfileDataAsset.h"
+#include "TerrainScanPoolSubsystem.h"
 #include "ScannerControllerComponent.generated.h"
 
 class UScannerControllerComponent;
+class UMaterialInterface;
 class UMaterialParameterCollection;
 class UScannerIconsControllerComponent;
-
-
-UENUM()
-enum class EScannerAnimationState : uint8
-{
-	Inactive,
-	Spawning,
-	Prewarm,
-	Expanding
-};
+class FTerrainScanMPCBlock;
 
 
 /**
@@ -61,6 +57,60 @@ struct FScannerState
 };
 
 
+/**
+ *	Scan start as sent over the network. Everything else about the scan is rebuilt by each machine
+ *	from the scanner settings, since the kinematics are a closed-form function of the elapsed time.
+ *	Origin is rounded to the centimeter, yaw and pitch are 16-bit each and the start time is a
+ *	float, exact to the millisecond for the first two hours of a session.
+ */
+USTRUCT()
+struct FScanStartPacket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	uint16 Yaw = 0;
+
+	UPROPERTY()
+	uint16 Pitch = 0;
+
+	/** Server world time of the scan start, see AGameStateBase::GetServerWorldTimeSeconds. */
+	UPROPERTY()
+	float ServerStartTime = 0.0f;
+
+	/** If false, every machine uses the scanner settings and no profile is sent. */
+	UPROPERTY()
+	bool bHasProfile = false;
+
+	UPROPERTY()
+	FScanProfile Profile;
+
+	void SetRotation(const FRotator& Rotation);
+
+	FRotator GetRotation() const;
+
+	/** Size of the packet on the wire, without the RPC header. */
+	int32 GetNumBits() const;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FScanStartPacket> : public TStructOpsTypeTraitsBase2<FScanStartPacket>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnScanStarted, const FScannerState&);
+
+
 UCLASS(ClassGroup=(Custom), Blueprintable, meta=(BlueprintSpawnableComponent))
 class DSTERRAINSCAN_API UScannerControllerComponent : public UActorComponent
 {
@@ -73,109 +123,125 @@ public: /* Constructor(s) */
 protected:
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private: /* Blueprint-exposed parameters */
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance", meta = (AllowPrivateAccess = "true"))
-	float DistanceBetweenLines = 350.0f;
+	/** Arc and kinematics of the scans. Only used by scanners without a ScanProfile, which replaces them. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scan", meta = (AllowPrivateAccess = "true",
+		ShowOnlyInnerProperties))
+	FScanProfile ScanSettings;
+
+	/** Look of the scan lines. Only used by scanners without a ScanProfile, which replaces it. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance", meta = (AllowPrivateAccess = "true",
+		ShowOnlyInnerProperties))
+	FScanAppearance Appearance;
+
 
 	/**
-	 * Thickness (in pixels) of a single scan line.
+	 * If true, a new scan can start while the previous one is still running. Every scan is
+	 * registered in UTerrainScanPoolSubsystem, and PostProcessMaterial draws all of them from
+	 * the pool texture. Otherwise a new scan replaces the one on screen.
 	 */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance", meta = (AllowPrivateAccess = "true"))
-	float OutlineThickness = 1.2f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Arc", meta = (AllowPrivateAccess = "true"))
-	float ArcAngle = 120.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pool", meta = (AllowPrivateAccess = "true"))
+	bool bAllowOverlappingScans = false;
 
 	/**
-	 * Strength of the blending on the arc sides.
+	 * Terrain scan post-process of the level, e.g. PPM_TerrainScan. At BeginPlay its blendables in
+	 * the post-process volumes are replaced by an instance reading the pool texture through
+	 * ScanDataParameter. The material graph has to loop over the _Terrain_Scan_Count columns of
+	 * the texture, see UTerrainScanPoolSubsystem.
 	 */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Arc", meta = (AllowPrivateAccess = "true"))
-	float ArcBlendFactor = 2.5f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pool", meta = (AllowPrivateAccess = "true"))
+	TObjectPtr<UMaterialInterface> PostProcessMaterial;
+
+	/** Texture parameter of PostProcessMaterial receiving the pool texture. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Pool", meta = (AllowPrivateAccess = "true"))
+	FName ScanDataParameter = TEXT("ScanData");
 
 	/**
-	 * Starting point of the edge gradient as a percentage relative to the scan origin (a value of 0 means
-	 * that the gradient touches the origin and the scan cone is fully covered, and so on).
+	 * Maximum distance (in Unreal Units) between the scan origin requested by a client and the
+	 * location of its character on the server. Farther origins are pulled back to this distance,
+	 * so a client cannot scan areas it is not in.
 	 */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Edge Gradient", meta = (AllowPrivateAccess = "true"))
-	float EdgeGradientStart = 0.85f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Network", meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+	float MaxClientOriginError = 300.0f;
 
 	/**
-	 * Strength of the blending of the edge gradient effect.
+	 * Tuning shared with other scanners. If set, it replaces ScanSettings and Appearance. Replicated,
+	 * so that every machine simulates scans with the same profile.
 	 */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Edge Gradient", meta = (AllowPrivateAccess = "true"))
-	float EdgeGradientFalloff = 2.5f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, ReplicatedUsing = OnRep_ScanProfile, Category = "Profile", meta = (AllowPrivateAccess = "true"))
+	TObjectPtr<UScanProfileDataAsset> ScanProfile;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Dark Circle", meta = (AllowPrivateAccess = "true"))
-	float DarkCircleSize = 800.0f;
 	
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor ScanLinesColor{219,249,255};
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor FirstLineColor = FColor::White;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor EdgeGradientStartColor{23,0,255};
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Appearance|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor EdgeGradientEndColor{181, 216, 255};
+public:
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
+	                           FActorComponentTickFunction* ThisTickFunction) override;
 	
+	/**
+	 *	Starts the scan process from this component's parent
+	 *	world position and facing direction.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void StartScannerLifecycle();
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations", meta = (AllowPrivateAccess = "true"))
-	float SpawnAnimationDuration = 0.2f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations", meta = (AllowPrivateAccess = "true"))
-	float PrewarmAnimationDuration = 0.3f;
+	/**
+	 * Starts the scan process from the given world position and facing direction, with the
+	 * settings of this component.
+	 * In a networked game the server decides: clients send the request to it, and the
+	 * server starts the scan on every machine at the same server time.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void StartScannerLifecycleAt(const FVector& Origin, const FRotator& Rotation);
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations", meta = (AllowPrivateAccess = "true"))
-	float ExpansionAnimationDuration = 2.5f;
+	/**
+	 * Same as above, with settings of its own. Works for any owner, e.g. AI or scripted scans:
+	 * nothing is looked up besides the world time, and no MPC is needed to run the scan.
+	 * In a networked game only the server may call it: clients cannot send custom profiles.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void StartScannerLifecycleWithProfile(const FVector& Origin, const FRotator& Rotation, const FScanProfile& Profile);
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations", meta = (AllowPrivateAccess = "true"))
-	float FadeoutDuration = 1.7f;
+	/**
+	 * Same as StartScannerLifecycleAt, on this machine only whatever the net mode: nothing is sent to
+	 * the server. For replays of recorded sessions, see UScanEventRecorderComponent.
+	 */
+	void StartScannerLifecycleLocally(const FVector& Origin, const FRotator& Rotation);
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Durations", meta = (AllowPrivateAccess = "true"))
-	float DarkCircleFadeoutDuration = 1.7f;
-	
+	/** Settings of this component, as used by StartScannerLifecycle(). */
+	UFUNCTION(BlueprintPure)
+	FScanProfile MakeScanProfile() const;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawn Options", meta = (AllowPrivateAccess = "true"))
-	float SpawnInitialRange = 500.0f;
+	/**
+	 * Swaps the shared tuning, see ScanProfile, and uploads its appearance. Scans already running
+	 * keep the values they started with. Null goes back to the values of the component.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetScanProfile(UScanProfileDataAsset* NewProfile);
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawn Options", meta = (AllowPrivateAccess = "true"))
-	float SpawnInitialSpeed = 2000.0f;
+	UScanProfileDataAsset* GetScanProfile() const { return ScanProfile; }
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Spawn Options", meta = (AllowPrivateAccess = "true"))
-	float SpawnFinalOpacity = 0.55f;
-	
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pre-warm Options", meta = (AllowPrivateAccess = "true"))
-	float PrewarmSpeed = 200.0f;
-	
+	virtual void Serialize(FArchive& Ar) override;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Expansion Options", meta = (AllowPrivateAccess = "true"))
-	float ExpansionMaxSpeed = 20000.0f;
+	/** Returns true if StartScannerLifecycle() would start a new scan. */
+	bool CanStartScan() const;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Expansion Options", meta = (AllowPrivateAccess = "true"))
-	float ExpansionMaxSpeedDuration = 0.3f;
+	/** Of the last scan, or of the component settings if no scan was started yet. */
+	float GetScannerFinalRange() const;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Expansion Options", meta = (AllowPrivateAccess = "true"))
-	float ExpansionFinalSpeed = 500.0f;
+	/** Of the last scan, or of the component settings if no scan was started yet. */
+	float GetTotalScanDuration() const;
 
-	
-public:
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
-	                           FActorComponentTickFunction* ThisTickFunction) override;
-	
 	/**
-	 *	Starts the scan process from this component's parent
-	 *	world position and facing direction.
+	 * Samples the current scan at an absolute world time, without touching the component state.
+	 *
+	 * @param WorldTimeSeconds world time, as returned by UWorld::GetTimeSeconds().
+	 * @return the scanner values at that time, or an inactive sample if no scan was ever started.
 	 */
-	UFUNCTION(BlueprintCallable)
-	void StartScannerLifecycle();
-
-	constexpr float GetScannerFinalRange() const;
-
-	constexpr float GetTotalScanDuration() const;
+	FScanKinematicsSample SampleScanAt(double WorldTimeSeconds) const;
 	
 	/**
 	 * Returns true if the given point lies inside the scan effect area (only angle check).
@@ -185,7 +251,27 @@ public:
 	 */
 	bool IsPointInsideScanArea(const FVector& Point) const;
 
+	/**
+	 * Batch version of IsPointInsideScanArea, which also checks the distance from the scan origin.
+	 * The cone is set up once and points are tested four at a time with SIMD registers.
+	 *
+	 * @param Points to test against the scan area.
+	 * @param OutResults receives one bit per point, set if the point lies inside.
+	 * @param MaxRange maximum XY distance from the scan origin. Negative values use GetScannerFinalRange().
+	 */
+	void IsPointsInsideScanArea(TConstArrayView<FVector> Points, TBitArray<>& OutResults, float MaxRange = -1.0f) const;
+
+	/**
+	 * XY bounding box of the scan area, the circular sector tested by IsPointsInsideScanArea.
+	 *
+	 * @param MaxRange radius of the sector. Negative values use GetScannerFinalRange().
+	 */
+	FBox2D GetScanAreaBounds(float MaxRange = -1.0f) const;
+
 	constexpr const FScannerState& GetCurrentFrameScannerState() const { return CurrentScannerState; }
+
+	/** Broadcast whenever a scan starts, with its initial state. */
+	FOnScanStarted OnScanStarted;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Parameters", meta = (AllowPrivateAccess = "true"))
 	TObjectPtr<UMaterialParameterCollection> MPC;
@@ -195,7 +281,130 @@ private: /* Class internals */
 	UPROPERTY()
 	FScannerState CurrentScannerState;
 
-	void UpdateScanSpeedAndRange(float DeltaTime);
+	/** Closed-form evaluator of the current scan, rebuilt from the tuning parameters at every scan start. */
+	FScanKinematics Kinematics;
+
+	bool bHasStartedScan = false;
+
+	/** Cosine of half the arc of the current scan. */
+	float CosHalfAngle = 1.0f;
+
+	/** Per-frame MPC values, shared with any other component writing the same collection. */
+	TSharedPtr<FTerrainScanMPCBlock> MPCBlock;
+
+	/** Scans of this component still in the pool, removed with the component. */
+	TArray<FTerrainScanHandle> PoolScans;
+
+	/** Camera rotation of the controlling player, otherwise the view rotation of the owner. */
+	FRotator GetOwnerViewRotation() const;
+
+	/** Checks the request and starts the scan, or forwards it to the server. Profile may be null. */
+	void RequestScan(const FVector& Origin, const FRotator& Rotation, const FScanProfile* Profile);
+
+	/**
+	 * Starts the scan on this machine only, at a local world time that may lie in the past.
+	 * @param Profile settings of the scan, null for the profile or values of the component.
+	 */
+	void StartScanLocally(const FVector& Origin, const FRotator& Rotation, const FScanProfile* Profile,
+		double StartTime);
+
+	/** Appearance of the profile, or of the component without one. */
+	const FScanAppearance& GetScanAppearance() const { return ScanProfile ? ScanProfile->Appearance : Appearance; }
+
+	/** Writes the appearance and arc of the profile to the MPC block, flushed with the rest of the frame. */
+	void UploadProfileParameters();
+
+	UFUNCTION()
+	void OnRep_ScanProfile();
+
+	/**
+	 * Sent by the owning client, the server checks the request and starts the scan everywhere.
+	 * Requests carrying a profile are rejected: only the server picks the settings of a scan.
+	 */
+	UFUNCTION(Server, Reliable)
+	void ServerStartScan(const FScanStartPacket& Packet);
+
+	/**
+	 * Server only: stamps the server time on a checked packet and starts the scan on every machine.
+	 * The caller checks CanStartScan().
+	 */
+	void StartScanOnServer(FScanStartPacket Packet);
+
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastStartScan(const FScanStartPacket& Packet);
+
+	void ApplyKinematicsSample(const FScanKinematicsSample& Sample);
+
+#if WITH_EDITORONLY_DATA
+	/* Settings saved before ScanSettings and Appearance, upgraded in Serialize. */
+
+	UPROPERTY()
+	float DistanceBetweenLines_DEPRECATED = 350.0f;
+
+	UPROPERTY()
+	float OutlineThickness_DEPRECATED = 1.2f;
+
+	UPROPERTY()
+	float ArcAngle_DEPRECATED = 120.0f;
+
+	UPROPERTY()
+	float ArcBlendFactor_DEPRECATED = 2.5f;
+
+	UPROPERTY()
+	float EdgeGradientStart_DEPRECATED = 0.85f;
+
+	UPROPERTY()
+	float EdgeGradientFalloff_DEPRECATED = 2.5f;
+
+	UPROPERTY()
+	float DarkCircleSize_DEPRECATED = 800.0f;
+
+	UPROPERTY()
+	FColor ScanLinesColor_DEPRECATED{219,249,255};
+
+	UPROPERTY()
+	FColor FirstLineColor_DEPRECATED = FColor::White;
 
-	void UpdateScanOpacity(float DeltaTime);
+	UPROPERTY()
+	FColor EdgeGradientStartColor_DEPRECATED{23,0,255};
+
+	UPROPERTY()
+	FColor EdgeGradientEndColor_DEPRECATED{181, 216, 255};
+
+	UPROPERTY()
+	float SpawnAnimationDuration_DEPRECATED = 0.2f;
+
+	UPROPERTY()
+	float PrewarmAnimationDuration_DEPRECATED = 0.3f;
+
+	UPROPERTY()
+	float ExpansionAnimationDuration_DEPRECATED = 2.5f;
+
+	UPROPERTY()
+	float FadeoutDuration_DEPRECATED = 1.7f;
+
+	UPROPERTY()
+	float DarkCircleFadeoutDuration_DEPRECATED = 1.7f;
+
+	UPROPERTY()
+	float SpawnInitialRange_DEPRECATED = 500.0f;
+
+	UPROPERTY()
+	float SpawnInitialSpeed_DEPRECATED = 2000.0f;
+
+	UPROPERTY()
+	float SpawnFinalOpacity_DEPRECATED = 0.55f;
+
+	UPROPERTY()
+	float PrewarmSpeed_DEPRECATED = 200.0f;
+
+	UPROPERTY()
+	float ExpansionMaxSpeed_DEPRECATED = 20000.0f;
+
+	UPROPERTY()
+	float ExpansionMaxSpeedDuration_DEPRECATED = 0.3f;
+
+	UPROPERTY()
+	float ExpansionFinalSpeed_DEPRECATED = 500.0f;
+#endif
 };
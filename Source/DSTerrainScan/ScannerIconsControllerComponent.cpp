@@ -6,6 +6,13 @@
 #include "Components/SceneCaptureComponent2D.h"
 #include "ScannerControllerComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "ScanCaptureReadback.h"
+#include "Materials/MaterialInterface.h"
+#include "TerrainScanCustomVersion.h"
+#include "TerrainScanTileCacheSubsystem.h"
+#include "TerrainScanStats.h"
+#include "ScanProfileDataAsset.h"
 
 namespace IconsTextureAtlas
 {
@@ -42,11 +49,38 @@ const TMap<ETerrainType, FIntPoint>& GetTerrainIcons()
 	return TerrainIcons;
 }
 
+/** Inverse of the octahedral normal encoding used by the packed scene capture. */
+static FVector3f DecodeOctahedralNormal(float OctX, float OctY)
+{
+	FVector3f Normal{OctX, OctY, 1.0f - FMath::Abs(OctX) - FMath::Abs(OctY)};
+
+	if (Normal.Z < 0.0f)
+	{
+		Normal.X = (1.0f - FMath::Abs(OctY)) * FMath::Sign(OctX);
+		Normal.Y = (1.0f - FMath::Abs(OctX)) * FMath::Sign(OctY);
+	}
+
+	return Normal.GetSafeNormal();
+}
+
+/** Octahedral normal encoding used by the packed scene capture. */
+static FVector2f EncodeOctahedralNormal(const FVector3f& Normal)
+{
+	const FVector3f Octahedron = Normal / (FMath::Abs(Normal.X) + FMath::Abs(Normal.Y) + FMath::Abs(Normal.Z));
+
+	if (Octahedron.Z >= 0.0f) return FVector2f{Octahedron.X, Octahedron.Y};
+
+	return FVector2f{(1.0f - FMath::Abs(Octahedron.Y)) * FMath::Sign(Octahedron.X),
+		(1.0f - FMath::Abs(Octahedron.X)) * FMath::Sign(Octahedron.Y)};
+}
+
 
 UScannerIconsControllerComponent::UScannerIconsControllerComponent()
 {
 	PrimaryComponentTick.bCanEverTick = true;
-	PrimaryComponentTick.SetTickFunctionEnable(true);
+
+	// Ticks only while an effect is in flight, see StartIconsLifecycle.
+	PrimaryComponentTick.bStartWithTickEnabled = false;
 
 	DepthSceneCapture = CreateDefaultSubobject<USceneCaptureComponent2D>("DepthSceneCapture");
 
@@ -64,6 +98,9 @@ void UScannerIconsControllerComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	CachedTotalEffectDuration = ScanProfile ? ScanProfile->GetTotalEffectDuration()
+		: IconsSettings.ComputeTotalEffectDuration();
+
 	if (!MPC) return;
 
 	if (const AActor* Player = GetOwner())
@@ -85,22 +122,19 @@ void UScannerIconsControllerComponent::BeginPlay()
 		FVector::ZeroVector,
 		FRotator::ZeroRotator);
 
-	
-	// Set grid settings.
-	IconsNiagaraComponent->SetVariableInt(TEXT("GridX"), GridX);
-	IconsNiagaraComponent->SetVariableInt(TEXT("GridY"), GridY);
-	IconsNiagaraComponent->SetVariableVec3(TEXT("Padding"), FVector{Padding, Padding, 0.0f});
-	IconsNiagaraComponent->SetVariableFloat(TEXT("ZOffset"), ZOffset);
+	// Offsets of the parameters written on every scan and tick.
+	NiagaraParameters.Bind(IconsNiagaraComponent);
 
-	// Set scan infos.
-	if (auto* MPCI = GetWorld()->GetParameterCollectionInstance(MPC))
+	
+	// The pool of particles lives as long as the component.
+	if (bPersistentParticles)
 	{
-		float Angle;
-		MPCI->GetScalarParameterValue(TEXT("_Terrain_Scan_Arc_Angle"), Angle);
-		IconsNiagaraComponent->SetVariableFloat(TEXT("HalfAngle"), Angle / 2);
+		IconsNiagaraComponent->SetAutoDestroy(false);
+		NiagaraParameters.SetInt(EScanIconsParameter::ScanGeneration, ScanGeneration);
 	}
 
-	IconsNiagaraComponent->SetVariableFloat(TEXT("ScanEndTime"), ScannerController->GetTotalScanDuration());
+	// Profile-dependent parameters: grid, thresholds, sprites and animation.
+	UploadIconSettings();
 
 	// Terrain type representation inside Niagara
 	IconsNiagaraComponent->SetVariableInt(TEXT("Regular Terrain"), static_cast<int32>(ETerrainType::Regular));
@@ -115,13 +149,6 @@ void UScannerIconsControllerComponent::BeginPlay()
 	IconsNiagaraComponent->SetVariableInt(TEXT("Vegetation Terrain"), static_cast<int32>(ETerrainType::Vegetation));
 	IconsNiagaraComponent->SetVariableInt(TEXT("Path Terrain"), static_cast<int32>(ETerrainType::Path));
 
-	// Thresholds
-	IconsNiagaraComponent->SetVariableFloat(TEXT("RegularTerrainThreshold"), RegularTerrainThreshold);
-	IconsNiagaraComponent->SetVariableFloat(TEXT("SteepTerrainThreshold"), SteepTerrainThreshold);
-
-	IconsNiagaraComponent->SetVariableFloat(TEXT("ShallowWaterThreshold"), ShallowWaterThreshold);
-	IconsNiagaraComponent->SetVariableFloat(TEXT("DeepWaterThreshold"), DeepWaterThreshold);
-
 	// Icon encodings
 	IconsNiagaraComponent->SetVariableVec2(TEXT("Regular Terrain Icon"), *GetTerrainIcons().Find(ETerrainType::Regular));
 	IconsNiagaraComponent->SetVariableVec2(TEXT("Steep Terrain Icon"), *GetTerrainIcons().Find(ETerrainType::Steep));
@@ -135,47 +162,110 @@ void UScannerIconsControllerComponent::BeginPlay()
 	IconsNiagaraComponent->SetVariableVec2(TEXT("Vegetation Icon"), *GetTerrainIcons().Find(ETerrainType::Vegetation));
 	IconsNiagaraComponent->SetVariableVec2(TEXT("Path Icon"), *GetTerrainIcons().Find(ETerrainType::Path));
 
-	// Sprite sizes
-	IconsNiagaraComponent->SetVariableVec2(TEXT("Default Size"), FVector2D{DefaultSize});
-	IconsNiagaraComponent->SetVariableVec2(TEXT("Danger Icon Size"), FVector2D{DangerIconSize});
-	IconsNiagaraComponent->SetVariableVec2(TEXT("Water Icons Size"), FVector2D{WaterIconsSize});
-	IconsNiagaraComponent->SetVariableVec2(TEXT("Flare Size"), FVector2D{FlareSize});
-	IconsNiagaraComponent->SetVariableVec2(TEXT("Rocky Icons Size"), FVector2D{RockyIconsSize});
-	IconsNiagaraComponent->SetVariableVec2(TEXT("Vegetation Icons Size"), FVector2D{VegetationIconsSize});
-	IconsNiagaraComponent->SetVariableVec2(TEXT("Path Icons Size"), FVector2D{PathIconsSize});
-
-	// Sprite colors
-	IconsNiagaraComponent->SetVariableLinearColor(TEXT("Icon Blue"), FLinearColor::FromSRGBColor(IconBlue));
-	IconsNiagaraComponent->SetVariableLinearColor(TEXT("Icon Yellow"), FLinearColor::FromSRGBColor(IconYellow));
-	IconsNiagaraComponent->SetVariableLinearColor(TEXT("Icon Red"), FLinearColor::FromSRGBColor(IconRed));
-	IconsNiagaraComponent->SetVariableLinearColor(TEXT("Icon Green"), FLinearColor::FromSRGBColor(IconGreen));
-	
-	// Opacity animation
-	IconsNiagaraComponent->SetVariableInt(TEXT("TotalAnimationCycles"), TotalAnimationCycles);
-	IconsNiagaraComponent->SetVariableFloat(TEXT("OpacityAnimationSpeed"), OpacityAnimationSpeed);
-	IconsNiagaraComponent->SetVariableFloat(TEXT("FadeAnimationWidth"), FadeIntensityFactor);
-	IconsNiagaraComponent->SetVariableFloat(TEXT("DangerIconFadeoutTime"), DangerIconFadeoutTime);
-	IconsNiagaraComponent->SetVariableFloat(TEXT("DangerIconAppearOffset"), DangerIconAppearOffset);
-
-	// Flare animation
-	IconsNiagaraComponent->SetVariableFloat(TEXT("FlareDuration"), FlareAnimationDuration);
-	
-	
 	// Setup SceneCapture(s) and target(s)
 
-	SetupSceneCaptureComponent(DepthSceneCapture, SCS_SceneDepth);
-	SetupSceneCaptureComponent(NormalsSceneCapture, SCS_Normal);
-	SetupSceneCaptureComponent(IDsSceneCapture, SCS_FinalColorLDR);
-	SetupSceneCaptureComponent(CustomDepthSceneCapture, SCS_FinalColorLDR);
+	if (CaptureMode == EScanCaptureMode::Packed)
+	{
+		SetupPackedSceneCaptureComponent();
+
+		IconsNiagaraComponent->SetVariableTexture(TEXT("PackedCaptureTexture"), PackedSceneCapture->TextureTarget);
+	}
+	else
+	{
+		SetupSceneCaptureComponent(DepthSceneCapture, SCS_SceneDepth);
+		SetupSceneCaptureComponent(NormalsSceneCapture, SCS_Normal);
+		SetupSceneCaptureComponent(IDsSceneCapture, SCS_FinalColorLDR);
+		SetupSceneCaptureComponent(CustomDepthSceneCapture, SCS_FinalColorLDR);
+	}
+
+	IconsNiagaraComponent->SetVariableInt(TEXT("CaptureMode"), static_cast<int32>(CaptureMode));
+
+	CaptureTargetMemory = ComputeCaptureTargetMemory();
+	INC_MEMORY_STAT_BY(STAT_TerrainScan_CaptureTargetMemory, CaptureTargetMemory);
 
 	CameraMesh->SetVisibility(bEnableCameraVisualization);
+
+	if (bUseTileCache)
+	{
+		TileCache = GetWorld()->GetSubsystem<UTerrainScanTileCacheSubsystem>()->GetCache(GetIconsSettings().Padding);
+	}
+
+	if (bEnableCaptureReadback || bUseTileCache)
+	{
+		CaptureReadback = MakeShared<FScanCaptureReadback>();
+		CaptureReadback->OnReadback().BindUObject(this, &UScannerIconsControllerComponent::HandleCaptureReadback);
+	}
+}
+
+void UScannerIconsControllerComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_MEMORY_STAT_BY(STAT_TerrainScan_CaptureTargetMemory, CaptureTargetMemory);
+	CaptureTargetMemory = 0;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UScannerIconsControllerComponent::Serialize(FArchive& Ar)
+{
+	Ar.UsingCustomVersion(FTerrainScanCustomVersion::GUID);
+
+	Super::Serialize(Ar);
+
+#if WITH_EDITORONLY_DATA
+	if (Ar.IsLoading())
+	{
+		const bool bUpgrade = Ar.CustomVer(FTerrainScanCustomVersion::GUID) < FTerrainScanCustomVersion::EmbeddedComponentSettings;
+		FTerrainScanCustomVersion::SyncDeprecatedSettings(this, FScanIconsSettings::StaticStruct(), &IconsSettings, bUpgrade);
+	}
+#endif
+}
+
+void UScannerIconsControllerComponent::SetScanProfile(UScanProfileDataAsset* NewProfile)
+{
+	if (ScanProfile == NewProfile) return;
+
+	// The grid sizes the render targets and the particle count, both set up once in BeginPlay.
+	const FScanIconsSettings& NewSettings = NewProfile ? NewProfile->Icons : IconsSettings;
+	if (HasBegunPlay() && !NewSettings.HasSameGrid(GetIconsSettings()))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: scan profile %s ignored, its icons grid differs from the current one."),
+			*GetName(), *GetNameSafe(NewProfile));
+		return;
+	}
+
+	ScanProfile = NewProfile;
+	CachedTotalEffectDuration = ScanProfile ? ScanProfile->GetTotalEffectDuration()
+		: IconsSettings.ComputeTotalEffectDuration();
+
+	if (IconsNiagaraComponent)
+	{
+		UploadIconSettings();
+	}
+}
+
+void UScannerIconsControllerComponent::UploadIconSettings()
+{
+	// Grid, thresholds, sprites and animation.
+	NiagaraParameters.SetSettings(GetIconsSettings());
 }
 
 void UScannerIconsControllerComponent::TickComponent
 	(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_IconsTick);
+
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+	if (CaptureReadback)
+	{
+		CaptureReadback->Tick();
+	}
+
+	if (IconsNiagaraComponent)
+	{
+		TickStartStage();
+	}
+
 	// Timing logic
 	if (bHasStarted) ElapsedTime += DeltaTime;
 	
@@ -185,81 +275,247 @@ void UScannerIconsControllerComponent::TickComponent
 		bHasStarted = false;
 	}
 	
-	FScannerState CurrentScannerState = ScannerController->GetCurrentFrameScannerState();
-	IconsNiagaraComponent->SetVariableFloat(TEXT("CurrentRange"), CurrentScannerState.Range);
+	FScanKinematicsSample ScanSample = ScannerController->SampleScanAt(GetWorld()->GetTimeSeconds());
+	NiagaraParameters.SetFloat(EScanIconsParameter::CurrentRange, ScanSample.Range);
+
+	// The final range is written: idle until the next scan.
+	const bool bReadbackPending = CaptureReadback && CaptureReadback->HasPendingRequests();
+	if (!bHasStarted && StartStage == EIconsStartStage::Idle && !bReadbackPending
+		&& ScanSample.AnimationState == EScannerAnimationState::Inactive)
+	{
+		SetComponentTickEnabled(false);
+	}
 }
 
 void UScannerIconsControllerComponent::StartIconsLifecycle()
 {
-	if (!IconsNiagaraComponent || !DepthSceneCapture || !NormalsSceneCapture || !IDsSceneCapture) return;
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_StartIcons);
+
+	if (!IconsNiagaraComponent) return;
+
+	const bool bPacked = CaptureMode == EScanCaptureMode::Packed;
+	if (bPacked ? !PackedSceneCapture : (!DepthSceneCapture || !NormalsSceneCapture || !IDsSceneCapture)) return;
 
 	FScannerState CurrentScannerState = ScannerController->GetCurrentFrameScannerState();
 	
 	// Niagara System and Scene Capture positioning
 
-	float Offset = (GridX * Padding) / 2;
+	const FScanIconsSettings& Settings = GetIconsSettings();
+	float Offset = (Settings.GridX * Settings.Padding) / 2;
 	FVector Direction = CurrentScannerState.Rotation.Vector();
 	Direction.Z = 0.0f; // Do not take into account eventual Z-shift encoded in direction
 	Direction.Normalize();
 	
 	FVector DeltaLocation = Direction * Offset;
 
-	IconsNiagaraComponent->SetWorldLocation(CurrentScannerState.Origin);
-	IconsNiagaraComponent->SetWorldRotation(FRotator{0.0f, CurrentScannerState.Rotation.Yaw, 0.0f});
-	IconsNiagaraComponent->AddWorldOffset(DeltaLocation);
+	// The icons component moves with the particle respawn, the previous particles stay where they are until then.
+	const FVector GridOrigin = CurrentScannerState.Origin + DeltaLocation;
 
-	PlaceSceneCaptureComponent(DepthSceneCapture, CurrentScannerState, DeltaLocation);
-	PlaceSceneCaptureComponent(NormalsSceneCapture, CurrentScannerState, DeltaLocation);
-	PlaceSceneCaptureComponent(IDsSceneCapture, CurrentScannerState, DeltaLocation);
-	PlaceSceneCaptureComponent(CustomDepthSceneCapture, CurrentScannerState, DeltaLocation);
+	if (bPacked)
+	{
+		PlaceSceneCaptureComponent(PackedSceneCapture, CurrentScannerState, DeltaLocation);
+	}
+	else
+	{
+		PlaceSceneCaptureComponent(DepthSceneCapture, CurrentScannerState, DeltaLocation);
+		PlaceSceneCaptureComponent(NormalsSceneCapture, CurrentScannerState, DeltaLocation);
+		PlaceSceneCaptureComponent(IDsSceneCapture, CurrentScannerState, DeltaLocation);
+		PlaceSceneCaptureComponent(CustomDepthSceneCapture, CurrentScannerState, DeltaLocation);
+	}
+
+	USceneCaptureComponent2D* PrimarySceneCapture = GetPrimarySceneCapture();
 
 	if (bEnableCameraVisualization)
 	{
-		CameraMesh->SetWorldLocationAndRotation(DepthSceneCapture->GetComponentLocation(),
-			DepthSceneCapture->GetComponentRotation());
+		CameraMesh->SetWorldLocationAndRotation(PrimarySceneCapture->GetComponentLocation(),
+			PrimarySceneCapture->GetComponentRotation());
 
-		DrawCameraViewFrustum(GetWorld(), DepthSceneCapture);
+		DrawCameraViewFrustum(GetWorld(), PrimarySceneCapture);
 	}
 
-	float CameraZ = DepthSceneCapture->GetComponentLocation().Z;
-	
-	// Capture depth and normals
-	DepthSceneCapture->CaptureScene();
-	NormalsSceneCapture->CaptureScene();
-	IDsSceneCapture->CaptureScene();
-	CustomDepthSceneCapture->CaptureScene();
-
-	// Send data to Niagara.
-	IconsNiagaraComponent->SetVariablePosition(TEXT("ScanOrigin"), CurrentScannerState.Origin);
-	IconsNiagaraComponent->SetVariablePosition(TEXT("GridOrigin"), IconsNiagaraComponent->GetComponentLocation());
-	IconsNiagaraComponent->SetVariableVec3(TEXT("DirectionVector"), CurrentScannerState.Rotation.Vector());
-	IconsNiagaraComponent->SetVariableFloat(TEXT("CameraZ"), CameraZ);
-	
-	// Start particle generation.
-	IconsNiagaraComponent->ReinitializeSystem();
+	bool bCacheStale = false;
+	const bool bCacheHit = TryUseCachedClassification(GridOrigin,
+		CurrentScannerState.Rotation.Yaw, bCacheStale);
+
+	if (bCacheHit && bSkipCapturesOnCacheHit && !bCacheStale)
+	{
+		// Terrain already classified needs no capture: the icons read the cached terrain from the same targets.
+		WriteCachedCaptures(PrimarySceneCapture->GetComponentLocation().Z);
+	}
+	else
+	{
+		if (bPacked)
+		{
+			// Depth, normals and IDs in a single scene traversal
+			PackedSceneCapture->CaptureScene();
+		}
+		else
+		{
+			// Capture depth and normals
+			DepthSceneCapture->CaptureScene();
+			NormalsSceneCapture->CaptureScene();
+			IDsSceneCapture->CaptureScene();
+			CustomDepthSceneCapture->CaptureScene();
+		}
+
+		// Every capture refreshes the tile cache, cache hits included.
+		if (CaptureReadback)
+		{
+			RequestCaptureReadback();
+		}
+	}
+
+	PendingStart.ScanOrigin = CurrentScannerState.Origin;
+	PendingStart.GridOrigin = GridOrigin;
+	PendingStart.GridRotation = FRotator{0.0f, CurrentScannerState.Rotation.Yaw, 0.0f};
+	PendingStart.Direction = CurrentScannerState.Rotation.Vector();
+	PendingStart.CameraZ = PrimarySceneCapture->GetComponentLocation().Z;
+	PendingStart.HalfAngle = CurrentScannerState.Angle * 0.5f;
+	PendingStart.ScanEndTime = ScannerController->GetTotalScanDuration();
+
+	// The effect is timed from the scan start, whichever frame the particles spawn on.
 	ElapsedTime = 0.f;
 	bHasStarted = true;
+	SetComponentTickEnabled(true);
+
+	if (!bTimeSliceLifecycleStart)
+	{
+		UploadScanParameters();
+		SpawnIconParticles();
+		return;
+	}
+
+	// The particles restart on a following tick, hidden by the scan Spawning and Prewarm phases. Placement,
+	// parameters and spawn stay together: the previous particles would jump to the new scan otherwise.
+	StartStage = EIconsStartStage::RestartParticles;
+	StartStageFrame = GFrameCounter;
+}
+
+void UScannerIconsControllerComponent::TickStartStage()
+{
+	// Never on the frame of the captures.
+	if (StartStage == EIconsStartStage::Idle || GFrameCounter == StartStageFrame) return;
+
+	StartStageFrame = GFrameCounter;
+
+	UploadScanParameters();
+	SpawnIconParticles();
+	StartStage = EIconsStartStage::Idle;
+}
+
+void UScannerIconsControllerComponent::UploadScanParameters()
+{
+	IconsNiagaraComponent->SetWorldLocationAndRotation(PendingStart.GridOrigin, PendingStart.GridRotation);
+
+	// Positions go through the component, which rebases them for large world coordinates.
+	IconsNiagaraComponent->SetVariablePosition(TEXT("ScanOrigin"), PendingStart.ScanOrigin);
+	IconsNiagaraComponent->SetVariablePosition(TEXT("GridOrigin"), PendingStart.GridOrigin);
+
+	NiagaraParameters.SetVec3(EScanIconsParameter::DirectionVector, FVector3f{PendingStart.Direction});
+	NiagaraParameters.SetFloat(EScanIconsParameter::CameraZ, PendingStart.CameraZ);
+
+	// Both follow the profile of the scan.
+	NiagaraParameters.SetFloat(EScanIconsParameter::HalfAngle, PendingStart.HalfAngle);
+	NiagaraParameters.SetFloat(EScanIconsParameter::ScanEndTime, PendingStart.ScanEndTime);
+}
+
+void UScannerIconsControllerComponent::SpawnIconParticles()
+{
+	if (!bPersistentParticles)
+	{
+		// Start particle generation.
+		IconsNiagaraComponent->ReinitializeSystem();
+		NiagaraParameters.Bind(IconsNiagaraComponent);
+		return;
+	}
+
+	// The particles already exist: the new generation restarts their animation with the new parameters.
+	NiagaraParameters.SetInt(EScanIconsParameter::ScanGeneration, ++ScanGeneration);
+
+	if (!IconsNiagaraComponent->IsActive())
+	{
+		IconsNiagaraComponent->Activate();
+	}
 }
 
 void UScannerIconsControllerComponent::SetupSceneCaptureComponent(USceneCaptureComponent2D* const SceneCaptureComponent,
 	ESceneCaptureSource CaptureSource) const
 {
+	const FScanIconsSettings& Settings = GetIconsSettings();
+
 	SceneCaptureComponent->CaptureSource = CaptureSource;
 	SceneCaptureComponent->bCaptureEveryFrame = false;
 	SceneCaptureComponent->bCaptureOnMovement = false;
 	
-	float AspectRatio = IconsAreaY() / IconsAreaX();
+	float AspectRatio = Settings.IconsAreaY() / Settings.IconsAreaX();
 	SceneCaptureComponent->TextureTarget->SizeX = FMath::CeilToInt32(RenderTargetsHeight * AspectRatio);
 	SceneCaptureComponent->TextureTarget->SizeY = RenderTargetsHeight;
 
 	SceneCaptureComponent->ProjectionType = ECameraProjectionMode::Type::Orthographic;
-	SceneCaptureComponent->OrthoWidth = IconsAreaY() + Padding;
+	SceneCaptureComponent->OrthoWidth = Settings.IconsAreaY() + Settings.Padding;
 
 	// Do not capture grass as it creates inconsistencies both in icons height and slope calculation.
 	// This can be extended of course with other flags depending on scene composition, landscape layers, etc...
 	SceneCaptureComponent->SetShowFlagSettings({{"InstancedGrass",false}});
 }
 
+void UScannerIconsControllerComponent::SetupPackedSceneCaptureComponent()
+{
+	// Only the Packed capture mode pays for this capture, Separate mode never creates it.
+	if (!PackedSceneCapture)
+	{
+		PackedSceneCapture = NewObject<USceneCaptureComponent2D>(this, TEXT("PackedSceneCapture"));
+		PackedSceneCapture->RegisterComponent();
+	}
+
+	// The packed layout needs full float precision for depth, create a suitable target if none is assigned.
+	if (!PackedSceneCapture->TextureTarget)
+	{
+		PackedSceneCapture->TextureTarget = NewObject<UTextureRenderTarget2D>(this, TEXT("PackedCaptureTarget"));
+		PackedSceneCapture->TextureTarget->RenderTargetFormat = RTF_RGBA32f;
+		PackedSceneCapture->TextureTarget->ClearColor = FLinearColor::Transparent;
+	}
+
+	SetupSceneCaptureComponent(PackedSceneCapture, SCS_FinalColorHDR);
+	PackedSceneCapture->TextureTarget->UpdateResource();
+
+	// The packing itself is done by a post-process material replacing the scene color.
+	if (PackedCaptureMaterial)
+	{
+		PackedSceneCapture->PostProcessSettings.WeightedBlendables.Array.Add(
+			FWeightedBlendable{1.0f, PackedCaptureMaterial});
+		PackedSceneCapture->PostProcessBlendWeight = 1.0f;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s: Packed capture mode without a PackedCaptureMaterial, the packed "
+			"capture holds plain scene color and the icons will be wrong."), *GetName());
+	}
+}
+
+int64 UScannerIconsControllerComponent::ComputeCaptureTargetMemory() const
+{
+	const TArray<USceneCaptureComponent2D*> SceneCaptures = CaptureMode == EScanCaptureMode::Packed
+		? TArray<USceneCaptureComponent2D*>{PackedSceneCapture}
+		: TArray<USceneCaptureComponent2D*>{DepthSceneCapture, NormalsSceneCapture, IDsSceneCapture, CustomDepthSceneCapture};
+
+	int64 Bytes = 0;
+	for (const USceneCaptureComponent2D* SceneCapture : SceneCaptures)
+	{
+		if (SceneCapture && SceneCapture->TextureTarget)
+		{
+			Bytes += SceneCapture->TextureTarget->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+		}
+	}
+
+	return Bytes;
+}
+
+USceneCaptureComponent2D* UScannerIconsControllerComponent::GetPrimarySceneCapture() const
+{
+	return CaptureMode == EScanCaptureMode::Packed ? PackedSceneCapture : DepthSceneCapture;
+}
+
 void UScannerIconsControllerComponent::PlaceSceneCaptureComponent(
 	USceneCaptureComponent2D* const SceneCaptureComponent,
 	const FScannerState& CurrentScannerState, const FVector& Movement) const
@@ -271,8 +527,227 @@ void UScannerIconsControllerComponent::PlaceSceneCaptureComponent(
 
 float UScannerIconsControllerComponent::TotalEffectDuration() const
 {
-	return (RevealAnimationDuration() + FadeAnimationDuration()) * TotalAnimationCycles
-		+  FadeAnimationDuration() + DangerIconFadeoutTime;
+	return CachedTotalEffectDuration;
+}
+
+void UScannerIconsControllerComponent::RequestCaptureReadback()
+{
+	const bool bPacked = CaptureMode == EScanCaptureMode::Packed;
+
+	// In packed mode the single target travels in the Depth slot.
+	FScanCaptureReadback::FTargets Targets(InPlace, nullptr);
+	Targets[static_cast<int32>(EScanCaptureTarget::Depth)] = GetPrimarySceneCapture()->TextureTarget;
+	if (!bPacked)
+	{
+		Targets[static_cast<int32>(EScanCaptureTarget::Normals)] = NormalsSceneCapture->TextureTarget;
+		Targets[static_cast<int32>(EScanCaptureTarget::IDs)] = IDsSceneCapture->TextureTarget;
+		Targets[static_cast<int32>(EScanCaptureTarget::CustomDepth)] = CustomDepthSceneCapture->TextureTarget;
+	}
+
+	FScanCaptureFrame Metadata;
+	Metadata.CaptureLocation = GetPrimarySceneCapture()->GetComponentLocation();
+	Metadata.CaptureRotation = GetPrimarySceneCapture()->GetComponentRotation();
+	Metadata.OrthoWidth = GetPrimarySceneCapture()->OrthoWidth;
+	Metadata.bPacked = bPacked;
+	Metadata.ScanYaw = ScannerController->GetCurrentFrameScannerState().Rotation.Yaw;
+
+	CaptureReadback->Request(Targets, Metadata);
+}
+
+void UScannerIconsControllerComponent::HandleCaptureReadback(TSharedRef<const FScanCaptureFrame> Frame)
+{
+	// Placeholder images describe no terrain: they must neither reach gameplay nor the tile cache.
+	if (Frame->bStub) return;
+
+	const FScanIconsSettings& Settings = GetIconsSettings();
+
+	const FScanCaptureImage& Depth = Frame->GetImage(EScanCaptureTarget::Depth);
+	const FScanCaptureImage& Normals = Frame->GetImage(EScanCaptureTarget::Normals);
+	const FScanCaptureImage& IDs = Frame->GetImage(EScanCaptureTarget::IDs);
+	const FScanCaptureImage& CustomDepth = Frame->GetImage(EScanCaptureTarget::CustomDepth);
+
+	if (!Depth.IsValid()) return;
+	if (!Frame->bPacked && (!Normals.IsValid() || !IDs.IsValid() || !CustomDepth.IsValid())) return;
+
+	// Resample the captures on the icons grid. Grid and captures share the same center: the
+	// image top points along the scan direction, its right side along the scan right vector.
+	const int32 NumCells = Settings.GridX * Settings.GridY;
+	const float ImageWidth = Frame->OrthoWidth;
+	const float ImageHeight = Frame->OrthoWidth * Depth.Height / Depth.Width;
+
+	TArray<float> DepthGrid, WaterDepthGrid;
+	TArray<FVector3f> NormalsGrid;
+	TArray<uint8> IDsGrid;
+	DepthGrid.SetNumUninitialized(NumCells);
+	WaterDepthGrid.SetNumUninitialized(NumCells);
+	NormalsGrid.SetNumUninitialized(NumCells);
+	IDsGrid.SetNumUninitialized(NumCells);
+
+	for (int32 X = 0; X < Settings.GridX; ++X)
+	{
+		const float Forward = (X - (Settings.GridX - 1) * 0.5f) * Settings.Padding;
+		const float V = 0.5f - Forward / ImageHeight;
+
+		for (int32 Y = 0; Y < Settings.GridY; ++Y)
+		{
+			const float Lateral = (Y - (Settings.GridY - 1) * 0.5f) * Settings.Padding;
+			const float U = 0.5f + Lateral / ImageWidth;
+			const int32 Cell = X * Settings.GridY + Y;
+
+			if (Frame->bPacked)
+			{
+				// See EScanCaptureMode::Packed for the layout.
+				const FLinearColor& Packed = Depth.Sample(U, V);
+				DepthGrid[Cell] = Packed.R;
+				NormalsGrid[Cell] = DecodeOctahedralNormal(Packed.G, Packed.B);
+				WaterDepthGrid[Cell] = FMath::Max(-Packed.A, 0.0f);
+				IDsGrid[Cell] = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Packed.A), 0, 255));
+				continue;
+			}
+
+			DepthGrid[Cell] = Depth.Sample(U, V).R;
+			WaterDepthGrid[Cell] = CustomDepth.Sample(U, V).R;
+
+			const FLinearColor& Normal = Normals.Sample(U, V);
+			NormalsGrid[Cell] = FVector3f{Normal.R, Normal.G, Normal.B};
+
+			IDsGrid[Cell] = static_cast<uint8>(FMath::RoundToInt32(FMath::Clamp(IDs.Sample(U, V).R, 0.0f, 1.0f) * 255.0f));
+		}
+	}
+
+	FTerrainClassificationInput Input;
+	Input.GridX = Settings.GridX;
+	Input.GridY = Settings.GridY;
+	Input.CameraZ = static_cast<float>(Frame->CaptureLocation.Z);
+	Input.Depth = DepthGrid;
+	Input.WaterDepth = WaterDepthGrid;
+	Input.Normals = NormalsGrid;
+	Input.IDs = IDsGrid;
+
+	if (FTerrainClassifier::Classify(Input, GetClassificationThresholds(), LastClassification))
+	{
+		if (TileCache)
+		{
+			// The capture camera sits right above the grid center.
+			TileCache->AddClassification(LastClassification, Frame->CaptureLocation, Frame->ScanYaw,
+				Settings.Padding);
+		}
+
+		OnTerrainClassified.Broadcast(LastClassification);
+	}
+}
+
+bool UScannerIconsControllerComponent::TryUseCachedClassification(const FVector& GridCenter, float Yaw,
+	bool& bOutStale)
+{
+	const FScanIconsSettings& Settings = GetIconsSettings();
+
+	if (!TileCache) return false;
+
+	FTerrainClassificationResult CachedClassification;
+	double WriteTime = 0.0;
+	if (!TileCache->BuildClassification(Settings.GridX, Settings.GridY, GridCenter, Yaw, Settings.Padding,
+		CachedClassification, WriteTime))
+	{
+		INC_DWORD_STAT(STAT_TerrainScan_TileCacheMisses);
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_TerrainScan_TileCacheHits);
+
+	bOutStale = FPlatformTime::Seconds() - WriteTime > CacheRefreshInterval;
+	LastClassification = MoveTemp(CachedClassification);
+
+	OnTerrainClassified.Broadcast(LastClassification);
+	return true;
+}
+
+void UScannerIconsControllerComponent::WriteCachedCaptures(float CameraZ)
+{
+	const FScanIconsSettings& Settings = GetIconsSettings();
+	const FTerrainClassificationThresholds Thresholds = GetClassificationThresholds();
+	const bool bPacked = CaptureMode == EScanCaptureMode::Packed;
+
+	const USceneCaptureComponent2D* PrimarySceneCapture = GetPrimarySceneCapture();
+	const UTextureRenderTarget2D* PrimaryTarget = PrimarySceneCapture->TextureTarget;
+	if (!PrimaryTarget) return;
+
+	// Same orientation as the captures: one column per grid cell of a row, the top row farthest along the scan.
+	FScanCaptureImage Images[FScanCaptureReadback::NumTargets];
+	auto GetImage = [&Images](EScanCaptureTarget Target) -> FScanCaptureImage&
+	{
+		return Images[static_cast<int32>(Target)];
+	};
+
+	for (int32 Target = 0; Target < (bPacked ? 1 : FScanCaptureReadback::NumTargets); ++Target)
+	{
+		Images[Target].Width = Settings.GridY;
+		Images[Target].Height = Settings.GridX;
+		Images[Target].Pixels.SetNumUninitialized(Settings.GridX * Settings.GridY);
+	}
+
+	for (int32 X = 0; X < Settings.GridX; ++X)
+	{
+		const int32 RowStart = (Settings.GridX - 1 - X) * Settings.GridY;
+
+		for (int32 Y = 0; Y < Settings.GridY; ++Y)
+		{
+			const FTerrainCaptureSample Sample = FTerrainClassifier::MakeCaptureSample(
+				static_cast<uint8>(LastClassification.GetType(X, Y)), LastClassification.GetHeight(X, Y), CameraZ,
+				Thresholds);
+			const int32 Pixel = RowStart + Y;
+
+			if (bPacked)
+			{
+				// See EScanCaptureMode::Packed for the layout.
+				const FVector2f Normal = EncodeOctahedralNormal(Sample.Normal);
+				Images[0].Pixels[Pixel] = FLinearColor{Sample.Depth, Normal.X, Normal.Y,
+					Sample.WaterDepth > 0.0f ? -Sample.WaterDepth : static_cast<float>(Sample.ID)};
+				continue;
+			}
+
+			// Same channels as read back in HandleCaptureReadback.
+			GetImage(EScanCaptureTarget::Depth).Pixels[Pixel] = FLinearColor{Sample.Depth, 0.0f, 0.0f, 1.0f};
+			GetImage(EScanCaptureTarget::Normals).Pixels[Pixel] = FLinearColor{Sample.Normal};
+			GetImage(EScanCaptureTarget::IDs).Pixels[Pixel] = FLinearColor{Sample.ID / 255.0f, 0.0f, 0.0f, 1.0f};
+			GetImage(EScanCaptureTarget::CustomDepth).Pixels[Pixel] = FLinearColor{Sample.WaterDepth, 0.0f, 0.0f, 1.0f};
+		}
+	}
+
+	// The grid covers the center of the captures, see HandleCaptureReadback.
+	const float ImageWidth = PrimarySceneCapture->OrthoWidth;
+	const float ImageHeight = PrimarySceneCapture->OrthoWidth * PrimaryTarget->SizeY / PrimaryTarget->SizeX;
+	const FVector2f HalfSize{Settings.GridY * Settings.Padding * 0.5f / ImageWidth,
+		Settings.GridX * Settings.Padding * 0.5f / ImageHeight};
+	const FVector2f UVMin = FVector2f{0.5f} - HalfSize;
+	const FVector2f UVMax = FVector2f{0.5f} + HalfSize;
+
+	if (bPacked)
+	{
+		FScanCaptureWriter::Write(PackedSceneCapture->TextureTarget, MoveTemp(Images[0]), UVMin, UVMax);
+		return;
+	}
+
+	FScanCaptureWriter::Write(DepthSceneCapture->TextureTarget, MoveTemp(GetImage(EScanCaptureTarget::Depth)),
+		UVMin, UVMax);
+	FScanCaptureWriter::Write(NormalsSceneCapture->TextureTarget, MoveTemp(GetImage(EScanCaptureTarget::Normals)),
+		UVMin, UVMax);
+	FScanCaptureWriter::Write(IDsSceneCapture->TextureTarget, MoveTemp(GetImage(EScanCaptureTarget::IDs)),
+		UVMin, UVMax);
+	FScanCaptureWriter::Write(CustomDepthSceneCapture->TextureTarget,
+		MoveTemp(GetImage(EScanCaptureTarget::CustomDepth)), UVMin, UVMax);
+}
+
+FTerrainClassificationThresholds UScannerIconsControllerComponent::GetClassificationThresholds() const
+{
+	const FScanIconsSettings& Settings = GetIconsSettings();
+
+	FTerrainClassificationThresholds Thresholds;
+	Thresholds.RegularTerrainThreshold = Settings.RegularTerrainThreshold;
+	Thresholds.SteepTerrainThreshold = Settings.SteepTerrainThreshold;
+	Thresholds.ShallowWaterThreshold = Settings.ShallowWaterThreshold;
+	Thresholds.DeepWaterThreshold = Settings.DeepWaterThreshold;
+	return Thresholds;
 }
 
 bool UScannerIconsControllerComponent::IsEffectActive() const
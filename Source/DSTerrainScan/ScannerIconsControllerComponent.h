@@ -2,6 +2,9 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "TerrainClassifier.h"
+#include "ScanProfileDataAsset.h"
+#include "ScanIconsNiagaraParameters.h"
 #include "ScannerIconsControllerComponent.generated.h"
 
 class UScannerControllerComponent;
@@ -12,7 +15,10 @@ class UNiagaraDataInterfaceLandscape;
 class UTextureRenderTarget2D;
 class UMaterialParameterGroup;
 class UMaterial;
+class FScanCaptureReadback;
+class FTerrainScanTileCache;
 struct FScannerState;
+struct FScanCaptureFrame;
 
 UENUM()
 enum class ETerrainType : int32
@@ -29,6 +35,25 @@ enum class ETerrainType : int32
 };
 
 
+UENUM()
+enum class EScanCaptureMode : uint8
+{
+	/** Four scene captures: depth, normals, IDs and custom depth. */
+	Separate,
+
+	/**
+	 * A single scene capture writing everything into one RGBA float target: R holds the scene depth,
+	 * GB the octahedral-encoded normal, A the terrain ID, or the negated water depth on water.
+	 * Requires a PackedCaptureMaterial, and r.PostProcessing.PropagateAlpha=True in the project
+	 * settings so that the alpha channel survives the post-process.
+	 */
+	Packed
+};
+
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnTerrainClassified, const FTerrainClassificationResult&);
+
+
 UCLASS(ClassGroup=(Custom), Blueprintable, meta=(BlueprintSpawnableComponent))
 class DSTERRAINSCAN_API UScannerIconsControllerComponent : public UActorComponent
 {
@@ -43,111 +68,19 @@ private: /* Blueprint-exposed parameters */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System", meta = (AllowPrivateAccess = "true"))
 	TObjectPtr<UNiagaraSystem> IconsParticleSystem;
 
-	
-	/* Grid settings */
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Grid Settings", meta = (AllowPrivateAccess = "true"))
-	int32 GridX = 75;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Grid Settings", meta = (AllowPrivateAccess = "true"))
-	int32 GridY = 140;
-
-	/** Distance between the icons from each other in the grid. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Grid Settings", meta = (AllowPrivateAccess = "true"))
-	float Padding = 60.0f;
-
-	/** Vertical offset of the icon from the terrain. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Grid Settings", meta = (AllowPrivateAccess = "true"))
-	float ZOffset = 40.0f;
-
-	
-	/* Thresholds */
 
 	/**
-	 * Maximum slope of regular terrain, derived from normals. Keep in mind
-	 * that a value of 1.0 means a perfectly flat surface, and a value of 0.0
-	 * a perpendicular surface, i.e. fully vertical, for example a wall.
+	 * Grid, thresholds, sprites and animation of the icons. Only used by components without a
+	 * ScanProfile, which replaces them.
 	 */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Thresholds", meta = (AllowPrivateAccess = "true"))
-	float RegularTerrainThreshold = 0.8f;
-
-	/** Maximum slope of steep terrain. See RegularTerrainThreshold for more info. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Thresholds", meta = (AllowPrivateAccess = "true"))
-	float SteepTerrainThreshold = 0.7f;
-
-	/** Maximum water depth (in Unreal Units) for shallow water. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Thresholds", meta = (AllowPrivateAccess = "true"))
-	float ShallowWaterThreshold = 100.0f;
-
-	/** Maximum water depth (in Unreal Units) for deep water. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Thresholds", meta = (AllowPrivateAccess = "true"))
-	float DeepWaterThreshold = 500.0f;
-
-	
-	/* Sprite sizes */
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Sprite Sizes", meta = (AllowPrivateAccess = "true"))
-	float DefaultSize = 2.5f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Sprite Sizes", meta = (AllowPrivateAccess = "true"))
-	float DangerIconSize = 10.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Sprite Sizes", meta = (AllowPrivateAccess = "true"))
-	float WaterIconsSize = 10.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Sprite Sizes", meta = (AllowPrivateAccess = "true"))
-	float RockyIconsSize = 10.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Sprite Sizes", meta = (AllowPrivateAccess = "true"))
-	float VegetationIconsSize = 10.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Sprite Sizes", meta = (AllowPrivateAccess = "true"))
-	float PathIconsSize = 10.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Sprite Sizes", meta = (AllowPrivateAccess = "true"))
-	float FlareSize = 750.0f;
-
-	
-	/* Sprite colors */
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor IconBlue{64,206,229};
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor IconYellow{237, 223, 66};
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor IconRed{220, 45, 67};
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Colors", meta = (AllowPrivateAccess = "true"))
-	FColor IconGreen{68, 151, 53};
-
-	
-	/* Opacity animation */
-
-	/** Each cycle consists of a single reveal-fade animation. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Opacity Animation", meta = (AllowPrivateAccess = "true"))
-	int32 TotalAnimationCycles = 2;
-	
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Opacity Animation", meta = (AllowPrivateAccess = "true"))
-	float OpacityAnimationSpeed = 2000.0f;
-
-	/** Strength of the fade step. With lower values you get a sharper animation. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Opacity Animation", meta = (AllowPrivateAccess = "true"))
-	float FadeIntensityFactor = 4000.0f;
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Opacity Animation", meta = (AllowPrivateAccess = "true"))
-	float DangerIconFadeoutTime = 5.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System", meta = (AllowPrivateAccess = "true",
+		ShowOnlyInnerProperties))
+	FScanIconsSettings IconsSettings;
 
-	/** How much space before the scan edge (in Unreal Units) the red icons show up in the effect. */
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Opacity Animation", meta = (AllowPrivateAccess = "true"))
-	float DangerIconAppearOffset = 2000.0f;
 
-	
-	/* Flare animation */
-
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Flare Animation", meta = (AllowPrivateAccess = "true"))
-	float FlareAnimationDuration = 0.35f;
+	/** Tuning shared with other scanners. If set, its icons settings replace IconsSettings. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Particle System|Profile", meta = (AllowPrivateAccess = "true"))
+	TObjectPtr<UScanProfileDataAsset> ScanProfile;
 
 	
 	/** Captures terrain depth into a texture (used to derive particle height). */
@@ -164,6 +97,19 @@ private: /* Blueprint-exposed parameters */
 	/** Captures IDs representing alternative terrain types. */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true"))
 	TObjectPtr<USceneCaptureComponent2D> IDsSceneCapture;
+
+	/** Whether the terrain is captured by four separate scene captures or a single packed one. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true"))
+	EScanCaptureMode CaptureMode = EScanCaptureMode::Separate;
+
+	/** Captures depth, normals and IDs in a single pass. Created at BeginPlay in Packed capture mode only. */
+	UPROPERTY(Transient, VisibleInstanceOnly, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true"))
+	TObjectPtr<USceneCaptureComponent2D> PackedSceneCapture;
+
+	/** Post-process material writing the packed layout described in EScanCaptureMode::Packed. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true",
+		EditCondition = "CaptureMode == EScanCaptureMode::Packed"))
+	TObjectPtr<UMaterialInterface> PackedCaptureMaterial;
 	
 	/** Additional SceneCaptureComponent2D height. Any value works as long we do not
 	 *	intersect geometry (for ortho perspective). */
@@ -176,6 +122,37 @@ private: /* Blueprint-exposed parameters */
 	 */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true"))
 	int32 RenderTargetsHeight = 512;
+
+	/**
+	 *  If true, the captures of every scan are read back to the CPU without stalling, and classified
+	 *  with FTerrainClassifier. Results are broadcast through OnTerrainClassified a frame or two later.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true"))
+	bool bEnableCaptureReadback = false;
+
+	/**
+	 *  If true, classified terrain is kept in the world tile cache (see UTerrainScanTileCacheSubsystem).
+	 *  Scans of an area that is fully cached broadcast the cached classification instead of waiting
+	 *  for a readback. Enables the capture readback, which fills the cache.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true"))
+	bool bUseTileCache = false;
+
+	/**
+	 *  If true, scans of a fully cached area skip the scene captures: the cached terrain is written
+	 *  into the capture render targets instead, with values the icons system classifies the same way.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true",
+		EditCondition = "bUseTileCache"))
+	bool bSkipCapturesOnCacheHit = true;
+
+	/**
+	 *  Age in seconds past which cached terrain is captured again, even on a cache hit, which refreshes
+	 *  the cache. Catches the changes the tile cache invalidation misses, e.g. on movable geometry.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Scene Capture", meta = (AllowPrivateAccess = "true",
+		EditCondition = "bUseTileCache", ClampMin = "0.0", Units = "s"))
+	float CacheRefreshInterval = 30.0f;
 	
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Other", meta = (AllowPrivateAccess = "true"))
@@ -185,47 +162,153 @@ private: /* Blueprint-exposed parameters */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Debug", meta = (AllowPrivateAccess = "true"))
 	bool bEnableCameraVisualization;
 
+	/**
+	 *  If true, StartIconsLifecycle is spread over two frames to lower the scan press hitch: captures
+	 *  on the first one, then the icons placement, Niagara parameters and particle spawn together on
+	 *  the next, so the particles of the previous scan never see the new one. The scan Spawning and
+	 *  Prewarm phases hide the delay.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Performance", meta = (AllowPrivateAccess = "true"))
+	bool bTimeSliceLifecycleStart = false;
+
+	/**
+	 *  If true, the icon particles are spawned once and kept alive between scans: a scan only rewrites
+	 *  the scan parameters and increments the "ScanGeneration" user parameter, instead of calling
+	 *  ReinitializeSystem and reallocating GridX * GridY particles. The icons system must spawn its
+	 *  particles once, keep them alive, and restart their animation whenever ScanGeneration changes.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Performance", meta = (AllowPrivateAccess = "true"))
+	bool bPersistentParticles = false;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Debug", meta = (AllowPrivateAccess = "true"))
 	TObjectPtr<UStaticMeshComponent> CameraMesh;
 
 protected:
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
 	                           FActorComponentTickFunction* ThisTickFunction) override;
 
+	virtual void Serialize(FArchive& Ar) override;
+
 	UFUNCTION(BlueprintCallable)
 	void StartIconsLifecycle();
 
-	bool IsEffectActive() const;
+	/**
+	 * Swaps the shared tuning, see ScanProfile, and uploads its parameters to the icons system.
+	 * Ignored if the icons grid differs, as the render targets are sized in BeginPlay.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void SetScanProfile(UScanProfileDataAsset* NewProfile);
 
-	float TotalEffectDuration() const;
+	/** Settings of the profile, or of the component without one. */
+	const FScanIconsSettings& GetIconsSettings() const { return ScanProfile ? ScanProfile->Icons : IconsSettings; }
 
-private: /* Class internals */
+	bool IsEffectActive() const;
 
-	constexpr float IconsAreaX() const { return (GridX - 1) * Padding; }
+	float TotalEffectDuration() const;
 
-	constexpr float IconsAreaY() const { return (GridY - 1) * Padding; }
+	/** Thresholds used by the icons system, for CPU-side classification with FTerrainClassifier. */
+	FTerrainClassificationThresholds GetClassificationThresholds() const;
 
-	float MaxEffectDistance() const { return FMath::Sqrt(FMath::Pow(IconsAreaX(), 2.f) + FMath::Pow(IconsAreaY() / 2, 2.f)); }
-	
+	/** Classification of the last scan read back to the CPU. Empty until bEnableCaptureReadback delivers one. */
+	const FTerrainClassificationResult& GetLastClassification() const { return LastClassification; }
 
-	float RevealAnimationDuration() const { return MaxEffectDistance() / OpacityAnimationSpeed; }
+	/** Broadcast on the game thread when the captures of a scan have been read back and classified. */
+	FOnTerrainClassified OnTerrainClassified;
 
-	float FadeAnimationDuration() const { return (MaxEffectDistance() + FadeIntensityFactor) / OpacityAnimationSpeed; }
+private: /* Class internals */
 
+	/** Sends the settings of the profile to Niagara. */
+	void UploadIconSettings();
 
 	void SetupSceneCaptureComponent(USceneCaptureComponent2D* const SceneCaptureComponent,
 		ESceneCaptureSource CaptureSource) const;
 
+	void SetupPackedSceneCaptureComponent();
+
+	/** GPU memory of the render targets used by the capture mode. */
+	int64 ComputeCaptureTargetMemory() const;
+
+	/** Scene capture whose location drives the icons height, depending on the capture mode. */
+	USceneCaptureComponent2D* GetPrimarySceneCapture() const;
+
 	void PlaceSceneCaptureComponent(USceneCaptureComponent2D* const SceneCaptureComponent,
 		const FScannerState& CurrentScannerState, const FVector& Movement) const;
+
+	void RequestCaptureReadback();
+
+	void HandleCaptureReadback(TSharedRef<const FScanCaptureFrame> Frame);
+
+	/**
+	 * Looks the grid up in the tile cache and, if fully covered, broadcasts the cached classification.
+	 *
+	 * @param bOutStale set if part of the cached terrain is older than CacheRefreshInterval.
+	 * @return true if the grid is fully cached.
+	 */
+	bool TryUseCachedClassification(const FVector& GridCenter, float Yaw, bool& bOutStale);
+
+	/**
+	 * Writes LastClassification into the capture render targets, in place of the scene captures.
+	 * @param CameraZ height of the capture camera the icons system derives heights from.
+	 */
+	void WriteCachedCaptures(float CameraZ);
+
+	/** Runs the time-sliced particle restart of StartIconsLifecycle, if any. */
+	void TickStartStage();
+
+	/** Moves the icons to the scan and sends its placement to Niagara. */
+	void UploadScanParameters();
+
+	void SpawnIconParticles();
+
+	/** Benchmarks the lifecycle stages one by one. */
+	friend class FTerrainScanBenchmark;
 	
 	
 	float ElapsedTime = -1.f;
 
 	bool bHasStarted = false;
+
+	enum class EIconsStartStage : uint8
+	{
+		Idle,
+		RestartParticles
+	};
+
+	EIconsStartStage StartStage = EIconsStartStage::Idle;
+
+	/** GFrameCounter of the last stage run. */
+	uint64 StartStageFrame = 0;
+
+	/** Icons placement and Niagara parameters of the last scan, applied by UploadScanParameters. */
+	struct FPendingStart
+	{
+		FVector ScanOrigin = FVector::ZeroVector;
+
+		FVector GridOrigin = FVector::ZeroVector;
+
+		FRotator GridRotation = FRotator::ZeroRotator;
+
+		FVector Direction = FVector::ForwardVector;
+
+		float CameraZ = 0.0f;
+
+		float HalfAngle = 60.0f;
+
+		float ScanEndTime = 0.0f;
+	};
+
+	FPendingStart PendingStart;
+
+	/** Scans started since BeginPlay, see bPersistentParticles. */
+	int32 ScanGeneration = 0;
+
+	/** Of the profile in use, see FScanIconsSettings::ComputeTotalEffectDuration. */
+	float CachedTotalEffectDuration = 0.0f;
 	
 
 	UPROPERTY()
@@ -234,6 +317,97 @@ private: /* Class internals */
 	/** World-positioned Niagara component for icon generation. */
 	UPROPERTY()
 	TObjectPtr<UNiagaraComponent> IconsNiagaraComponent;
+
+	/** Bound to IconsNiagaraComponent in BeginPlay. */
+	FScanIconsNiagaraParameters NiagaraParameters;
+
+	TSharedPtr<FScanCaptureReadback> CaptureReadback;
+
+	FTerrainClassificationResult LastClassification;
+
+	TSharedPtr<FTerrainScanTileCache> TileCache;
+
+	/** Reported in stat TerrainScan, see ComputeCaptureTargetMemory. */
+	int64 CaptureTargetMemory = 0;
+
+#if WITH_EDITORONLY_DATA
+	/* Settings saved before IconsSettings, upgraded in Serialize. */
+
+	UPROPERTY()
+	int32 GridX_DEPRECATED = 75;
+
+	UPROPERTY()
+	int32 GridY_DEPRECATED = 140;
+
+	UPROPERTY()
+	float Padding_DEPRECATED = 60.0f;
+
+	UPROPERTY()
+	float ZOffset_DEPRECATED = 40.0f;
+
+	UPROPERTY()
+	float RegularTerrainThreshold_DEPRECATED = 0.8f;
+
+	UPROPERTY()
+	float SteepTerrainThreshold_DEPRECATED = 0.7f;
+
+	UPROPERTY()
+	float ShallowWaterThreshold_DEPRECATED = 100.0f;
+
+	UPROPERTY()
+	float DeepWaterThreshold_DEPRECATED = 500.0f;
+
+	UPROPERTY()
+	float DefaultSize_DEPRECATED = 2.5f;
+
+	UPROPERTY()
+	float DangerIconSize_DEPRECATED = 10.0f;
+
+	UPROPERTY()
+	float WaterIconsSize_DEPRECATED = 10.0f;
+
+	UPROPERTY()
+	float RockyIconsSize_DEPRECATED = 10.0f;
+
+	UPROPERTY()
+	float VegetationIconsSize_DEPRECATED = 10.0f;
+
+	UPROPERTY()
+	float PathIconsSize_DEPRECATED = 10.0f;
+
+	UPROPERTY()
+	float FlareSize_DEPRECATED = 750.0f;
+
+	UPROPERTY()
+	FColor IconBlue_DEPRECATED{64,206,229};
+
+	UPROPERTY()
+	FColor IconYellow_DEPRECATED{237, 223, 66};
+
+	UPROPERTY()
+	FColor IconRed_DEPRECATED{220, 45, 67};
+
+	UPROPERTY()
+	FColor IconGreen_DEPRECATED{68, 151, 53};
+
+	UPROPERTY()
+	int32 TotalAnimationCycles_DEPRECATED = 2;
+
+	UPROPERTY()
+	float OpacityAnimationSpeed_DEPRECATED = 2000.0f;
+
+	UPROPERTY()
+	float FadeIntensityFactor_DEPRECATED = 4000.0f;
+
+	UPROPERTY()
+	float DangerIconFadeoutTime_DEPRECATED = 5.0f;
+
+	UPROPERTY()
+	float DangerIconAppearOffset_DEPRECATED = 2000.0f;
+
+	UPROPERTY()
+	float FlareAnimationDuration_DEPRECATED = 0.35f;
+#endif
 };
 
 /** Utility for camera frustum visualization of a SceneCapture component. */
@@ -0,0 +1,159 @@
+﻿#include "TerrainClassifier.h"
+#include "Async/ParallelFor.h"
+#include "ScannerIconsControllerComponent.h"
+
+namespace
+{
+	constexpr float AsFloat(ETerrainType Type) { return static_cast<float>(static_cast<int32>(Type)); }
+
+	bool IsAlternativeTerrain(uint8 ID)
+	{
+		return ID == static_cast<uint8>(ETerrainType::Rocky)
+			|| ID == static_cast<uint8>(ETerrainType::Vegetation)
+			|| ID == static_cast<uint8>(ETerrainType::Path);
+	}
+
+	uint8 ClassifyCell(float NormalZ, float WaterDepth, uint8 ID, const FTerrainClassificationThresholds& Thresholds)
+	{
+		if (WaterDepth > 0.0f)
+		{
+			if (WaterDepth <= Thresholds.ShallowWaterThreshold) return static_cast<uint8>(ETerrainType::ShallowWater);
+			if (WaterDepth <= Thresholds.DeepWaterThreshold) return static_cast<uint8>(ETerrainType::DeepWater);
+			return static_cast<uint8>(ETerrainType::DangerousWater);
+		}
+
+		if (IsAlternativeTerrain(ID)) return ID;
+
+		if (NormalZ >= Thresholds.RegularTerrainThreshold) return static_cast<uint8>(ETerrainType::Regular);
+		if (NormalZ >= Thresholds.SteepTerrainThreshold) return static_cast<uint8>(ETerrainType::Steep);
+		return static_cast<uint8>(ETerrainType::Dangerous);
+	}
+}
+
+bool FTerrainClassifier::Classify(const FTerrainClassificationInput& Input,
+	const FTerrainClassificationThresholds& Thresholds, FTerrainClassificationResult& OutResult)
+{
+	const int32 NumCells = Input.GridX * Input.GridY;
+
+	if (NumCells <= 0 || Input.Depth.Num() != NumCells || Input.WaterDepth.Num() != NumCells
+		|| Input.Normals.Num() != NumCells || Input.IDs.Num() != NumCells)
+	{
+		return false;
+	}
+
+	OutResult.GridX = Input.GridX;
+	OutResult.GridY = Input.GridY;
+	OutResult.Types.SetNumUninitialized(NumCells);
+	OutResult.Heights.SetNumUninitialized(NumCells);
+
+	const VectorRegister4Float RegularThreshold = VectorSetFloat1(Thresholds.RegularTerrainThreshold);
+	const VectorRegister4Float SteepThreshold = VectorSetFloat1(Thresholds.SteepTerrainThreshold);
+	const VectorRegister4Float ShallowThreshold = VectorSetFloat1(Thresholds.ShallowWaterThreshold);
+	const VectorRegister4Float DeepThreshold = VectorSetFloat1(Thresholds.DeepWaterThreshold);
+
+	const VectorRegister4Float Regular = VectorSetFloat1(AsFloat(ETerrainType::Regular));
+	const VectorRegister4Float Steep = VectorSetFloat1(AsFloat(ETerrainType::Steep));
+	const VectorRegister4Float Dangerous = VectorSetFloat1(AsFloat(ETerrainType::Dangerous));
+	const VectorRegister4Float ShallowWater = VectorSetFloat1(AsFloat(ETerrainType::ShallowWater));
+	const VectorRegister4Float DeepWater = VectorSetFloat1(AsFloat(ETerrainType::DeepWater));
+	const VectorRegister4Float DangerousWater = VectorSetFloat1(AsFloat(ETerrainType::DangerousWater));
+	const VectorRegister4Float CameraZ = VectorSetFloat1(Input.CameraZ);
+
+	// One row per task: rows are GridY cells long, enough work to amortize the scheduling.
+	ParallelFor(Input.GridX, [&](int32 Row)
+	{
+		const int32 RowStart = Row * Input.GridY;
+		const int32 RowEnd = RowStart + Input.GridY;
+
+		int32 Cell = RowStart;
+		for (; Cell + 4 <= RowEnd; Cell += 4)
+		{
+			const VectorRegister4Float NormalZ = MakeVectorRegisterFloat(Input.Normals[Cell].Z,
+				Input.Normals[Cell + 1].Z, Input.Normals[Cell + 2].Z, Input.Normals[Cell + 3].Z);
+			const VectorRegister4Float WaterDepth = VectorLoad(&Input.WaterDepth[Cell]);
+			const VectorRegister4Float Depth = VectorLoad(&Input.Depth[Cell]);
+
+			// Slope classes, from the most to the least dangerous.
+			VectorRegister4Float Land = Dangerous;
+			Land = VectorSelect(VectorCompareGE(NormalZ, SteepThreshold), Steep, Land);
+			Land = VectorSelect(VectorCompareGE(NormalZ, RegularThreshold), Regular, Land);
+
+			// Water classes, from the deepest to the shallowest.
+			VectorRegister4Float Water = DangerousWater;
+			Water = VectorSelect(VectorCompareLE(WaterDepth, DeepThreshold), DeepWater, Water);
+			Water = VectorSelect(VectorCompareLE(WaterDepth, ShallowThreshold), ShallowWater, Water);
+
+			const VectorRegister4Float IsWater = VectorCompareGT(WaterDepth, VectorZeroFloat());
+			const VectorRegister4Float Type = VectorSelect(IsWater, Water, Land);
+
+			alignas(16) float Types[4];
+			VectorStoreAligned(Type, Types);
+			VectorStore(VectorSubtract(CameraZ, Depth), &OutResult.Heights[Cell]);
+
+			const int32 WaterMask = VectorMaskBits(IsWater);
+
+			for (int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				// Alternative terrain IDs override slope classes, but not water.
+				const uint8 ID = Input.IDs[Cell + Lane];
+				const bool bOverride = !(WaterMask & (1 << Lane)) && IsAlternativeTerrain(ID);
+
+				OutResult.Types[Cell + Lane] = bOverride ? ID : static_cast<uint8>(Types[Lane]);
+			}
+		}
+
+		for (; Cell < RowEnd; ++Cell)
+		{
+			OutResult.Types[Cell] = ClassifyCell(Input.Normals[Cell].Z, Input.WaterDepth[Cell], Input.IDs[Cell],
+				Thresholds);
+			OutResult.Heights[Cell] = Input.CameraZ - Input.Depth[Cell];
+		}
+	});
+
+	return true;
+}
+
+FTerrainCaptureSample FTerrainClassifier::MakeCaptureSample(uint8 Type, float Height, float CameraZ,
+	const FTerrainClassificationThresholds& Thresholds)
+{
+	FTerrainCaptureSample Sample;
+	Sample.Depth = CameraZ - Height;
+
+	// Values halfway between the thresholds of the type, away from the edges.
+	float NormalZ = 1.0f;
+
+	switch (static_cast<ETerrainType>(Type))
+	{
+		case ETerrainType::ShallowWater:
+			Sample.WaterDepth = Thresholds.ShallowWaterThreshold * 0.5f;
+			break;
+
+		case ETerrainType::DeepWater:
+			Sample.WaterDepth = (Thresholds.ShallowWaterThreshold + Thresholds.DeepWaterThreshold) * 0.5f;
+			break;
+
+		case ETerrainType::DangerousWater:
+			Sample.WaterDepth = Thresholds.DeepWaterThreshold * 2.0f;
+			break;
+
+		case ETerrainType::Rocky:
+		case ETerrainType::Vegetation:
+		case ETerrainType::Path:
+			Sample.ID = Type;
+			break;
+
+		case ETerrainType::Steep:
+			NormalZ = (Thresholds.RegularTerrainThreshold + Thresholds.SteepTerrainThreshold) * 0.5f;
+			break;
+
+		case ETerrainType::Dangerous:
+			NormalZ = FMath::Max(Thresholds.SteepTerrainThreshold - 0.5f, -1.0f);
+			break;
+
+		default:
+			break;
+	}
+
+	Sample.Normal = FVector3f{FMath::Sqrt(FMath::Max(1.0f - NormalZ * NormalZ, 0.0f)), 0.0f, NormalZ};
+	return Sample;
+}
@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ETerrainType : int32;
+
+
+/**
+ *	Classification thresholds, same meaning as the ones UScannerIconsControllerComponent
+ *	pushes to the icons Niagara system.
+ */
+struct FTerrainClassificationThresholds
+{
+	/** Minimum normal Z of regular terrain. */
+	float RegularTerrainThreshold = 0.8f;
+
+	/** Minimum normal Z of steep terrain. Anything below is dangerous. */
+	float SteepTerrainThreshold = 0.7f;
+
+	/** Maximum water depth (in Unreal Units) for shallow water. */
+	float ShallowWaterThreshold = 100.0f;
+
+	/** Maximum water depth (in Unreal Units) for deep water. Anything deeper is dangerous. */
+	float DeepWaterThreshold = 500.0f;
+};
+
+
+/**
+ *	Read-back scene capture data, resampled on the icons grid. Every array holds
+ *	GridX * GridY cells in row-major order (GridY cells per row).
+ */
+struct FTerrainClassificationInput
+{
+	int32 GridX = 0;
+
+	int32 GridY = 0;
+
+	/** Height of the orthographic capture camera. */
+	float CameraZ = 0.0f;
+
+	/** Scene depth from the capture camera. */
+	TConstArrayView<float> Depth;
+
+	/** Water depth above the terrain, zero where there is no water. */
+	TConstArrayView<float> WaterDepth;
+
+	/** Terrain normals. */
+	TConstArrayView<FVector3f> Normals;
+
+	/** Alternative terrain IDs: the ETerrainType value of rocky, vegetation and path cells, zero elsewhere. */
+	TConstArrayView<uint8> IDs;
+};
+
+
+/**
+ *	Capture values of a single cell, see FTerrainClassificationInput.
+ */
+struct FTerrainCaptureSample
+{
+	float Depth = 0.0f;
+
+	float WaterDepth = 0.0f;
+
+	FVector3f Normal = FVector3f::UpVector;
+
+	uint8 ID = 0;
+};
+
+
+/**
+ *	Per-cell classification of a scanned area.
+ */
+struct FTerrainClassificationResult
+{
+	int32 GridX = 0;
+
+	int32 GridY = 0;
+
+	/** ETerrainType of each cell. */
+	TArray<uint8> Types;
+
+	/** World height of each cell. */
+	TArray<float> Heights;
+
+	ETerrainType GetType(int32 X, int32 Y) const { return static_cast<ETerrainType>(Types[X * GridY + Y]); }
+
+	float GetHeight(int32 X, int32 Y) const { return Heights[X * GridY + Y]; }
+};
+
+
+/**
+ *	CPU counterpart of the terrain classification done in the FXS_TerrainScanIcons Niagara system,
+ *	so that gameplay code can query the scanned terrain. Priority order is water, then alternative
+ *	terrain IDs, then slope. Rows are classified in parallel, four cells at a time.
+ */
+class DSTERRAINSCAN_API FTerrainClassifier
+{
+public:
+
+	/**
+	 * Classifies every cell of the input grid.
+	 *
+	 * @param Input read-back capture data. Arrays must all hold GridX * GridY cells.
+	 * @param Thresholds classification thresholds.
+	 * @param OutResult receives types and heights.
+	 * @return false if the input is malformed.
+	 */
+	static bool Classify(const FTerrainClassificationInput& Input, const FTerrainClassificationThresholds& Thresholds,
+		FTerrainClassificationResult& OutResult);
+
+	/**
+	 * Inverse of Classify for a single cell: capture values that classify back to the given type and
+	 * height. Lets cached terrain stand in for the scene captures.
+	 *
+	 * @param Type ETerrainType of the cell.
+	 * @param Height world height of the cell.
+	 * @param CameraZ height of the orthographic capture camera.
+	 * @param Thresholds classification thresholds.
+	 */
+	static FTerrainCaptureSample MakeCaptureSample(uint8 Type, float Height, float CameraZ,
+		const FTerrainClassificationThresholds& Thresholds);
+};
@@ -0,0 +1,66 @@
+﻿#include "TerrainScanAtlas.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+FTerrainScanAtlas::~FTerrainScanAtlas()
+{
+	// The region must be unmapped before its file handle is closed.
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+TSharedPtr<FTerrainScanAtlas> FTerrainScanAtlas::Open(const FString& Filename)
+{
+	TUniquePtr<IMappedFileHandle> MappedFile{FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename)};
+	if (!MappedFile) return nullptr;
+
+	const int64 FileSize = MappedFile->GetFileSize();
+	if (FileSize < static_cast<int64>(sizeof(FTerrainScanAtlasHeader)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Terrain scan atlas %s: file too small."), *Filename);
+		return nullptr;
+	}
+
+	TUniquePtr<IMappedFileRegion> MappedRegion{MappedFile->MapRegion(0, FileSize)};
+	if (!MappedRegion) return nullptr;
+
+	const FTerrainScanAtlasHeader* Header = reinterpret_cast<const FTerrainScanAtlasHeader*>(MappedRegion->GetMappedPtr());
+
+	if (Header->Magic != FTerrainScanAtlasHeader::ExpectedMagic || Header->Version != FTerrainScanAtlasHeader::CurrentVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Terrain scan atlas %s: unknown format or version %u, expected %u. Bake it again."),
+			*Filename, Header->Version, FTerrainScanAtlasHeader::CurrentVersion);
+		return nullptr;
+	}
+
+	const int64 NumTiles = static_cast<int64>(Header->NumTilesX) * Header->NumTilesY;
+	if (Header->CellsPerTile != 32 || Header->CellSize <= 0.0f || Header->NumTilesX < 0 || Header->NumTilesY < 0
+		|| FileSize != static_cast<int64>(sizeof(FTerrainScanAtlasHeader)) + NumTiles * static_cast<int64>(sizeof(FTerrainScanAtlasTile)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Terrain scan atlas %s: malformed header."), *Filename);
+		return nullptr;
+	}
+
+	TSharedPtr<FTerrainScanAtlas> Atlas = MakeShareable(new FTerrainScanAtlas());
+	Atlas->Header = Header;
+	Atlas->Tiles = reinterpret_cast<const FTerrainScanAtlasTile*>(Header + 1);
+	Atlas->MappedRegion = MoveTemp(MappedRegion);
+	Atlas->MappedFile = MoveTemp(MappedFile);
+	return Atlas;
+}
+
+FString FTerrainScanAtlas::GetAtlasFilename(const FString& MapName)
+{
+	return FPaths::ProjectContentDir() / TEXT("TerrainScan") / (MapName + TEXT(".tsatlas"));
+}
+
+const FTerrainScanAtlasTile* FTerrainScanAtlas::FindTile(const FIntPoint& TileKey) const
+{
+	const int32 X = TileKey.X - Header->MinTileX;
+	const int32 Y = TileKey.Y - Header->MinTileY;
+	if (X < 0 || Y < 0 || X >= Header->NumTilesX || Y >= Header->NumTilesY) return nullptr;
+
+	const FTerrainScanAtlasTile& Tile = Tiles[X * Header->NumTilesY + Y];
+	return Tile.NumKnownCells > 0 ? &Tile : nullptr;
+}
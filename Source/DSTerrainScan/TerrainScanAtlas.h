@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+
+/**
+ *	On-disk layout of a baked classification atlas: a header followed by NumTilesX * NumTilesY
+ *	tiles in row-major order (NumTilesY tiles per row). Both are read in place from a memory
+ *	mapping, so the layout is plain little-endian data with no padding.
+ */
+struct FTerrainScanAtlasHeader
+{
+	static constexpr uint32 ExpectedMagic = 0x54415354; // "TSAT"
+
+	/** Bump whenever the layout or the classification changes: older atlases are then ignored. */
+	static constexpr uint32 CurrentVersion = 1;
+
+	uint32 Magic = ExpectedMagic;
+
+	uint32 Version = CurrentVersion;
+
+	/** World size of a cell, in Unreal Units. */
+	float CellSize = 0.0f;
+
+	/** Must match FTerrainScanTile::CellsPerSide. */
+	int32 CellsPerTile = 0;
+
+	/** Key of the first tile, see FTerrainScanTileCache. */
+	int32 MinTileX = 0;
+
+	int32 MinTileY = 0;
+
+	int32 NumTilesX = 0;
+
+	int32 NumTilesY = 0;
+};
+
+/** Same content as FTerrainScanTile. */
+struct FTerrainScanAtlasTile
+{
+	float BaseHeight = 0.0f;
+
+	/** Zero if nothing was hit over the whole tile. */
+	int32 NumKnownCells = 0;
+
+	uint8 PackedTypes[32 * 32 / 2];
+
+	uint16 QuantizedHeights[32 * 32];
+};
+
+static_assert(sizeof(FTerrainScanAtlasHeader) == 32, "The atlas header is memory-mapped.");
+static_assert(sizeof(FTerrainScanAtlasTile) == 8 + 512 + 2048, "Atlas tiles are memory-mapped.");
+
+
+/**
+ *	Read-only view of a classification atlas baked by UTerrainScanBakeCommandlet. The file is
+ *	memory-mapped, so only the tiles scans actually touch are paged in.
+ */
+class DSTERRAINSCAN_API FTerrainScanAtlas
+{
+public:
+
+	~FTerrainScanAtlas();
+
+	/**
+	 * Maps the given atlas file.
+	 * @return null if the file is missing, malformed or from another version.
+	 */
+	static TSharedPtr<FTerrainScanAtlas> Open(const FString& Filename);
+
+	/** Default atlas location of a map, e.g. Content/TerrainScan/open_world_LSP_v2.tsatlas. */
+	static FString GetAtlasFilename(const FString& MapName);
+
+	/** Tile with the given key, or null if outside the baked area or empty. */
+	const FTerrainScanAtlasTile* FindTile(const FIntPoint& TileKey) const;
+
+	float GetCellSize() const { return Header->CellSize; }
+
+private:
+
+	FTerrainScanAtlas() = default;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	const FTerrainScanAtlasHeader* Header = nullptr;
+
+	const FTerrainScanAtlasTile* Tiles = nullptr;
+};
@@ -0,0 +1,580 @@
+﻿#include "TerrainScanBenchmark.h"
+#include "Components/DecalComponent.h"
+#include "Engine/World.h"
+#include "FootprintControllerComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "NiagaraComponent.h"
+#include "NiagaraFunctionLibrary.h"
+#include "ScanIconsNiagaraParameters.h"
+#include "ScannerControllerComponent.h"
+#include "ScannerIconsControllerComponent.h"
+#include "TerrainScanMPCSubsystem.h"
+
+/** Untimed iterations before every case. */
+constexpr int32 GBenchmarkWarmupIterations = 10;
+
+/** Footprint and point counts of the scaling cases. */
+constexpr int32 GBenchmarkCounts[] = {1000, 10000, 100000};
+
+/** Live icon systems of the parameter upload cases. */
+constexpr int32 GBenchmarkIconSystemCounts[] = {1, 64, 256};
+
+/** Characters of the idle crowd case. */
+constexpr int32 GBenchmarkIdleCrowdSize = 500;
+
+/** Fixed seed, so that every run tests the same points. */
+constexpr int32 GBenchmarkSeed = 0x5CA7;
+
+
+double FTerrainScanBenchmarkResult::GetMean() const
+{
+	if (SamplesMs.IsEmpty()) return 0.0;
+
+	double Sum = 0.0;
+	for (double Sample : SamplesMs) Sum += Sample;
+	return Sum / SamplesMs.Num();
+}
+
+double FTerrainScanBenchmarkResult::GetPercentile(double Percentile) const
+{
+	if (SamplesMs.IsEmpty()) return 0.0;
+
+	TArray<double> Sorted = SamplesMs;
+	Sorted.Sort();
+
+	const int32 Rank = FMath::CeilToInt32(Percentile / 100.0 * Sorted.Num()) - 1;
+	return Sorted[FMath::Clamp(Rank, 0, Sorted.Num() - 1)];
+}
+
+
+FTerrainScanBenchmark::FTerrainScanBenchmark(UWorld* InWorld, int32 InNumIterations)
+	: World(InWorld)
+	, NumIterations(FMath::Max(InNumIterations, 1))
+{
+}
+
+void FTerrainScanBenchmark::Run()
+{
+	Results.Reset();
+
+	if (!World) return;
+
+	const APlayerController* PlayerController = World->GetFirstPlayerController();
+	const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!Pawn)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Terrain scan benchmark needs a player pawn."));
+		return;
+	}
+
+	Run(Pawn);
+}
+
+void FTerrainScanBenchmark::Run(const AActor* Character)
+{
+	Results.Reset();
+
+	if (!World || !Character) return;
+
+	auto* Scanner = Character->GetComponentByClass<UScannerControllerComponent>();
+	auto* Icons = Character->GetComponentByClass<UScannerIconsControllerComponent>();
+	auto* Footprints = Character->GetComponentByClass<UFootprintControllerComponent>();
+
+	if (Scanner)
+	{
+		RunScannerCases(Scanner);
+		RunScanAreaCases(Scanner);
+	}
+
+	if (Icons)
+	{
+		RunIconsCases(Icons);
+		RunIconsParameterCases(Icons);
+	}
+
+	if (Footprints && Scanner && Icons) RunFootprintCases(Footprints);
+
+	if (Footprints && Scanner) RunIdleCrowdCases(Scanner, Footprints);
+
+	RunDecalPoolCases();
+}
+
+template<typename FunctorType>
+void FTerrainScanBenchmark::Measure(const FString& Name, int32 NumItems, FunctorType&& Body)
+{
+	for (int32 Iteration = 0; Iteration < GBenchmarkWarmupIterations; ++Iteration)
+	{
+		Body();
+	}
+
+	FTerrainScanBenchmarkResult& Result = Results.AddDefaulted_GetRef();
+	Result.Name = Name;
+	Result.NumItems = NumItems;
+	Result.SamplesMs.Reserve(NumIterations);
+
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Body();
+		Result.SamplesMs.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("%s: p50 %.4f ms, p99 %.4f ms."), *Name, Result.GetPercentile(50.0),
+		Result.GetPercentile(99.0));
+}
+
+void FTerrainScanBenchmark::RunScannerCases(UScannerControllerComponent* Scanner)
+{
+	const AActor* Owner = Scanner->GetOwner();
+	Scanner->StartScannerLifecycleAt(Owner->GetActorLocation(), Owner->GetActorRotation());
+
+	// Whole lifecycle, in 1000 steps.
+	constexpr int32 NumSamples = 1000;
+	const double StartTime = Scanner->GetCurrentFrameScannerState().StartTime;
+	const double Duration = Scanner->GetTotalScanDuration();
+	float RangeSum = 0.0f;
+
+	Measure(TEXT("Scanner.SampleScanAt"), NumSamples, [&]
+	{
+		for (int32 Sample = 0; Sample < NumSamples; ++Sample)
+		{
+			RangeSum += Scanner->SampleScanAt(StartTime + Duration * Sample / NumSamples).Range;
+		}
+	});
+
+	Measure(TEXT("Scanner.Tick"), 1, [&]
+	{
+		Scanner->TickComponent(1.0f / 60.0f, LEVELTICK_All, &Scanner->PrimaryComponentTick);
+	});
+
+	UTerrainScanMPCSubsystem* MPCSubsystem = World->GetSubsystem<UTerrainScanMPCSubsystem>();
+	if (MPCSubsystem && Scanner->MPC)
+	{
+		TSharedRef<FTerrainScanMPCBlock> Block = MPCSubsystem->GetBlock(Scanner->MPC);
+		float Range = 0.0f;
+
+		// Every value changes, as while a scan expands.
+		Measure(TEXT("MPC.Flush"), 1, [&]
+		{
+			Range += 1.0f;
+			Block->SetScalar(ETerrainScanScalar::TerrainScanRange, Range);
+			Block->SetScalar(ETerrainScanScalar::EffectOpacity, FMath::Frac(Range * 0.01f));
+			MPCSubsystem->Tick(0.0f);
+		});
+	}
+
+	UE_LOG(LogTemp, Verbose, TEXT("Scan range checksum %f."), RangeSum);
+}
+
+void FTerrainScanBenchmark::RunScanAreaCases(UScannerControllerComponent* Scanner)
+{
+	for (int32 Count : GBenchmarkCounts)
+	{
+		const TArray<FVector> Points = MakeScanPoints(Scanner, Count);
+		int32 NumInside = 0;
+
+		Measure(FString::Printf(TEXT("ScanArea.Single/%d"), Count), Count, [&]
+		{
+			for (const FVector& Point : Points)
+			{
+				NumInside += Scanner->IsPointInsideScanArea(Point) ? 1 : 0;
+			}
+		});
+
+		TBitArray<> InsideScanArea;
+
+		Measure(FString::Printf(TEXT("ScanArea.Batch/%d"), Count), Count, [&]
+		{
+			Scanner->IsPointsInsideScanArea(Points, InsideScanArea);
+		});
+
+		UE_LOG(LogTemp, Verbose, TEXT("%d points inside the scan area."), NumInside);
+	}
+}
+
+void FTerrainScanBenchmark::RunIconsCases(UScannerIconsControllerComponent* Icons)
+{
+	if (!Icons->IconsNiagaraComponent) return;
+
+	const bool bTimeSliceLifecycleStart = Icons->bTimeSliceLifecycleStart;
+
+	// Scan-press frame with the whole start in one frame, then with only its first stage.
+	Icons->bTimeSliceLifecycleStart = false;
+	Measure(TEXT("Icons.ScanPress/Immediate"), 1, [&]
+	{
+		Icons->StartIconsLifecycle();
+	});
+
+	Icons->bTimeSliceLifecycleStart = true;
+	Measure(TEXT("Icons.ScanPress/TimeSliced"), 1, [&]
+	{
+		Icons->StartIconsLifecycle();
+	});
+
+	// The frame after the press, in time-sliced mode, upload and spawn measured apart.
+	Measure(TEXT("Icons.UploadStage"), 1, [&]
+	{
+		Icons->UploadScanParameters();
+	});
+
+	const bool bPersistentParticles = Icons->bPersistentParticles;
+
+	Icons->bPersistentParticles = false;
+	Measure(TEXT("Icons.SpawnStage/Reinitialize"), 1, [&]
+	{
+		Icons->SpawnIconParticles();
+	});
+
+	Icons->bPersistentParticles = true;
+	Measure(TEXT("Icons.SpawnStage/Persistent"), 1, [&]
+	{
+		Icons->SpawnIconParticles();
+	});
+
+	Icons->bPersistentParticles = bPersistentParticles;
+
+	Icons->StartStage = UScannerIconsControllerComponent::EIconsStartStage::Idle;
+	Icons->bTimeSliceLifecycleStart = bTimeSliceLifecycleStart;
+}
+
+void FTerrainScanBenchmark::RunIconsParameterCases(UScannerIconsControllerComponent* Icons)
+{
+	if (!Icons->IconsParticleSystem) return;
+
+	const FScanIconsSettings& Settings = Icons->GetIconsSettings();
+	const UScannerIconsControllerComponent::FPendingStart& Start = Icons->PendingStart;
+
+	for (int32 Count : GBenchmarkIconSystemCounts)
+	{
+		// Inactive: only the game thread writes are measured, no system is simulated.
+		TArray<UNiagaraComponent*> Systems;
+		TArray<FScanIconsNiagaraParameters> Parameters;
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			UNiagaraComponent* System = UNiagaraFunctionLibrary::SpawnSystemAtLocation(World, Icons->IconsParticleSystem,
+				FVector::ZeroVector, FRotator::ZeroRotator, FVector::OneVector, false, false);
+			if (!System) continue;
+
+			Systems.Add(System);
+			Parameters.AddDefaulted_GetRef().Bind(System);
+		}
+
+		// Per-scan upload, as UploadScanParameters before it used the bound offsets. Positions are not included.
+		Measure(FString::Printf(TEXT("Icons.ScanParameters.ByName/%d"), Count), Systems.Num(), [&]
+		{
+			for (UNiagaraComponent* System : Systems)
+			{
+				System->SetVariableVec3(TEXT("DirectionVector"), Start.Direction);
+				System->SetVariableFloat(TEXT("CameraZ"), Start.CameraZ);
+				System->SetVariableFloat(TEXT("HalfAngle"), Start.HalfAngle);
+				System->SetVariableFloat(TEXT("ScanEndTime"), Start.ScanEndTime);
+				System->SetVariableInt(TEXT("ScanGeneration"), 1);
+			}
+		});
+
+		Measure(FString::Printf(TEXT("Icons.ScanParameters.Bound/%d"), Count), Systems.Num(), [&]
+		{
+			for (FScanIconsNiagaraParameters& Bound : Parameters)
+			{
+				Bound.SetVec3(EScanIconsParameter::DirectionVector, FVector3f{Start.Direction});
+				Bound.SetFloat(EScanIconsParameter::CameraZ, Start.CameraZ);
+				Bound.SetFloat(EScanIconsParameter::HalfAngle, Start.HalfAngle);
+				Bound.SetFloat(EScanIconsParameter::ScanEndTime, Start.ScanEndTime);
+				Bound.SetInt(EScanIconsParameter::ScanGeneration, 1);
+			}
+		});
+
+		Measure(FString::Printf(TEXT("Icons.Settings.Bound/%d"), Count), Systems.Num(), [&]
+		{
+			for (FScanIconsNiagaraParameters& Bound : Parameters)
+			{
+				Bound.SetSettings(Settings);
+			}
+		});
+
+		// Per-tick range, with a different value every iteration.
+		float Range = 0.0f;
+
+		Measure(FString::Printf(TEXT("Icons.CurrentRange.ByName/%d"), Count), Systems.Num(), [&]
+		{
+			Range += 1.0f;
+			for (UNiagaraComponent* System : Systems)
+			{
+				System->SetVariableFloat(TEXT("CurrentRange"), Range);
+			}
+		});
+
+		Measure(FString::Printf(TEXT("Icons.CurrentRange.Bound/%d"), Count), Systems.Num(), [&]
+		{
+			Range += 1.0f;
+			for (FScanIconsNiagaraParameters& Bound : Parameters)
+			{
+				Bound.SetFloat(EScanIconsParameter::CurrentRange, Range);
+			}
+		});
+
+		for (UNiagaraComponent* System : Systems)
+		{
+			System->DestroyComponent();
+		}
+	}
+}
+
+void FTerrainScanBenchmark::RunFootprintCases(UFootprintControllerComponent* Footprints)
+{
+	// Crowd footprints belong to the subsystem, not to the component.
+	if (Footprints->CrowdSubsystem) return;
+
+	// Instanced mode, so that only the CPU side is measured and no decal is created per footprint.
+	const EFootprintRenderMode RenderMode = Footprints->RenderMode;
+	Footprints->RenderMode = EFootprintRenderMode::Instanced;
+
+	constexpr int32 NumSteps = 1000;
+
+	for (int32 Count : GBenchmarkCounts)
+	{
+		const TArray<FVector> Locations = MakeScanPoints(Footprints->Scanner, Count + NumSteps);
+		int32 NextLocation = 0;
+
+		const auto PlaceNextFootprint = [&]
+		{
+			const FVector& Location = Locations[NextLocation++ % Locations.Num()];
+			Footprints->PlaceFootprint(FFootprintData{Location, FRotator::ZeroRotator, EFootstepType::Left});
+		};
+
+		ResetFootprints(Footprints, Count);
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			PlaceNextFootprint();
+		}
+
+		// Store full: every step evicts the oldest footprint.
+		Measure(FString::Printf(TEXT("Footprints.SpawnEvict/%d"), Count), NumSteps, [&]
+		{
+			for (int32 Step = 0; Step < NumSteps; ++Step)
+			{
+				PlaceNextFootprint();
+			}
+		});
+
+		Measure(FString::Printf(TEXT("Footprints.Highlight/%d"), Count), Count, [&]
+		{
+			Footprints->StartFootprintsLifecycle();
+		});
+	}
+
+	ResetFootprints(Footprints, FMath::Max(Footprints->MaxFootprints, 1));
+	Footprints->RenderMode = RenderMode;
+}
+
+void FTerrainScanBenchmark::RunIdleCrowdCases(UScannerControllerComponent* Scanner,
+	UFootprintControllerComponent* Footprints)
+{
+	// Full frames are run: not from within one, e.g. a command executed during the world tick.
+	if (World->bInTick)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Crowd.WorldTick: skipped, the world is ticking."));
+		return;
+	}
+
+	const auto TickWorld = [this]
+	{
+		World->Tick(LEVELTICK_All, 1.0f / 60.0f);
+	};
+
+	// Before: the same world without the crowd.
+	Measure(TEXT("Crowd.WorldTick.Empty"), 1, TickWorld);
+
+	TArray<AActor*> Crowd;
+	TArray<UActorComponent*> Components;
+
+	for (int32 Index = 0; Index < GBenchmarkIdleCrowdSize; ++Index)
+	{
+		AActor* Character = World->SpawnActor<AActor>();
+		if (!Character) continue;
+
+		Crowd.Add(Character);
+
+		// Scanner first, the footprints look it up in BeginPlay. Footprints go through the crowd subsystem, as for NPCs.
+		// Icons are left out: every one would own its capture targets and Niagara system.
+		auto* CrowdScanner = NewObject<UScannerControllerComponent>(Character, NAME_None, RF_NoFlags, Scanner);
+		CrowdScanner->RegisterComponent();
+
+		auto* CrowdFootprints = NewObject<UFootprintControllerComponent>(Character, NAME_None, RF_NoFlags, Footprints);
+		CrowdFootprints->bUseCrowdSubsystem = true;
+		CrowdFootprints->RegisterComponent();
+
+		Components.Add(CrowdScanner);
+		Components.Add(CrowdFootprints);
+	}
+
+	// After: the crowd neither scans nor walks, so none of its components should reach the tick manager.
+	Measure(FString::Printf(TEXT("Crowd.WorldTick.Idle/%d"), Crowd.Num()), Crowd.Num(), TickWorld);
+
+	int32 NumTicking = 0;
+	for (const UActorComponent* Component : Components)
+	{
+		NumTicking += Component->IsComponentTickEnabled() ? 1 : 0;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Crowd.WorldTick: %d of %d components left ticking."), NumTicking, Components.Num());
+
+	for (AActor* Character : Crowd)
+	{
+		Character->Destroy();
+	}
+}
+
+void FTerrainScanBenchmark::RunDecalPoolCases()
+{
+	constexpr int32 NumDecals = 99;
+	constexpr int32 NumSteps = 10000;
+
+	FFootprintDecalPool Pool;
+	Pool.Initialize(World, NumDecals, FVector::OneVector);
+	if (Pool.GetNumAllocated() == 0) return;
+
+	// As many decals in flight as footprints: the oldest one is released at every step.
+	TArray<UDecalComponent*> InFlight;
+	InFlight.Reserve(NumDecals);
+	int32 NextRelease = 0;
+
+	const int32 NumAllocatedBefore = Pool.GetNumAllocated();
+
+	Measure(TEXT("DecalPool.Cycle"), NumSteps, [&]
+	{
+		for (int32 Step = 0; Step < NumSteps; ++Step)
+		{
+			if (InFlight.Num() == NumDecals)
+			{
+				Pool.Release(InFlight[NextRelease]);
+				InFlight[NextRelease] = Pool.Acquire(nullptr, FVector(static_cast<double>(Step), 0.0, 0.0), FRotator::ZeroRotator, 10.0f, 1.0f);
+				NextRelease = (NextRelease + 1) % NumDecals;
+			}
+			else
+			{
+				InFlight.Add(Pool.Acquire(nullptr, FVector(static_cast<double>(Step), 0.0, 0.0), FRotator::ZeroRotator, 10.0f, 1.0f));
+			}
+		}
+	});
+
+	UE_LOG(LogTemp, Display, TEXT("DecalPool.Cycle: %d decals created beyond the initial %d."),
+		Pool.GetNumAllocated() - NumAllocatedBefore, NumAllocatedBefore);
+
+	Pool.Shutdown(0.0f);
+}
+
+void FTerrainScanBenchmark::ResetFootprints(UFootprintControllerComponent* Footprints, int32 Capacity)
+{
+	while (!Footprints->Footprints.IsEmpty())
+	{
+		Footprints->ReleaseFootprint(Footprints->Footprints.GetOldestSlot());
+		Footprints->Footprints.PopOldest();
+	}
+
+	Footprints->Footprints.SetCapacity(Capacity);
+	Footprints->FootprintHash.Empty();
+	Footprints->HighlightedSlots.Reset();
+
+	if (Footprints->FootprintInstances)
+	{
+		Footprints->ResetFootprintInstances();
+	}
+}
+
+TArray<FVector> FTerrainScanBenchmark::MakeScanPoints(const UScannerControllerComponent* Scanner, int32 NumPoints) const
+{
+	const FVector Origin = Scanner->GetCurrentFrameScannerState().Origin;
+	const float Extent = FMath::Max(Scanner->GetScannerFinalRange(), 100.0f) * 2.0f;
+
+	FRandomStream Random(GBenchmarkSeed);
+
+	TArray<FVector> Points;
+	Points.Reserve(NumPoints);
+	for (int32 Index = 0; Index < NumPoints; ++Index)
+	{
+		Points.Add(Origin + FVector{Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), 0.0f});
+	}
+
+	return Points;
+}
+
+bool FTerrainScanBenchmark::WriteResults(const FString& BaseFilename) const
+{
+	FString Csv = TEXT("Case,Items,Iterations,MeanMs,P50Ms,P90Ms,P99Ms,MaxMs\n");
+
+	FString Json = FString::Printf(TEXT("{\n\t\"build\": \"%s\",\n\t\"date\": \"%s\",\n\t\"cases\": [\n"),
+		FApp::GetBuildVersion(), *FDateTime::UtcNow().ToIso8601());
+
+	for (int32 Index = 0; Index < Results.Num(); ++Index)
+	{
+		const FTerrainScanBenchmarkResult& Result = Results[Index];
+
+		const double Mean = Result.GetMean();
+		const double P50 = Result.GetPercentile(50.0);
+		const double P90 = Result.GetPercentile(90.0);
+		const double P99 = Result.GetPercentile(99.0);
+		const double Max = Result.GetPercentile(100.0);
+
+		Csv += FString::Printf(TEXT("%s,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f\n"), *Result.Name, Result.NumItems,
+			Result.SamplesMs.Num(), Mean, P50, P90, P99, Max);
+
+		Json += FString::Printf(TEXT("\t\t{\"name\": \"%s\", \"items\": %d, \"iterations\": %d, \"mean_ms\": %.6f, ")
+			TEXT("\"p50_ms\": %.6f, \"p90_ms\": %.6f, \"p99_ms\": %.6f, \"max_ms\": %.6f}%s\n"),
+			*Result.Name, Result.NumItems, Result.SamplesMs.Num(), Mean, P50, P90, P99, Max,
+			Index + 1 < Results.Num() ? TEXT(",") : TEXT(""));
+	}
+
+	Json += TEXT("\t]\n}\n");
+
+	const bool bWritten = FFileHelper::SaveStringToFile(Csv, *(BaseFilename + TEXT(".csv")))
+		&& FFileHelper::SaveStringToFile(Json, *(BaseFilename + TEXT(".json")));
+
+	if (!bWritten)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Cannot write terrain scan benchmark results to %s."), *BaseFilename);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Terrain scan benchmark results written to %s.csv/.json."), *BaseFilename);
+	return true;
+}
+
+
+/** TerrainScan.Benchmark [Iterations=N] [Output=<path without extension>] [Quit] */
+static void RunTerrainScanBenchmark(const TArray<FString>& Args, UWorld* World)
+{
+	int32 NumIterations = 200;
+	FString Output = FPaths::ProjectSavedDir() / TEXT("Benchmarks")
+		/ FString::Printf(TEXT("TerrainScan-%s"), *FDateTime::Now().ToString());
+	bool bQuit = false;
+
+	for (const FString& Arg : Args)
+	{
+		FParse::Value(*Arg, TEXT("Iterations="), NumIterations);
+		FParse::Value(*Arg, TEXT("Output="), Output);
+		bQuit |= Arg.Equals(TEXT("Quit"), ESearchCase::IgnoreCase);
+	}
+
+	FTerrainScanBenchmark Benchmark(World, NumIterations);
+	Benchmark.Run();
+
+	const bool bSucceeded = !Benchmark.GetResults().IsEmpty() && Benchmark.WriteResults(Output);
+
+	if (bQuit)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, bSucceeded ? 0 : 1);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GTerrainScanBenchmarkCommand(
+	TEXT("TerrainScan.Benchmark"),
+	TEXT("Benchmarks the scan pipeline on the player character and writes percentiles to CSV and JSON. ")
+	TEXT("Arguments: Iterations=N, Output=<path without extension>, Quit."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunTerrainScanBenchmark));
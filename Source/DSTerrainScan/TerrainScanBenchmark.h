@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+class UWorld;
+class UScannerControllerComponent;
+class UScannerIconsControllerComponent;
+class UFootprintControllerComponent;
+
+
+/** Timings of one benchmark case. */
+struct FTerrainScanBenchmarkResult
+{
+	FString Name;
+
+	/** Work items processed per iteration, e.g. points tested or footprints placed. */
+	int32 NumItems = 1;
+
+	/** Duration of every iteration, in milliseconds. */
+	TArray<double> SamplesMs;
+
+	double GetMean() const;
+
+	/** Nearest-rank percentile, Percentile in [0, 100]. */
+	double GetPercentile(double Percentile) const;
+};
+
+
+/**
+ *	Performance benchmark of the scan pipeline, run on the player character of a live world by the
+ *	TerrainScan.Benchmark console command. Nothing is rendered, so it also runs headless, e.g.
+ *
+ *		UnrealEditor DSTerrainScan.uproject -game -nullrhi -unattended -ExecCmds="TerrainScan.Benchmark Quit"
+ *
+ *	Every case is timed per iteration, and written as percentiles to CSV and JSON files to track
+ *	regressions across commits. The TerrainScan.Benchmark.Budgets automation test runs it on the
+ *	scanner character and fails when a case goes over budget. The benchmark leaves the components
+ *	in a state unfit for play.
+ */
+class DSTERRAINSCAN_API FTerrainScanBenchmark
+{
+public:
+
+	FTerrainScanBenchmark(UWorld* InWorld, int32 InNumIterations);
+
+	/** Runs every case on the player pawn of the world. */
+	void Run();
+
+	/** Runs every case the character supports. Cases needing a missing component are skipped. */
+	void Run(const AActor* Character);
+
+	/**
+	 * Writes the results to BaseFilename.csv and BaseFilename.json.
+	 * @return false if a file could not be written.
+	 */
+	bool WriteResults(const FString& BaseFilename) const;
+
+	const TArray<FTerrainScanBenchmarkResult>& GetResults() const { return Results; }
+
+private:
+
+	/** Runs Body for the warm-up, then times NumIterations calls of it. */
+	template<typename FunctorType>
+	void Measure(const FString& Name, int32 NumItems, FunctorType&& Body);
+
+	void RunScannerCases(UScannerControllerComponent* Scanner);
+
+	void RunScanAreaCases(UScannerControllerComponent* Scanner);
+
+	void RunIconsCases(UScannerIconsControllerComponent* Icons);
+
+	/** Per-scan and per-tick parameter writes on many live icon systems, by name and bound. */
+	void RunIconsParameterCases(UScannerIconsControllerComponent* Icons);
+
+	void RunFootprintCases(UFootprintControllerComponent* Footprints);
+
+	/**
+	 * World tick without and with characters that do not scan nor walk, built from copies of the player's
+	 * components. Skipped if called during the world tick.
+	 */
+	void RunIdleCrowdCases(UScannerControllerComponent* Scanner, UFootprintControllerComponent* Footprints);
+
+	void RunDecalPoolCases();
+
+	/** Drops every footprint of the component and resizes its store. */
+	static void ResetFootprints(UFootprintControllerComponent* Footprints, int32 Capacity);
+
+	/** Random points on the XY plane around the scan origin, within twice the scan range. */
+	TArray<FVector> MakeScanPoints(const UScannerControllerComponent* Scanner, int32 NumPoints) const;
+
+	UWorld* World;
+
+	int32 NumIterations;
+
+	TArray<FTerrainScanBenchmarkResult> Results;
+};
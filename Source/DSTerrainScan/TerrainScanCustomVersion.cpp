@@ -0,0 +1,30 @@
+﻿#include "TerrainScanCustomVersion.h"
+#include "Serialization/CustomVersion.h"
+#include "UObject/UnrealType.h"
+
+const FGuid FTerrainScanCustomVersion::GUID(0x4056CE4E, 0xF6D54210, 0xBFD3868B, 0x01200C79);
+
+static FCustomVersionRegistration GRegisterTerrainScanCustomVersion(FTerrainScanCustomVersion::GUID,
+	FTerrainScanCustomVersion::LatestVersion, TEXT("TerrainScanVer"));
+
+#if WITH_EDITORONLY_DATA
+void FTerrainScanCustomVersion::SyncDeprecatedSettings(UObject* Object, const UScriptStruct* Struct, void* StructData,
+	bool bToStruct)
+{
+	for (TFieldIterator<FProperty> It(Struct); It; ++It)
+	{
+		const FProperty* Member = *It;
+		const FProperty* Deprecated = Object->GetClass()->FindPropertyByName(
+			FName(*(Member->GetName() + TEXT("_DEPRECATED"))));
+
+		// Members added with the struct, e.g. nested structs, have nothing to upgrade from.
+		if (!Deprecated || !Deprecated->SameType(Member)) continue;
+
+		void* MemberValue = Member->ContainerPtrToValuePtr<void>(StructData);
+		void* DeprecatedValue = Deprecated->ContainerPtrToValuePtr<void>(Object);
+
+		if (bToStruct) Member->CopyCompleteValue(MemberValue, DeprecatedValue);
+		else Member->CopyCompleteValue(DeprecatedValue, MemberValue);
+	}
+}
+#endif
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/Guid.h"
+
+
+/**
+ *	Versions of the data saved by the terrain scan components, for upgrades on load.
+ */
+struct DSTERRAINSCAN_API FTerrainScanCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+
+		/** Tuning values of the scanner and icons components moved into FScanProfile, FScanAppearance and FScanIconsSettings. */
+		EmbeddedComponentSettings,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+
+#if WITH_EDITORONLY_DATA
+	/**
+	 * Copies the members of an embedded settings struct from or to the deprecated properties of the
+	 * object they replaced, matched by name: Member and Member_DEPRECATED.
+	 *
+	 * @param Struct type of the embedded settings.
+	 * @param StructData embedded settings inside Object.
+	 * @param bToStruct true to upgrade data saved before EmbeddedComponentSettings. False keeps the
+	 *	deprecated values of an upgraded archetype in sync, for the Blueprints deriving from it
+	 *	that were not resaved yet.
+	 */
+	static void SyncDeprecatedSettings(UObject* Object, const UScriptStruct* Struct, void* StructData, bool bToStruct);
+#endif
+};
@@ -0,0 +1,172 @@
+﻿#include "TerrainScanMPCSubsystem.h"
+#include "Materials/MaterialParameterCollection.h"
+#include "Materials/MaterialParameterCollectionInstance.h"
+#include "TerrainScanStats.h"
+
+namespace TerrainScanMPCNames
+{
+	// Built once: avoids hashing the parameter strings on every write.
+
+	const FName Scalars[] =
+	{
+		TEXT("_Terrain_Scan_Range"),
+		TEXT("_Effect_Opacity"),
+		TEXT("_Dark_Circle_Opacity"),
+		TEXT("_Dark_Circle_Range"),
+		TEXT("_Footprint_Relative_Highlight_Time"),
+		TEXT("_Terrain_Scan_Count"),
+		TEXT("_Terrain_Scan_Arc_Angle"),
+		TEXT("_Distance_Between_Scan_Lines"),
+		TEXT("_Outline_Thickness"),
+		TEXT("_Terrain_Scan_Arc_Blend_Factor"),
+		TEXT("_Edge_Gradient_Start"),
+		TEXT("_Edge_Gradient_Falloff"),
+		TEXT("_Dark_Circle_Size")
+	};
+	static_assert(UE_ARRAY_COUNT(Scalars) == static_cast<int32>(ETerrainScanScalar::Num));
+
+	const FName Vectors[] =
+	{
+		TEXT("_Terrain_Scan_Origin"),
+		TEXT("_Terrain_Scan_Direction"),
+		TEXT("_Terrain_Scan_Color"),
+		TEXT("_First_Line_Color"),
+		TEXT("_Edge_Gradient_Color_Start"),
+		TEXT("_Edge_Gradient_Color_End")
+	};
+	static_assert(UE_ARRAY_COUNT(Vectors) == static_cast<int32>(ETerrainScanVector::Num));
+}
+
+FTerrainScanMPCBlock::FTerrainScanMPCBlock(UWorld* InWorld, UMaterialParameterCollection* InCollection)
+	: World(InWorld), Collection(InCollection)
+{
+	for (FLinearColor& Vector : Vectors)
+	{
+		Vector = FLinearColor::Transparent;
+	}
+
+	// Values start from the collection defaults, so that parameters nobody writes keep them.
+	if (const UMaterialParameterCollection* MPC = Collection.Get())
+	{
+		for (int32 Index = 0; Index < UE_ARRAY_COUNT(TerrainScanMPCNames::Scalars); ++Index)
+		{
+			if (const FCollectionScalarParameter* Parameter = MPC->GetScalarParameterByName(TerrainScanMPCNames::Scalars[Index]))
+			{
+				Scalars[Index] = Parameter->DefaultValue;
+			}
+		}
+
+		for (int32 Index = 0; Index < UE_ARRAY_COUNT(TerrainScanMPCNames::Vectors); ++Index)
+		{
+			if (const FCollectionVectorParameter* Parameter = MPC->GetVectorParameterByName(TerrainScanMPCNames::Vectors[Index]))
+			{
+				Vectors[Index] = Parameter->DefaultValue;
+			}
+		}
+	}
+
+	// The instance may hold other values than the defaults: the first flush writes every parameter.
+	DirtyScalars = (1u << static_cast<int32>(ETerrainScanScalar::Num)) - 1;
+	DirtyVectors = (1u << static_cast<int32>(ETerrainScanVector::Num)) - 1;
+
+	Resolve();
+}
+
+void FTerrainScanMPCBlock::SetScalar(ETerrainScanScalar Parameter, float Value)
+{
+	const int32 Index = static_cast<int32>(Parameter);
+	if (Scalars[Index] == Value) return;
+
+	Scalars[Index] = Value;
+	DirtyScalars |= 1u << Index;
+}
+
+void FTerrainScanMPCBlock::SetVector(ETerrainScanVector Parameter, const FLinearColor& Value)
+{
+	const int32 Index = static_cast<int32>(Parameter);
+	if (Vectors[Index] == Value) return;
+
+	Vectors[Index] = Value;
+	DirtyVectors |= 1u << Index;
+}
+
+void FTerrainScanMPCBlock::Flush()
+{
+	if (!IsDirty()) return;
+
+	// The instance can be recreated by the world (e.g. when the collection is edited), resolve it again if so.
+	if (!Instance.IsValid() && !Resolve()) return;
+
+	UMaterialParameterCollectionInstance* MPCInstance = Instance.Get();
+
+	for (uint32 Mask = DirtyScalars & ValidScalars; Mask; Mask &= Mask - 1)
+	{
+		const int32 Index = FMath::CountTrailingZeros(Mask);
+		MPCInstance->SetScalarParameterValue(TerrainScanMPCNames::Scalars[Index], Scalars[Index]);
+	}
+
+	for (uint32 Mask = DirtyVectors & ValidVectors; Mask; Mask &= Mask - 1)
+	{
+		const int32 Index = FMath::CountTrailingZeros(Mask);
+		MPCInstance->SetVectorParameterValue(TerrainScanMPCNames::Vectors[Index], Vectors[Index]);
+	}
+
+	DirtyScalars = 0;
+	DirtyVectors = 0;
+}
+
+bool FTerrainScanMPCBlock::Resolve()
+{
+	UWorld* OwningWorld = World.Get();
+	UMaterialParameterCollection* MPC = Collection.Get();
+	if (!OwningWorld || !MPC) return false;
+
+	Instance = OwningWorld->GetParameterCollectionInstance(MPC);
+
+	ValidScalars = 0;
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(TerrainScanMPCNames::Scalars); ++Index)
+	{
+		if (MPC->GetScalarParameterByName(TerrainScanMPCNames::Scalars[Index]))
+		{
+			ValidScalars |= 1u << Index;
+		}
+	}
+
+	ValidVectors = 0;
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(TerrainScanMPCNames::Vectors); ++Index)
+	{
+		if (MPC->GetVectorParameterByName(TerrainScanMPCNames::Vectors[Index]))
+		{
+			ValidVectors |= 1u << Index;
+		}
+	}
+
+	return Instance.IsValid();
+}
+
+TSharedRef<FTerrainScanMPCBlock> UTerrainScanMPCSubsystem::GetBlock(UMaterialParameterCollection* Collection)
+{
+	if (const TSharedRef<FTerrainScanMPCBlock>* Block = Blocks.Find(Collection))
+	{
+		return *Block;
+	}
+
+	return Blocks.Add(Collection, MakeShared<FTerrainScanMPCBlock>(GetWorld(), Collection));
+}
+
+void UTerrainScanMPCSubsystem::Tick(float DeltaTime)
+{
+	TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(STAT_TerrainScan_MPCFlush);
+
+	Super::Tick(DeltaTime);
+
+	for (const TPair<TObjectKey<UMaterialParameterCollection>, TSharedRef<FTerrainScanMPCBlock>>& Pair : Blocks)
+	{
+		Pair.Value->Flush();
+	}
+}
+
+TStatId UTerrainScanMPCSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTerrainScanMPCSubsystem, STATGROUP_Tickables);
+}
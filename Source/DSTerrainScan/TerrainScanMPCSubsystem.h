@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TerrainScanMPCSubsystem.generated.h"
+
+class UMaterialParameterCollection;
+class UMaterialParameterCollectionInstance;
+
+
+/** MPC scalar parameters written while a scan is running, or when the scan profile changes. */
+enum class ETerrainScanScalar : uint8
+{
+	TerrainScanRange,
+	EffectOpacity,
+	DarkCircleOpacity,
+	DarkCircleRange,
+	FootprintRelativeHighlightTime,
+	ActiveScanCount,
+	TerrainScanArcAngle,
+
+	// Appearance, see FScanAppearance
+	DistanceBetweenScanLines,
+	OutlineThickness,
+	ArcBlendFactor,
+	EdgeGradientStart,
+	EdgeGradientFalloff,
+	DarkCircleSize,
+
+	Num
+};
+
+/** MPC vector parameters written while a scan is running, or when the scan profile changes. */
+enum class ETerrainScanVector : uint8
+{
+	TerrainScanOrigin,
+	TerrainScanDirection,
+
+	// Appearance, see FScanAppearance
+	TerrainScanColor,
+	FirstLineColor,
+	EdgeGradientColorStart,
+	EdgeGradientColorEnd,
+
+	Num
+};
+
+
+/**
+ *	Packed copy of the per-frame scanner parameters of a single MPC. Writers only touch
+ *	the local values: the ones that actually changed are pushed to the collection
+ *	instance once per frame by UTerrainScanMPCSubsystem.
+ */
+class DSTERRAINSCAN_API FTerrainScanMPCBlock
+{
+public:
+
+	FTerrainScanMPCBlock(UWorld* InWorld, UMaterialParameterCollection* InCollection);
+
+	void SetScalar(ETerrainScanScalar Parameter, float Value);
+
+	void SetVector(ETerrainScanVector Parameter, const FLinearColor& Value);
+
+	float GetScalar(ETerrainScanScalar Parameter) const { return Scalars[static_cast<int32>(Parameter)]; }
+
+	bool IsDirty() const { return DirtyScalars != 0 || DirtyVectors != 0; }
+
+	/**
+	 * Pushes the dirty values to the collection instance. Called by the subsystem every frame, or
+	 * directly when the values must be seen earlier, e.g. by a scene capture of the same frame.
+	 */
+	void Flush();
+
+private:
+
+	/** Resolves the collection instance and which parameters it actually declares. */
+	bool Resolve();
+
+	TWeakObjectPtr<UWorld> World;
+
+	TWeakObjectPtr<UMaterialParameterCollection> Collection;
+
+	TWeakObjectPtr<UMaterialParameterCollectionInstance> Instance;
+
+	float Scalars[static_cast<int32>(ETerrainScanScalar::Num)] = {};
+
+	FLinearColor Vectors[static_cast<int32>(ETerrainScanVector::Num)];
+
+	uint32 DirtyScalars = 0;
+
+	uint32 DirtyVectors = 0;
+
+	/** Parameters missing from the collection are never flushed. */
+	uint32 ValidScalars = 0;
+
+	uint32 ValidVectors = 0;
+};
+
+
+/**
+ *	Owns one FTerrainScanMPCBlock per material parameter collection, so that every scanner
+ *	component writing the same collection shares a single flush per frame.
+ */
+UCLASS()
+class DSTERRAINSCAN_API UTerrainScanMPCSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Returns the block for the given collection, creating it on first request.
+	 * @param Collection MPC the block writes to.
+	 */
+	TSharedRef<FTerrainScanMPCBlock> GetBlock(UMaterialParameterCollection* Collection);
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	TMap<TObjectKey<UMaterialParameterCollection>, TSharedRef<FTerrainScanMPCBlock>> Blocks;
+};
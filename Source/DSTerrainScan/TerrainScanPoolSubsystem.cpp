@@ -0,0 +1,220 @@
+﻿#include "TerrainScanPoolSubsystem.h"
+#include "Engine/PostProcessVolume.h"
+#include "Engine/Texture2D.h"
+#include "EngineUtils.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "TerrainScanMPCSubsystem.h"
+
+UTerrainScanPoolSubsystem::UTerrainScanPoolSubsystem()
+{
+	for (int32& Dense : SlotToDense)
+	{
+		Dense = INDEX_NONE;
+	}
+}
+
+FTerrainScanHandle UTerrainScanPoolSubsystem::AddScan(const FVector& Origin, const FRotator& Rotation, float Angle,
+	double StartTime, const FScanKinematics& ScanKinematics)
+{
+	// Make room by evicting the oldest scan.
+	if (Origins.Num() == Capacity)
+	{
+		int32 OldestDense = 0;
+		for (int32 Dense = 1; Dense < StartTimes.Num(); ++Dense)
+		{
+			if (StartTimes[Dense] < StartTimes[OldestDense]) OldestDense = Dense;
+		}
+		RemoveDense(OldestDense);
+	}
+
+	int32 Slot = 0;
+	while (SlotToDense[Slot] != INDEX_NONE) ++Slot;
+
+	SlotToDense[Slot] = Origins.Num();
+	DenseToSlot.Add(Slot);
+
+	Origins.Add(Origin);
+	Directions.Add(FVector3f{Rotation.Vector()});
+	Angles.Add(Angle);
+	StartTimes.Add(StartTime);
+	Kinematics.Add(ScanKinematics);
+	Samples.Add(ScanKinematics.Evaluate(0.0f));
+
+	return FTerrainScanHandle{Slot, SlotSerials[Slot]};
+}
+
+void UTerrainScanPoolSubsystem::RemoveScan(FTerrainScanHandle Handle)
+{
+	if (!Handle.IsValid() || SlotSerials[Handle.Slot] != Handle.Serial) return;
+
+	if (SlotToDense[Handle.Slot] != INDEX_NONE)
+	{
+		RemoveDense(SlotToDense[Handle.Slot]);
+	}
+}
+
+bool UTerrainScanPoolSubsystem::IsScanActive(FTerrainScanHandle Handle) const
+{
+	return Handle.IsValid() && SlotSerials[Handle.Slot] == Handle.Serial && SlotToDense[Handle.Slot] != INDEX_NONE;
+}
+
+void UTerrainScanPoolSubsystem::SetParameterCollection(UMaterialParameterCollection* Collection)
+{
+	if (!Collection) return;
+
+	if (UTerrainScanMPCSubsystem* MPCSubsystem = GetWorld()->GetSubsystem<UTerrainScanMPCSubsystem>())
+	{
+		MPCBlock = MPCSubsystem->GetBlock(Collection);
+	}
+}
+
+void UTerrainScanPoolSubsystem::BindToMaterial(UMaterialInstanceDynamic* Material, FName ParameterName)
+{
+	if (!Material) return;
+
+	if (!ScanDataTexture) CreateScanDataTexture();
+
+	Material->SetTextureParameterValue(ParameterName, ScanDataTexture);
+}
+
+void UTerrainScanPoolSubsystem::BindPostProcessMaterial(UMaterialInterface* Material, FName ParameterName)
+{
+	if (!Material) return;
+
+	TObjectPtr<UMaterialInstanceDynamic>* Found = PostProcessInstances.FindByPredicate(
+		[Material](const UMaterialInstanceDynamic* Instance) { return Instance->Parent == Material; });
+
+	UMaterialInstanceDynamic* Instance = Found ? Found->Get() : nullptr;
+	if (!Instance)
+	{
+		Instance = PostProcessInstances.Add_GetRef(UMaterialInstanceDynamic::Create(Material, this));
+		BindToMaterial(Instance, ParameterName);
+	}
+
+	int32 NumReplaced = 0;
+	for (TActorIterator<APostProcessVolume> It(GetWorld()); It; ++It)
+	{
+		for (FWeightedBlendable& Blendable : It->Settings.WeightedBlendables.Array)
+		{
+			if (Blendable.Object != Material) continue;
+
+			Blendable.Object = Instance;
+			++NumReplaced;
+		}
+	}
+
+	// Already replaced by another scanner, or the material is not in a volume.
+	if (NumReplaced == 0 && !Found)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Terrain scan pool: no post-process volume blends %s, concurrent scans are not drawn."),
+			*Material->GetName());
+	}
+}
+
+void UTerrainScanPoolSubsystem::Deinitialize()
+{
+	MPCBlock.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTerrainScanPoolSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double CurrentTime = GetWorld()->GetTimeSeconds();
+
+	// Iterate backwards: swap-removals only move already evaluated scans.
+	for (int32 Dense = Origins.Num() - 1; Dense >= 0; --Dense)
+	{
+		Samples[Dense] = Kinematics[Dense].Evaluate(static_cast<float>(CurrentTime - StartTimes[Dense]));
+
+		if (Samples[Dense].AnimationState == EScannerAnimationState::Inactive)
+		{
+			RemoveDense(Dense);
+		}
+	}
+
+	UploadScanData(CurrentTime);
+
+	if (MPCBlock)
+	{
+		MPCBlock->SetScalar(ETerrainScanScalar::ActiveScanCount, static_cast<float>(Origins.Num()));
+	}
+
+	bClearPending = false;
+}
+
+TStatId UTerrainScanPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTerrainScanPoolSubsystem, STATGROUP_Tickables);
+}
+
+void UTerrainScanPoolSubsystem::RemoveDense(int32 DenseIndex)
+{
+	const int32 Slot = DenseToSlot[DenseIndex];
+	SlotToDense[Slot] = INDEX_NONE;
+	++SlotSerials[Slot];
+
+	Origins.RemoveAtSwap(DenseIndex, EAllowShrinking::No);
+	Directions.RemoveAtSwap(DenseIndex, EAllowShrinking::No);
+	Angles.RemoveAtSwap(DenseIndex, EAllowShrinking::No);
+	StartTimes.RemoveAtSwap(DenseIndex, EAllowShrinking::No);
+	Kinematics.RemoveAtSwap(DenseIndex, EAllowShrinking::No);
+	Samples.RemoveAtSwap(DenseIndex, EAllowShrinking::No);
+	DenseToSlot.RemoveAtSwap(DenseIndex, EAllowShrinking::No);
+
+	// Fix the indirection of the scan moved into the freed position.
+	if (DenseToSlot.IsValidIndex(DenseIndex))
+	{
+		SlotToDense[DenseToSlot[DenseIndex]] = DenseIndex;
+	}
+
+	bClearPending = Origins.IsEmpty();
+}
+
+void UTerrainScanPoolSubsystem::CreateScanDataTexture()
+{
+	ScanDataTexture = UTexture2D::CreateTransient(Capacity, TexelsPerScan, PF_A32B32G32R32F, TEXT("TerrainScanData"));
+	ScanDataTexture->SRGB = false;
+	ScanDataTexture->Filter = TF_Nearest;
+	ScanDataTexture->AddressX = TA_Clamp;
+	ScanDataTexture->AddressY = TA_Clamp;
+	ScanDataTexture->UpdateResource();
+}
+
+void UTerrainScanPoolSubsystem::UploadScanData(double CurrentTime)
+{
+	const int32 NumScans = Origins.Num();
+	if (NumScans == 0 || !ScanDataTexture || !FApp::CanEverRender()) return;
+
+	// Only the columns of active scans are uploaded: the material reads _Terrain_Scan_Count of them.
+	FLinearColor* Data = new FLinearColor[NumScans * TexelsPerScan];
+
+	for (int32 Dense = 0; Dense < NumScans; ++Dense)
+	{
+		const FScanKinematicsSample& Sample = Samples[Dense];
+
+		Data[Dense] = FLinearColor{
+			static_cast<float>(Origins[Dense].X),
+			static_cast<float>(Origins[Dense].Y),
+			static_cast<float>(Origins[Dense].Z),
+			Sample.Range};
+
+		Data[NumScans + Dense] = FLinearColor{Directions[Dense].X, Directions[Dense].Y, Directions[Dense].Z,
+			Angles[Dense]};
+
+		Data[2 * NumScans + Dense] = FLinearColor{Sample.Opacity, Sample.DarkCircleOpacity,
+			static_cast<float>(CurrentTime - StartTimes[Dense]), static_cast<float>(Sample.AnimationState)};
+	}
+
+	FUpdateTextureRegion2D* Region = new FUpdateTextureRegion2D(0, 0, 0, 0, NumScans, TexelsPerScan);
+
+	ScanDataTexture->UpdateTextureRegions(0, 1, Region, NumScans * sizeof(FLinearColor), sizeof(FLinearColor),
+		reinterpret_cast<uint8*>(Data),
+		[](uint8* SrcData, const FUpdateTextureRegion2D* Regions)
+		{
+			delete[] reinterpret_cast<FLinearColor*>(SrcData);
+			delete Regions;
+		});
+}
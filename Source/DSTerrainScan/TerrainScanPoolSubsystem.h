@@ -0,0 +1,142 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ScanKinematics.h"
+#include "TerrainScanPoolSubsystem.generated.h"
+
+class UTexture2D;
+class UMaterialInstanceDynamic;
+class UMaterialInterface;
+class UMaterialParameterCollection;
+class FTerrainScanMPCBlock;
+
+
+/**
+ *	Identifies a scan registered in UTerrainScanPoolSubsystem. Becomes stale
+ *	once the scan ends or is evicted.
+ */
+struct FTerrainScanHandle
+{
+	int32 Slot = INDEX_NONE;
+
+	uint32 Serial = 0;
+
+	bool IsValid() const { return Slot != INDEX_NONE; }
+};
+
+
+/**
+ *	Fixed-capacity pool of concurrent scans, from any number of scanner components.
+ *	Active scans are stored densely in SoA layout and evaluated once per frame, then
+ *	packed into a float texture sampled by the terrain scan post-process material.
+ *	Per-frame cost only depends on the number of active scans.
+ *
+ *	Texture layout: one column per active scan, with rows
+ *	  0: Origin.xyz, Range
+ *	  1: Direction.xyz, Angle
+ *	  2: Opacity, DarkCircleOpacity, TimeSinceStart, AnimationState
+ *	The number of valid columns is written to the _Terrain_Scan_Count MPC scalar. Nothing is
+ *	uploaded until a material is bound to the texture, see BindPostProcessMaterial.
+ */
+UCLASS()
+class DSTERRAINSCAN_API UTerrainScanPoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UTerrainScanPoolSubsystem();
+
+	static constexpr int32 Capacity = 32;
+
+	static constexpr int32 TexelsPerScan = 3;
+
+	/**
+	 * Registers a new scan. When the pool is full the oldest scan is evicted.
+	 *
+	 * @param StartTime world time the scan started at.
+	 * @param Kinematics evaluator of the scan lifecycle.
+	 * @return handle to the new scan.
+	 */
+	FTerrainScanHandle AddScan(const FVector& Origin, const FRotator& Rotation, float Angle, double StartTime,
+		const FScanKinematics& Kinematics);
+
+	void RemoveScan(FTerrainScanHandle Handle);
+
+	/** Returns false once the scan has ended, or was removed or evicted. */
+	bool IsScanActive(FTerrainScanHandle Handle) const;
+
+	/** Collection receiving the active scans count. */
+	void SetParameterCollection(UMaterialParameterCollection* Collection);
+
+	int32 GetNumActiveScans() const { return Origins.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Terrain Scan")
+	UTexture2D* GetScanDataTexture() const { return ScanDataTexture; }
+
+	/**
+	 * Sets the scan data texture on a material instance (e.g. the terrain scan post-process).
+	 * @param ParameterName texture parameter of the material.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Terrain Scan")
+	void BindToMaterial(UMaterialInstanceDynamic* Material, FName ParameterName);
+
+	/**
+	 * Replaces the given post-process material in the blendables of every post-process volume of the
+	 * world with a dynamic instance of it, bound to the scan data texture.
+	 * @param ParameterName texture parameter of the material.
+	 */
+	void BindPostProcessMaterial(UMaterialInterface* Material, FName ParameterName);
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual bool IsTickable() const override { return !Origins.IsEmpty() || bClearPending; }
+
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	void RemoveDense(int32 DenseIndex);
+
+	void CreateScanDataTexture();
+
+	void UploadScanData(double CurrentTime);
+
+	/** Created by the first binding. */
+	UPROPERTY(Transient)
+	TObjectPtr<UTexture2D> ScanDataTexture;
+
+	/** Instances created by BindPostProcessMaterial, one per post-process material. */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UMaterialInstanceDynamic>> PostProcessInstances;
+
+	TSharedPtr<FTerrainScanMPCBlock> MPCBlock;
+
+	/** Set when the last scan ends, so that the count gets cleared once. */
+	bool bClearPending = false;
+
+	// Dense SoA storage of the active scans.
+
+	TArray<FVector> Origins;
+
+	TArray<FVector3f> Directions;
+
+	TArray<float> Angles;
+
+	TArray<double> StartTimes;
+
+	TArray<FScanKinematics> Kinematics;
+
+	TArray<FScanKinematicsSample> Samples;
+
+	TArray<int32> DenseToSlot;
+
+	// Slot indirection, so that handles survive swap-removals in the dense arrays.
+
+	int32 SlotToDense[Capacity];
+
+	uint32 SlotSerials[Capacity] = {};
+};
@@ -0,0 +1,32 @@
+﻿#include "TerrainScanStats.h"
+
+UE_TRACE_CHANNEL_DEFINE(TerrainScanChannel);
+
+DEFINE_STAT(STAT_TerrainScan_ScannerTick);
+DEFINE_STAT(STAT_TerrainScan_IconsTick);
+DEFINE_STAT(STAT_TerrainScan_FootprintsTick);
+DEFINE_STAT(STAT_TerrainScan_CrowdTick);
+DEFINE_STAT(STAT_TerrainScan_MPCFlush);
+DEFINE_STAT(STAT_TerrainScan_StartScanner);
+DEFINE_STAT(STAT_TerrainScan_StartIcons);
+DEFINE_STAT(STAT_TerrainScan_StartFootprints);
+DEFINE_STAT(STAT_TerrainScan_LiveFootprints);
+DEFINE_STAT(STAT_TerrainScan_FootprintMemory);
+DEFINE_STAT(STAT_TerrainScan_DecalPoolSize);
+DEFINE_STAT(STAT_TerrainScan_CaptureTargetMemory);
+
+DEFINE_STAT(STAT_TerrainScan_ReadbackCopyLatency);
+DEFINE_STAT(STAT_TerrainScan_ReadbackGPULatency);
+DEFINE_STAT(STAT_TerrainScan_ReadbackDeliveryLatency);
+DEFINE_STAT(STAT_TerrainScan_ReadbackDropped);
+DEFINE_STAT(STAT_TerrainScan_TileCacheHits);
+DEFINE_STAT(STAT_TerrainScan_TileCacheMisses);
+DEFINE_STAT(STAT_TerrainScan_TileCacheMemory);
+DEFINE_STAT(STAT_TerrainScan_DecalPoolHits);
+DEFINE_STAT(STAT_TerrainScan_DecalPoolMisses);
+DEFINE_STAT(STAT_TerrainScan_DecalPoolAllocations);
+DEFINE_STAT(STAT_TerrainScan_FootstepTraces);
+DEFINE_STAT(STAT_TerrainScan_FootstepTracesDropped);
+DEFINE_STAT(STAT_TerrainScan_FootstepTraceLatency);
+DEFINE_STAT(STAT_TerrainScan_NetScanStarts);
+DEFINE_STAT(STAT_TerrainScan_NetScanBits);
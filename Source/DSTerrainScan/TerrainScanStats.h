@@ -0,0 +1,72 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+/** Shown with "stat TerrainScan". */
+DECLARE_STATS_GROUP(TEXT("TerrainScan"), STATGROUP_TerrainScan, STATCAT_Advanced);
+
+/**
+ * Insights channel of the scan events, e.g. scan phase transitions as timeline bookmarks.
+ * Enabled with -trace=default,TerrainScan.
+ */
+UE_TRACE_CHANNEL_EXTERN(TerrainScanChannel, DSTERRAINSCAN_API);
+
+/**
+ * Times the enclosing scope in stat TerrainScan, and as a CPU event in Unreal Insights. The
+ * latter is kept in builds without stats, e.g. Shipping with -trace=cpu.
+ */
+#define TERRAIN_SCAN_SCOPE_CYCLE_COUNTER(StatName) \
+	SCOPE_CYCLE_COUNTER(StatName); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(StatName)
+
+// Component ticks and scan starts
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Scanner Tick"), STAT_TerrainScan_ScannerTick, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Icons Tick"), STAT_TerrainScan_IconsTick, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Footprints Tick"), STAT_TerrainScan_FootprintsTick, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Footprints Tick"), STAT_TerrainScan_CrowdTick, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MPC Flush"), STAT_TerrainScan_MPCFlush, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Start Scanner Lifecycle"), STAT_TerrainScan_StartScanner, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Start Icons Lifecycle"), STAT_TerrainScan_StartIcons, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Start Footprints Lifecycle"), STAT_TerrainScan_StartFootprints, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+
+// Footprints and capture memory
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Footprints"), STAT_TerrainScan_LiveFootprints, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Footprint Store Memory"), STAT_TerrainScan_FootprintMemory, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Decal Pool Size"), STAT_TerrainScan_DecalPoolSize, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Capture Target Memory"), STAT_TerrainScan_CaptureTargetMemory, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+
+// Scene capture readback
+
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Readback Copy Latency (ms)"), STAT_TerrainScan_ReadbackCopyLatency, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Readback GPU Latency (ms)"), STAT_TerrainScan_ReadbackGPULatency, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Readback Delivery Latency (ms)"), STAT_TerrainScan_ReadbackDeliveryLatency, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Readback Dropped Requests"), STAT_TerrainScan_ReadbackDropped, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+
+// Classified terrain tile cache
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Tile Cache Hits"), STAT_TerrainScan_TileCacheHits, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Tile Cache Misses"), STAT_TerrainScan_TileCacheMisses, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Tile Cache Memory"), STAT_TerrainScan_TileCacheMemory, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+
+
+// Footprint decal pool
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Decal Pool Hits"), STAT_TerrainScan_DecalPoolHits, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Decal Pool Misses"), STAT_TerrainScan_DecalPoolMisses, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Decal Pool Allocations"), STAT_TerrainScan_DecalPoolAllocations, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+
+// Footstep ground traces
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Footstep Traces"), STAT_TerrainScan_FootstepTraces, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Footstep Traces Dropped"), STAT_TerrainScan_FootstepTracesDropped, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Footstep Trace Latency (ms)"), STAT_TerrainScan_FootstepTraceLatency, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+
+// Scan replication, counted on the server
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Replicated Scan Starts"), STAT_TerrainScan_NetScanStarts, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Replicated Scan Bits"), STAT_TerrainScan_NetScanBits, STATGROUP_TerrainScan, DSTERRAINSCAN_API);
\ No newline at end of file
@@ -0,0 +1,386 @@
+﻿#include "TerrainScanTileCacheSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "TerrainClassifier.h"
+#include "TerrainScanStats.h"
+#include "TerrainScanAtlas.h"
+#include "Misc/PackageName.h"
+#include "Engine/Level.h"
+#include "Engine/LevelBounds.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+static TAutoConsoleVariable<int32> CVarTerrainScanTileCacheBudgetMB(
+	TEXT("TerrainScan.TileCacheBudgetMB"),
+	16,
+	TEXT("Memory budget of each classified terrain tile cache, in megabytes. Read when a cache is created."));
+
+static TAutoConsoleVariable<bool> CVarTerrainScanUseBakedAtlas(
+	TEXT("TerrainScan.UseBakedAtlas"),
+	true,
+	TEXT("If true, tile caches stream missing tiles from the baked classification atlas of the map. Read at begin play."));
+
+static_assert(sizeof(FTerrainScanAtlasTile::PackedTypes) == sizeof(FTerrainScanTile::PackedTypes)
+	&& sizeof(FTerrainScanAtlasTile::QuantizedHeights) == sizeof(FTerrainScanTile::QuantizedHeights),
+	"Baked tiles must match the cached ones.");
+
+
+FTerrainScanTile::FTerrainScanTile()
+{
+	FMemory::Memset(PackedTypes, 0xFF, sizeof(PackedTypes));
+	FMemory::Memzero(QuantizedHeights, sizeof(QuantizedHeights));
+}
+
+FTerrainScanTile::FTerrainScanTile(const FTerrainScanAtlasTile& BakedTile)
+	: BaseHeight(BakedTile.BaseHeight)
+	, WriteTime(FPlatformTime::Seconds())
+	, NumKnownCells(BakedTile.NumKnownCells)
+	, bHasBaseHeight(true)
+{
+	FMemory::Memcpy(PackedTypes, BakedTile.PackedTypes, sizeof(PackedTypes));
+	FMemory::Memcpy(QuantizedHeights, BakedTile.QuantizedHeights, sizeof(QuantizedHeights));
+}
+
+void FTerrainScanTile::SetCell(int32 CellIndex, uint8 Type, float Height)
+{
+	check(CellIndex >= 0 && CellIndex < NumCells);
+
+	// The first height written centers the quantization range.
+	if (!bHasBaseHeight)
+	{
+		BaseHeight = Height;
+		bHasBaseHeight = true;
+	}
+
+	if (!IsCellKnown(CellIndex)) ++NumKnownCells;
+
+	const int32 Shift = (CellIndex & 1) * 4;
+	uint8& Packed = PackedTypes[CellIndex >> 1];
+	Packed = (Packed & ~(0xF << Shift)) | ((FMath::Min<uint8>(Type, UnknownType - 1) & 0xF) << Shift);
+
+	const int32 Quantized = FMath::RoundToInt32((Height - BaseHeight) / HeightQuantum) + 32768;
+	QuantizedHeights[CellIndex] = static_cast<uint16>(FMath::Clamp(Quantized, 0, 65535));
+}
+
+bool FTerrainScanTile::GetCell(int32 CellIndex, uint8& OutType, float& OutHeight) const
+{
+	check(CellIndex >= 0 && CellIndex < NumCells);
+
+	OutType = GetType(CellIndex);
+	if (OutType == UnknownType) return false;
+
+	OutHeight = BaseHeight + (static_cast<int32>(QuantizedHeights[CellIndex]) - 32768) * HeightQuantum;
+	return true;
+}
+
+
+FTerrainScanTileCache::FTerrainScanTileCache(float InCellSize, int64 BudgetBytes)
+	: CellSize(FMath::Max(InCellSize, 1.0f))
+	, Tiles(static_cast<int32>(FMath::Clamp<int64>(BudgetBytes / sizeof(FTerrainScanTile), 1, MAX_int32)))
+{
+}
+
+FIntPoint FTerrainScanTileCache::GetCell(const FVector2D& Location) const
+{
+	return FIntPoint{FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize)};
+}
+
+FIntPoint FTerrainScanTileCache::GetTileKey(const FIntPoint& Cell)
+{
+	// Arithmetic shifts floor negative cells too.
+	constexpr int32 Shift = FMath::ConstExprCeilLogTwo(FTerrainScanTile::CellsPerSide);
+	return FIntPoint{Cell.X >> Shift, Cell.Y >> Shift};
+}
+
+int32 FTerrainScanTileCache::GetCellIndex(const FIntPoint& Cell)
+{
+	constexpr int32 Mask = FTerrainScanTile::CellsPerSide - 1;
+	return (Cell.X & Mask) * FTerrainScanTile::CellsPerSide + (Cell.Y & Mask);
+}
+
+FTerrainScanTile* FTerrainScanTileCache::FindTile(const FIntPoint& TileKey)
+{
+	if (const TSharedPtr<FTerrainScanTile>* Tile = Tiles.FindAndTouch(TileKey))
+	{
+		return Tile->Get();
+	}
+
+	if (!Atlas || InvalidatedAtlasTiles.Contains(TileKey)) return nullptr;
+
+	const FTerrainScanAtlasTile* BakedTile = Atlas->FindTile(TileKey);
+	if (!BakedTile) return nullptr;
+
+	TSharedPtr<FTerrainScanTile> NewTile = MakeShared<FTerrainScanTile>(*BakedTile);
+	FTerrainScanTile* Tile = NewTile.Get();
+	Tiles.Add(TileKey, MoveTemp(NewTile));
+	return Tile;
+}
+
+void FTerrainScanTileCache::SetAtlas(TSharedPtr<const FTerrainScanAtlas> InAtlas)
+{
+	if (InAtlas && !FMath::IsNearlyEqual(InAtlas->GetCellSize(), CellSize))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Terrain scan atlas baked with cell size %f, cache uses %f: atlas ignored."),
+			InAtlas->GetCellSize(), CellSize);
+		return;
+	}
+
+	Atlas = MoveTemp(InAtlas);
+}
+
+template<typename VisitorType>
+void FTerrainScanTileCache::ForEachGridCell(int32 GridX, int32 GridY, const FVector& GridCenter, float Yaw,
+	float Padding, VisitorType&& Visitor) const
+{
+	// Same layout as the icons grid: rows advance along the scan direction, cells along its right vector.
+	const FRotationMatrix Rotation{FRotator{0.0f, Yaw, 0.0f}};
+	const FVector2D Forward{Rotation.GetUnitAxis(EAxis::X)};
+	const FVector2D Right{Rotation.GetUnitAxis(EAxis::Y)};
+	const FVector2D Center{GridCenter};
+
+	for (int32 X = 0; X < GridX; ++X)
+	{
+		const FVector2D RowCenter = Center + Forward * ((X - (GridX - 1) * 0.5f) * Padding);
+
+		for (int32 Y = 0; Y < GridY; ++Y)
+		{
+			const FVector2D Location = RowCenter + Right * ((Y - (GridY - 1) * 0.5f) * Padding);
+			if (!Visitor(X * GridY + Y, GetCell(Location))) return;
+		}
+	}
+}
+
+void FTerrainScanTileCache::AddClassification(const FTerrainClassificationResult& Result, const FVector& GridCenter,
+	float Yaw, float Padding)
+{
+	if (Result.Types.Num() != Result.GridX * Result.GridY || Result.Heights.Num() != Result.Types.Num()) return;
+
+	// Same layout as ForEachGridCell, walked the other way: from world cells to grid cells.
+	const FRotationMatrix Rotation{FRotator{0.0f, Yaw, 0.0f}};
+	const FVector2D Forward{Rotation.GetUnitAxis(EAxis::X)};
+	const FVector2D Right{Rotation.GetUnitAxis(EAxis::Y)};
+	const FVector2D Center{GridCenter};
+
+	const double HalfLength = Result.GridX * Padding * 0.5;
+	const double HalfWidth = Result.GridY * Padding * 0.5;
+	const FVector2D Extent{FMath::Abs(Forward.X) * HalfLength + FMath::Abs(Right.X) * HalfWidth,
+		FMath::Abs(Forward.Y) * HalfLength + FMath::Abs(Right.Y) * HalfWidth};
+
+	const FIntPoint MinCell = GetCell(Center - Extent);
+	const FIntPoint MaxCell = GetCell(Center + Extent);
+	const double Now = FPlatformTime::Seconds();
+
+	// Consecutive cells mostly fall in the same tile: skip the lookup when they do.
+	FIntPoint CurrentKey{MAX_int32, MAX_int32};
+	FTerrainScanTile* CurrentTile = nullptr;
+
+	for (int32 CellX = MinCell.X; CellX <= MaxCell.X; ++CellX)
+	{
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; ++CellY)
+		{
+			const FVector2D Offset = FVector2D{(CellX + 0.5) * CellSize, (CellY + 0.5) * CellSize} - Center;
+			const int32 X = FMath::RoundToInt32((Offset | Forward) / Padding + (Result.GridX - 1) * 0.5);
+			const int32 Y = FMath::RoundToInt32((Offset | Right) / Padding + (Result.GridY - 1) * 0.5);
+
+			if (X < 0 || X >= Result.GridX || Y < 0 || Y >= Result.GridY) continue;
+
+			const FIntPoint Cell{CellX, CellY};
+			const FIntPoint Key = GetTileKey(Cell);
+			if (Key != CurrentKey)
+			{
+				CurrentKey = Key;
+				CurrentTile = FindTile(Key);
+
+				if (!CurrentTile)
+				{
+					TSharedPtr<FTerrainScanTile> NewTile = MakeShared<FTerrainScanTile>();
+					CurrentTile = NewTile.Get();
+					Tiles.Add(Key, MoveTemp(NewTile));
+				}
+
+				CurrentTile->WriteTime = Now;
+			}
+
+			const int32 GridCell = X * Result.GridY + Y;
+			CurrentTile->SetCell(GetCellIndex(Cell), Result.Types[GridCell], Result.Heights[GridCell]);
+		}
+	}
+
+	SET_MEMORY_STAT(STAT_TerrainScan_TileCacheMemory, GetAllocatedBytes());
+}
+
+bool FTerrainScanTileCache::IsGridCovered(int32 GridX, int32 GridY, const FVector& GridCenter, float Yaw, float Padding)
+{
+	FIntPoint CurrentKey{MAX_int32, MAX_int32};
+	const FTerrainScanTile* CurrentTile = nullptr;
+	bool bCovered = true;
+
+	ForEachGridCell(GridX, GridY, GridCenter, Yaw, Padding, [&](int32 GridCell, const FIntPoint& Cell)
+	{
+		const FIntPoint Key = GetTileKey(Cell);
+		if (Key != CurrentKey)
+		{
+			CurrentKey = Key;
+			CurrentTile = FindTile(Key);
+		}
+
+		bCovered = CurrentTile && CurrentTile->IsCellKnown(GetCellIndex(Cell));
+		return bCovered;
+	});
+
+	return bCovered;
+}
+
+bool FTerrainScanTileCache::BuildClassification(int32 GridX, int32 GridY, const FVector& GridCenter, float Yaw,
+	float Padding, FTerrainClassificationResult& OutResult, double& OutWriteTime)
+{
+	OutResult.GridX = GridX;
+	OutResult.GridY = GridY;
+	OutResult.Types.SetNumUninitialized(GridX * GridY);
+	OutResult.Heights.SetNumUninitialized(GridX * GridY);
+
+	FIntPoint CurrentKey{MAX_int32, MAX_int32};
+	const FTerrainScanTile* CurrentTile = nullptr;
+	bool bComplete = true;
+	OutWriteTime = TNumericLimits<double>::Max();
+
+	ForEachGridCell(GridX, GridY, GridCenter, Yaw, Padding, [&](int32 GridCell, const FIntPoint& Cell)
+	{
+		const FIntPoint Key = GetTileKey(Cell);
+		if (Key != CurrentKey)
+		{
+			CurrentKey = Key;
+			CurrentTile = FindTile(Key);
+
+			if (CurrentTile) OutWriteTime = FMath::Min(OutWriteTime, CurrentTile->WriteTime);
+		}
+
+		bComplete = CurrentTile
+			&& CurrentTile->GetCell(GetCellIndex(Cell), OutResult.Types[GridCell], OutResult.Heights[GridCell]);
+		return bComplete;
+	});
+
+	return bComplete;
+}
+
+void FTerrainScanTileCache::InvalidateRegion(const FBox2D& Region, bool bKeepAtlas)
+{
+	if (!Region.bIsValid) return;
+
+	const FIntPoint MinKey = GetTileKey(GetCell(Region.Min));
+	const FIntPoint MaxKey = GetTileKey(GetCell(Region.Max));
+
+	for (int32 X = MinKey.X; X <= MaxKey.X; ++X)
+	{
+		for (int32 Y = MinKey.Y; Y <= MaxKey.Y; ++Y)
+		{
+			Tiles.Remove(FIntPoint{X, Y});
+
+			if (Atlas && !bKeepAtlas) InvalidatedAtlasTiles.Add(FIntPoint{X, Y});
+		}
+	}
+
+	SET_MEMORY_STAT(STAT_TerrainScan_TileCacheMemory, GetAllocatedBytes());
+}
+
+void FTerrainScanTileCache::Empty()
+{
+	Tiles.Empty(Tiles.Max());
+
+	SET_MEMORY_STAT(STAT_TerrainScan_TileCacheMemory, 0);
+}
+
+
+TSharedRef<FTerrainScanTileCache> UTerrainScanTileCacheSubsystem::GetCache(float CellSize)
+{
+	if (const TSharedRef<FTerrainScanTileCache>* Cache = Caches.Find(CellSize))
+	{
+		return *Cache;
+	}
+
+	const int64 BudgetBytes = static_cast<int64>(FMath::Max(CVarTerrainScanTileCacheBudgetMB.GetValueOnGameThread(), 1)) << 20;
+	TSharedRef<FTerrainScanTileCache> Cache = MakeShared<FTerrainScanTileCache>(CellSize, BudgetBytes);
+	Cache->SetAtlas(Atlas);
+	return Caches.Add(CellSize, Cache);
+}
+
+void UTerrainScanTileCacheSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	ActorSpawnedHandle = InWorld.AddOnActorSpawnedHandler(
+		FOnActorSpawned::FDelegate::CreateUObject(this, &UTerrainScanTileCacheSubsystem::HandleActorChanged));
+	ActorDestroyedHandle = InWorld.AddOnActorDestroyedHandler(
+		FOnActorDestroyed::FDelegate::CreateUObject(this, &UTerrainScanTileCacheSubsystem::HandleActorChanged));
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this,
+		&UTerrainScanTileCacheSubsystem::HandleLevelChanged);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this,
+		&UTerrainScanTileCacheSubsystem::HandleLevelChanged);
+
+	if (!CVarTerrainScanUseBakedAtlas.GetValueOnGameThread()) return;
+
+	const FString MapName = FPackageName::GetShortName(UWorld::RemovePIEPrefix(InWorld.GetOutermost()->GetName()));
+	Atlas = FTerrainScanAtlas::Open(FTerrainScanAtlas::GetAtlasFilename(MapName));
+	if (!Atlas) return;
+
+	// Caches requested before begin play.
+	for (const TPair<float, TSharedRef<FTerrainScanTileCache>>& Pair : Caches)
+	{
+		Pair.Value->SetAtlas(Atlas);
+	}
+}
+
+void UTerrainScanTileCacheSubsystem::HandleActorChanged(AActor* Actor)
+{
+	const UWorld* World = GetWorld();
+	if (!Actor || !World || World->bIsTearingDown || Caches.IsEmpty()) return;
+
+	// Movable actors, e.g. pawns and projectiles, are not terrain.
+	if (!Actor->IsRootComponentStatic() && !Actor->IsRootComponentStationary()) return;
+
+	InvalidateArea(Actor->GetComponentsBoundingBox(true), false);
+}
+
+void UTerrainScanTileCacheSubsystem::HandleLevelChanged(ULevel* Level, UWorld* World)
+{
+	if (!Level || World != GetWorld() || Caches.IsEmpty()) return;
+
+	// The atlas was baked with every level loaded.
+	InvalidateArea(ALevelBounds::CalculateLevelBounds(Level), true);
+}
+
+void UTerrainScanTileCacheSubsystem::InvalidateRegion(const FBox& Region)
+{
+	InvalidateArea(Region, false);
+}
+
+void UTerrainScanTileCacheSubsystem::InvalidateArea(const FBox& Region, bool bKeepAtlas)
+{
+	if (!Region.IsValid) return;
+
+	const FBox2D Region2D{FVector2D{Region.Min}, FVector2D{Region.Max}};
+
+	for (const TPair<float, TSharedRef<FTerrainScanTileCache>>& Pair : Caches)
+	{
+		Pair.Value->InvalidateRegion(Region2D, bKeepAtlas);
+	}
+}
+
+void UTerrainScanTileCacheSubsystem::Deinitialize()
+{
+	if (UWorld* World = GetWorld())
+	{
+		World->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+		World->RemoveOnActorDestroyededHandler(ActorDestroyedHandle);
+	}
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	for (const TPair<float, TSharedRef<FTerrainScanTileCache>>& Pair : Caches)
+	{
+		Pair.Value->Empty();
+	}
+	Caches.Empty();
+	Atlas.Reset();
+
+	Super::Deinitialize();
+}
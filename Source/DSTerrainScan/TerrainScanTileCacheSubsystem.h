@@ -0,0 +1,206 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TerrainScanTileCacheSubsystem.generated.h"
+
+enum class ETerrainType : int32;
+struct FTerrainClassificationResult;
+struct FTerrainScanAtlasTile;
+class FTerrainScanAtlas;
+
+
+/**
+ *	Classified terrain over CellsPerSide x CellsPerSide world-aligned cells. Each cell stores
+ *	a 4-bit ETerrainType and a 16-bit height, quantized relative to the tile base height.
+ */
+struct DSTERRAINSCAN_API FTerrainScanTile
+{
+	static constexpr int32 CellsPerSide = 32;
+
+	static_assert(FMath::IsPowerOfTwo(CellsPerSide), "Tile keys are computed with shifts.");
+
+	static constexpr int32 NumCells = CellsPerSide * CellsPerSide;
+
+	/** Type nibble of cells never written. */
+	static constexpr uint8 UnknownType = 0xF;
+
+	/** Height step of the quantization, in Unreal Units. Covers +-655 meters around the base height. */
+	static constexpr float HeightQuantum = 2.0f;
+
+	FTerrainScanTile();
+
+	/** Copies a tile baked into a FTerrainScanAtlas. */
+	explicit FTerrainScanTile(const FTerrainScanAtlasTile& BakedTile);
+
+	void SetCell(int32 CellIndex, uint8 Type, float Height);
+
+	/** @return false if the cell was never written. */
+	bool GetCell(int32 CellIndex, uint8& OutType, float& OutHeight) const;
+
+	bool IsCellKnown(int32 CellIndex) const { return GetType(CellIndex) != UnknownType; }
+
+	int32 GetNumKnownCells() const { return NumKnownCells; }
+
+	/** Two cells per byte, low nibble first. */
+	uint8 PackedTypes[NumCells / 2];
+
+	uint16 QuantizedHeights[NumCells];
+
+	float BaseHeight = 0.0f;
+
+	/** FPlatformTime::Seconds() of the last write, or of the copy from the atlas. */
+	double WriteTime = 0.0;
+
+private:
+
+	uint8 GetType(int32 CellIndex) const { return (PackedTypes[CellIndex >> 1] >> ((CellIndex & 1) * 4)) & 0xF; }
+
+	int32 NumKnownCells = 0;
+
+	bool bHasBaseHeight = false;
+};
+
+
+/**
+ *	Persistent cache of classified terrain, keyed by world-aligned tile coordinates and
+ *	evicted in least-recently-used order once the memory budget is reached. Filled from
+ *	scan classifications, so that scanning an already cached area can skip the captures.
+ */
+class DSTERRAINSCAN_API FTerrainScanTileCache
+{
+public:
+
+	/**
+	 * @param InCellSize world size of a cell, in Unreal Units.
+	 * @param BudgetBytes maximum memory used by the tiles.
+	 */
+	FTerrainScanTileCache(float InCellSize, int64 BudgetBytes);
+
+	/**
+	 * Writes a scan classification into the cache. Every world cell whose center lies in the grid area
+	 * takes the nearest grid cell, so that later grids at another yaw find the whole area.
+	 *
+	 * @param Result classified icons grid.
+	 * @param GridCenter world location of the grid center.
+	 * @param Yaw scan yaw: grid rows advance along it.
+	 * @param Padding distance between grid cells.
+	 */
+	void AddClassification(const FTerrainClassificationResult& Result, const FVector& GridCenter, float Yaw,
+		float Padding);
+
+	/** Returns true if every cell of the described grid is cached. Touches the tiles it visits. */
+	bool IsGridCovered(int32 GridX, int32 GridY, const FVector& GridCenter, float Yaw, float Padding);
+
+	/**
+	 * Builds a classification of the described grid from cached cells only.
+	 *
+	 * @param OutWriteTime receives the WriteTime of the oldest tile read.
+	 * @return false if any cell is missing.
+	 */
+	bool BuildClassification(int32 GridX, int32 GridY, const FVector& GridCenter, float Yaw, float Padding,
+		FTerrainClassificationResult& OutResult, double& OutWriteTime);
+
+	/**
+	 * Drops every tile overlapping the given area, e.g. after dynamic geometry changed there.
+	 * @param bKeepAtlas if true, the baked tiles of the area are still valid and streamed again.
+	 */
+	void InvalidateRegion(const FBox2D& Region, bool bKeepAtlas = false);
+
+	void Empty();
+
+	/**
+	 * Sets the baked atlas tiles are streamed from when missing from the cache.
+	 * Ignored if the atlas was baked with another cell size.
+	 */
+	void SetAtlas(TSharedPtr<const FTerrainScanAtlas> InAtlas);
+
+	int32 GetNumTiles() const { return Tiles.Num(); }
+
+	int64 GetAllocatedBytes() const { return static_cast<int64>(Tiles.Num()) * sizeof(FTerrainScanTile); }
+
+	float GetCellSize() const { return CellSize; }
+
+private:
+
+	/** World cell containing the given location. */
+	FIntPoint GetCell(const FVector2D& Location) const;
+
+	static FIntPoint GetTileKey(const FIntPoint& Cell);
+
+	static int32 GetCellIndex(const FIntPoint& Cell);
+
+	/** Cached tile with the given key, streamed from the atlas if needed. Touches it. */
+	FTerrainScanTile* FindTile(const FIntPoint& TileKey);
+
+	/** Calls Visitor(GridCell, WorldCell) for every cell of the described grid. */
+	template<typename VisitorType>
+	void ForEachGridCell(int32 GridX, int32 GridY, const FVector& GridCenter, float Yaw, float Padding,
+		VisitorType&& Visitor) const;
+
+	float CellSize;
+
+	TLruCache<FIntPoint, TSharedPtr<FTerrainScanTile>> Tiles;
+
+	TSharedPtr<const FTerrainScanAtlas> Atlas;
+
+	/** Tiles whose baked data is stale, never streamed from the atlas again. */
+	TSet<FIntPoint> InvalidatedAtlasTiles;
+};
+
+
+/**
+ *	Owns one FTerrainScanTileCache per cell size, so that every icons component of the world
+ *	shares the terrain it already classified. The memory budget of each cache is read from
+ *	TerrainScan.TileCacheBudgetMB when the cache is created. If the map has a baked atlas
+ *	(see UTerrainScanBakeCommandlet), the caches stream their missing tiles from it.
+ *
+ *	Cached terrain is invalidated where the world changes: under static and stationary actors
+ *	spawned or destroyed during play, and over streamed levels when they are added or removed.
+ */
+UCLASS()
+class DSTERRAINSCAN_API UTerrainScanTileCacheSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Returns the cache for the given cell size, creating it on first request.
+	 * @param CellSize world size of a cell, usually the icons grid padding.
+	 */
+	TSharedRef<FTerrainScanTileCache> GetCache(float CellSize);
+
+	/** Drops the cached terrain inside the given box, in every cache. Call when dynamic geometry changes. */
+	UFUNCTION(BlueprintCallable, Category = "Terrain Scan")
+	void InvalidateRegion(const FBox& Region);
+
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	virtual void Deinitialize() override;
+
+private:
+
+	/** Invalidates the area of an actor spawned or destroyed during play, if it can be terrain. */
+	void HandleActorChanged(AActor* Actor);
+
+	/** Invalidates the area of a level streamed in or out. Baked tiles stay valid. */
+	void HandleLevelChanged(ULevel* Level, UWorld* World);
+
+	/** Drops the cached terrain inside the given box, in every cache. */
+	void InvalidateArea(const FBox& Region, bool bKeepAtlas);
+
+	FDelegateHandle ActorSpawnedHandle;
+
+	FDelegateHandle ActorDestroyedHandle;
+
+	FDelegateHandle LevelAddedHandle;
+
+	FDelegateHandle LevelRemovedHandle;
+
+	TMap<float, TSharedRef<FTerrainScanTileCache>> Caches;
+
+	/** Atlas baked for the current map, if any. */
+	TSharedPtr<const FTerrainScanAtlas> Atlas;
+};
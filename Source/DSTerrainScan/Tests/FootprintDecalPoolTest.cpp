@@ -0,0 +1,100 @@
+﻿#include "Misc/AutomationTest.h"
+#include "Components/DecalComponent.h"
+#include "FootprintDecalPool.h"
+#include "TerrainScanTestWorld.h"
+#include "UObject/UObjectArray.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFootprintDecalPoolTest, "TerrainScan.DecalPool.NoAllocations",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFootprintDecalPoolTest::RunTest(const FString& Parameters)
+{
+	const FTerrainScanTestWorld World;
+
+	constexpr int32 NumDecals = 99;
+	constexpr int32 NumSteps = 10000;
+
+	// Short enough for the fade, and any lifespan timer, to end many times over the run.
+	constexpr float Lifetime = 0.5f;
+	constexpr float FadeTime = 0.25f;
+
+	FFootprintDecalPool Pool;
+	Pool.Initialize(World.Get(), NumDecals, FVector::OneVector);
+	if (!TestEqual(TEXT("Preallocated decals"), Pool.GetNumAllocated(), NumDecals)) return false;
+
+	TArray<UDecalComponent*> InFlight;
+	InFlight.Reserve(NumDecals);
+	int32 NextRelease = 0;
+
+	// Steady state: as many decals in flight as footprints, the oldest one released at every step.
+	while (InFlight.Num() < NumDecals)
+	{
+		InFlight.Add(Pool.Acquire(nullptr, FVector::ZeroVector, FRotator::ZeroRotator, Lifetime, FadeTime));
+		World.Tick();
+	}
+
+	const int32 NumAllocated = Pool.GetNumAllocated();
+	const int32 NumMisses = Pool.GetNumMisses();
+	const int32 NumObjects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		Pool.Release(InFlight[NextRelease]);
+		InFlight[NextRelease] = Pool.Acquire(nullptr, FVector(static_cast<double>(Step), 0.0, 0.0),
+			FRotator::ZeroRotator, Lifetime, FadeTime);
+		NextRelease = (NextRelease + 1) % NumDecals;
+
+		// Advances world time, so expired fades and timers run as in game.
+		World.Tick();
+	}
+
+	TestEqual(TEXT("Decals created after warm-up"), Pool.GetNumAllocated(), NumAllocated);
+	TestEqual(TEXT("Pool misses after warm-up"), Pool.GetNumMisses(), NumMisses);
+	TestEqual(TEXT("UObjects created after warm-up"), GUObjectArray.GetObjectArrayNumMinusAvailable(), NumObjects);
+
+	int32 NumDestroyed = 0;
+	for (const UDecalComponent* Decal : InFlight)
+	{
+		NumDestroyed += !IsValid(Decal) || !Decal->IsRegistered();
+	}
+	TestEqual(TEXT("Pooled decals destroyed by their fade"), NumDestroyed, 0);
+
+	Pool.Shutdown(0.0f);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFootprintDecalPoolShutdownTest, "TerrainScan.DecalPool.Shutdown",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFootprintDecalPoolShutdownTest::RunTest(const FString& Parameters)
+{
+	const FTerrainScanTestWorld World;
+
+	constexpr float Lifetime = 1.0f;
+	constexpr float FadeTime = 0.5f;
+
+	FFootprintDecalPool Pool;
+	Pool.Initialize(World.Get(), 1, FVector::OneVector);
+
+	UDecalComponent* Decal = Pool.Acquire(nullptr, FVector::ZeroVector, FRotator::ZeroRotator, Lifetime, FadeTime);
+	if (!TestNotNull(TEXT("Decal"), Decal)) return false;
+
+	const AActor* PoolActor = Decal->GetOwner();
+	if (!TestNotNull(TEXT("Pool actor"), PoolActor)) return false;
+
+	// As when the character leaving the footprints is destroyed.
+	Pool.Shutdown(Lifetime);
+	TestEqual(TEXT("Decals left in the pool"), Pool.GetNumAllocated(), 0);
+
+	World.Tick(Lifetime * 0.5f);
+	TestTrue(TEXT("Decal kept until faded out"), IsValid(Decal) && Decal->IsRegistered() && Decal->IsVisible());
+
+	World.Tick(Lifetime);
+	TestFalse(TEXT("Pool actor destroyed once faded out"), IsValid(PoolActor));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+﻿#include "Misc/AutomationTest.h"
+#include "FootprintStore.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFootprintStoreRemoveDeadTest, "TerrainScan.FootprintStore.RemoveDead",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFootprintStoreRemoveDeadTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 Capacity = 8;
+	constexpr double Time = 10.0;
+
+	FFootprintStore Store(Capacity);
+
+	// Wraps around the end of the storage, so that moves cross it.
+	for (int32 Index = 0; Index < 5; ++Index)
+	{
+		Store.Add(FVector::ZeroVector, FRotator::ZeroRotator, EFootprintFlags::None, 0.0, 1.0f);
+	}
+	Store.ExpireOldest(Time, [](int32) {});
+
+	// Footprint X is at X meters, odd ones die before Time: a live oldest one keeps the dead ones stored.
+	for (int32 Index = 0; Index < Capacity; ++Index)
+	{
+		const float Lifetime = Index % 2 == 0 ? 100.0f : 1.0f;
+		Store.Add(FVector(Index * 100.0, 0.0, 0.0), FRotator::ZeroRotator, EFootprintFlags::None, 0.0, Lifetime);
+	}
+
+	TestEqual(TEXT("Nothing expires at the oldest end"), Store.ExpireOldest(Time, [](int32) {}), 0);
+	TestTrue(TEXT("Full before removal"), Store.IsFull());
+
+	TArray<FVector> Expired;
+	TMap<int32, int32> Moves;
+	const int32 NumRemoved = Store.RemoveDead(Time, [&](int32 Slot)
+	{
+		Expired.Add(Store.Locations[Slot]);
+	}, [&](int32 FromSlot, int32 ToSlot)
+	{
+		TestFalse(TEXT("Moved to a free slot"), Moves.Contains(ToSlot));
+		Moves.Add(FromSlot, ToSlot);
+	});
+
+	TestEqual(TEXT("Removed"), NumRemoved, Capacity / 2);
+	TestEqual(TEXT("Expired"), Expired.Num(), Capacity / 2);
+	TestEqual(TEXT("Remaining"), Store.Num(), Capacity / 2);
+
+	// The live footprints keep their order, from the oldest one.
+	for (int32 Index = 0; Index < Store.Num(); ++Index)
+	{
+		const int32 Slot = Store.GetSlot(Index);
+		TestEqual(TEXT("Insertion order"), Store.Locations[Slot].X, Index * 200.0);
+		TestTrue(TEXT("Alive"), Store.IsAlive(Slot, Time));
+	}
+
+	TestEqual(TEXT("Nothing left to remove"), Store.RemoveDead(Time, [](int32) {}, [](int32, int32) {}), 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,78 @@
+﻿#include "Misc/AutomationTest.h"
+#include "FootstepTraceQueue.h"
+#include "TerrainScanTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFootstepTraceQueueTest, "TerrainScan.FootstepTraces.OrderAndExpiry",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FFootstepTraceQueueTest::RunTest(const FString& Parameters)
+{
+	const FTerrainScanTestWorld World;
+
+	TFootstepTraceQueue<int32> Queue;
+
+	TArray<int32> Delivered;
+	int32 NumHits = 0;
+	const auto OnResult = [&](const FHitResult* Hit, const int32& Payload)
+	{
+		Delivered.Add(Payload);
+		NumHits += Hit != nullptr;
+	};
+
+	const auto RequestRange = [&](int32 First, int32 Last)
+	{
+		for (int32 Payload = First; Payload < Last; ++Payload)
+		{
+			const FVector Start{100.0 * Payload, 0.0, 100.0};
+			Queue.Request(World.Get(), Start, Start - FVector{0.0, 0.0, 200.0}, Payload);
+		}
+	};
+
+	// Traces of a frame run at its end: nothing is delivered before the next one.
+	RequestRange(0, 10);
+	Queue.Poll(World.Get(), OnResult);
+	TestEqual(TEXT("Delivered in the request frame"), Delivered.Num(), 0);
+
+	World.Tick();
+
+	// This frame's requests are still in flight and must wait behind the completed ones.
+	RequestRange(10, 15);
+	Queue.Poll(World.Get(), OnResult);
+	TestTrue(TEXT("Delivered after one frame, in order"), Delivered == TArray<int32>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+	TestFalse(TEXT("Later requests held back"), Queue.IsEmpty());
+
+	World.Tick();
+
+	Queue.Poll(World.Get(), OnResult);
+	TestTrue(TEXT("Delivered after two frames, in order"),
+		Delivered == TArray<int32>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14});
+	TestTrue(TEXT("Queue drained"), Queue.IsEmpty());
+
+	// The empty world has nothing to hit.
+	TestEqual(TEXT("Hits"), NumHits, 0);
+
+	// Results are only kept for a frame: unpolled traces expire, and are dropped instead of blocking the queue.
+	Delivered.Reset();
+	RequestRange(15, 20);
+
+	for (int32 Frame = 0; Frame < 4; ++Frame)
+	{
+		World.Tick();
+	}
+
+	Queue.Poll(World.Get(), OnResult);
+	TestEqual(TEXT("Expired traces delivered"), Delivered.Num(), 0);
+	TestTrue(TEXT("Expired traces dropped"), Queue.IsEmpty());
+
+	// Requests made after the expired ones are delivered normally.
+	RequestRange(20, 22);
+	World.Tick();
+	Queue.Poll(World.Get(), OnResult);
+	TestTrue(TEXT("Delivered after expiry, in order"), Delivered == TArray<int32>{20, 21});
+
+	return true;
+}
+
+#endif
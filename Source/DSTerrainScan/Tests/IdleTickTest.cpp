@@ -0,0 +1,85 @@
+﻿#include "Misc/AutomationTest.h"
+#include "FootprintControllerComponent.h"
+#include "ScannerControllerComponent.h"
+#include "ScannerIconsControllerComponent.h"
+#include "TerrainScanTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace IdleTickTest
+{
+	/** Character carrying the three scan components, with the project assets. */
+	const TCHAR* const GScannerCharacterClass = TEXT("/Game/Blueprints/BP_ScannerCharacter.BP_ScannerCharacter_C");
+
+	constexpr int32 GNumCharacters = 4;
+
+	constexpr float GDeltaTime = 0.1f;
+
+	/** Scan components of the characters with their tick enabled. */
+	int32 CountTicking(const TArray<AActor*>& Characters)
+	{
+		int32 NumTicking = 0;
+		for (const AActor* Character : Characters)
+		{
+			for (const UActorComponent* Component : Character->GetComponents())
+			{
+				const bool bScanComponent = Component->IsA<UScannerControllerComponent>()
+					|| Component->IsA<UScannerIconsControllerComponent>() || Component->IsA<UFootprintControllerComponent>();
+				NumTicking += bScanComponent && Component->IsComponentTickEnabled() ? 1 : 0;
+			}
+		}
+		return NumTicking;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FIdleTickTest, "TerrainScan.Crowd.IdleTick",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FIdleTickTest::RunTest(const FString& Parameters)
+{
+	using namespace IdleTickTest;
+
+	const FTerrainScanTestWorld World;
+
+	UClass* CharacterClass = LoadClass<AActor>(nullptr, GScannerCharacterClass);
+	if (!TestNotNull(TEXT("Scanner character class"), CharacterClass)) return false;
+
+	TArray<AActor*> Characters;
+	for (int32 Index = 0; Index < GNumCharacters; ++Index)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		AActor* Character = World.Get()->SpawnActor<AActor>(CharacterClass, FVector{Index * 1000.0, 0.0, 0.0},
+			FRotator::ZeroRotator, SpawnParameters);
+		if (!TestNotNull(TEXT("Scanner character"), Character)) return false;
+
+		Characters.Add(Character);
+	}
+
+	// Characters that neither scan nor walk leave nothing to the tick manager.
+	for (int32 Frame = 0; Frame < 10; ++Frame) World.Tick(GDeltaTime);
+	TestEqual(TEXT("Ticking components while idle"), CountTicking(Characters), 0);
+
+	UScannerControllerComponent* Scanner = Characters[0]->GetComponentByClass<UScannerControllerComponent>();
+	if (!TestNotNull(TEXT("Scanner"), Scanner)) return false;
+
+	// A scan wakes the components of its character up, then they go back to idle once the effect is over.
+	Scanner->StartScannerLifecycleAt(Characters[0]->GetActorLocation(), Characters[0]->GetActorRotation());
+	TestTrue(TEXT("Components ticking during the scan"), CountTicking(Characters) > 0);
+
+	int32 NumFrames = 0;
+	constexpr int32 MaxFrames = 600;
+	while (CountTicking(Characters) > 0 && NumFrames < MaxFrames)
+	{
+		World.Tick(GDeltaTime);
+		++NumFrames;
+	}
+
+	TestTrue(TEXT("Scan ran for several frames"), NumFrames > 1);
+	TestEqual(TEXT("Ticking components after the scan"), CountTicking(Characters), 0);
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,57 @@
+﻿#include "Misc/AutomationTest.h"
+#include "ScannerControllerComponent.h"
+#include "TerrainScanTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanAreaBatchTest, "TerrainScan.ScanArea.BatchMatchesScalar",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanAreaBatchTest::RunTest(const FString& Parameters)
+{
+	const FTerrainScanTestWorld World;
+	UScannerControllerComponent* Scanner = World.SpawnWithComponent<UScannerControllerComponent>();
+
+	// Far from the world origin, where a float position would lose the centimeters.
+	const FVector Origin{1.0e7, -2.5e6, 300.0};
+	Scanner->StartScannerLifecycleAt(Origin, FRotator{-10.0f, 35.0f, 0.0f});
+
+	const float Range = Scanner->GetScannerFinalRange();
+	const float CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(Scanner->GetCurrentFrameScannerState().Angle * 0.5f));
+	const FVector2D Direction = FVector2D{Scanner->GetCurrentFrameScannerState().Rotation.Vector()}.GetSafeNormal();
+
+	FRandomStream Random(0x5CA7);
+
+	// Sizes around the 4-wide SIMD step, so that the scalar tail is covered too.
+	for (int32 NumPoints : {1, 3, 4, 7, 64, 1001})
+	{
+		TArray<FVector> Points;
+		for (int32 Index = 0; Index < NumPoints; ++Index)
+		{
+			Points.Add(Origin + FVector{Random.FRandRange(-2.0f * Range, 2.0f * Range),
+				Random.FRandRange(-2.0f * Range, 2.0f * Range), Random.FRandRange(-500.0f, 500.0f)});
+		}
+
+		TBitArray<> Results;
+		Scanner->IsPointsInsideScanArea(Points, Results);
+
+		TestEqual(FString::Printf(TEXT("%d points: result count"), NumPoints), Results.Num(), NumPoints);
+
+		for (int32 Index = 0; Index < NumPoints; ++Index)
+		{
+			const FVector2D Offset{Points[Index] - Origin};
+			const double Distance = Offset.Size();
+
+			// Points within rounding of the cone edge or of the range may go either way.
+			const double Cosine = Direction.Dot(Offset.GetSafeNormal());
+			if (FMath::Abs(Cosine - CosHalfAngle) < 1e-4 || FMath::Abs(Distance - Range) < 1.0) continue;
+
+			const bool bExpected = Scanner->IsPointInsideScanArea(Points[Index]) && Distance <= Range;
+			TestEqual(FString::Printf(TEXT("%d points: point %d"), NumPoints, Index), Results[Index], bExpected);
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,113 @@
+﻿#include "Misc/AutomationTest.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "ScanEventRecorderComponent.h"
+#include "ScannerControllerComponent.h"
+#include "TerrainScanTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ScanEventLogTest
+{
+	/** Character carrying the scan components and the recorder, with the project assets. */
+	const TCHAR* const GScannerCharacterClass = TEXT("/Game/Blueprints/BP_ScannerCharacter.BP_ScannerCharacter_C");
+
+	constexpr float GDeltaTime = 1.0f / 60.0f;
+
+	constexpr int32 GNumFrames = 90;
+
+	/** Frame the recorded scan starts on. */
+	constexpr int32 GScanFrame = 10;
+
+	AActor* SpawnCharacter(FAutomationTestBase& Test, const FTerrainScanTestWorld& World, UClass* CharacterClass)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		AActor* Character = World.Get()->SpawnActor<AActor>(CharacterClass, FVector::ZeroVector, FRotator::ZeroRotator,
+			SpawnParameters);
+		if (!Test.TestNotNull(TEXT("Scanner character"), Character)) return nullptr;
+
+		const bool bHasRecorder = Test.TestNotNull(TEXT("Recorder"),
+			Character->GetComponentByClass<UScanEventRecorderComponent>());
+		const bool bHasScanner = Test.TestNotNull(TEXT("Scanner"),
+			Character->GetComponentByClass<UScannerControllerComponent>());
+		return bHasRecorder && bHasScanner ? Character : nullptr;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanEventLogReplayTest, "TerrainScan.Recording.ReplayScan",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanEventLogReplayTest::RunTest(const FString& Parameters)
+{
+	using namespace ScanEventLogTest;
+
+	UClass* CharacterClass = LoadClass<AActor>(nullptr, GScannerCharacterClass);
+	if (!TestNotNull(TEXT("Scanner character class"), CharacterClass)) return false;
+
+	const FString Filename = FPaths::CreateTempFilename(*FPaths::AutomationTransientDir(), TEXT("ScanEventLog"),
+		TEXT(".tsrec"));
+	ON_SCOPE_EXIT { IFileManager::Get().Delete(*Filename); };
+
+	// Record a session with one scan, started the way player input starts it: during the frame, before the
+	// recorder ticks.
+	{
+		const FTerrainScanTestWorld World;
+
+		AActor* Character = SpawnCharacter(*this, World, CharacterClass);
+		if (!Character) return false;
+
+		UScannerControllerComponent* Scanner = Character->GetComponentByClass<UScannerControllerComponent>();
+		UScanEventRecorderComponent* Recorder = Character->GetComponentByClass<UScanEventRecorderComponent>();
+		if (!TestTrue(TEXT("Recording starts"), Recorder->Start(EScanEventRecorderMode::Record, Filename))) return false;
+
+		int32 Frame = 0;
+		const FDelegateHandle InputHandle = FWorldDelegates::OnWorldPreActorTick.AddLambda(
+			[&](UWorld* TickedWorld, ELevelTick, float)
+			{
+				if (TickedWorld == World.Get() && Frame == GScanFrame)
+				{
+					Scanner->StartScannerLifecycleAt(Character->GetActorLocation(), Character->GetActorRotation());
+				}
+			});
+
+		for (; Frame < GNumFrames; ++Frame) World.Tick(GDeltaTime);
+
+		FWorldDelegates::OnWorldPreActorTick.Remove(InputHandle);
+
+		// Ending play closes the log.
+		Character->Destroy();
+	}
+
+	// Replay it on a fresh character: the scan starts again, and every frame ends in the recorded state.
+	{
+		const FTerrainScanTestWorld World;
+
+		AActor* Character = SpawnCharacter(*this, World, CharacterClass);
+		if (!Character) return false;
+
+		UScannerControllerComponent* Scanner = Character->GetComponentByClass<UScannerControllerComponent>();
+		UScanEventRecorderComponent* Recorder = Character->GetComponentByClass<UScanEventRecorderComponent>();
+
+		int32 NumScans = 0;
+		Scanner->OnScanStarted.AddLambda([&NumScans](const FScannerState&) { ++NumScans; });
+
+		if (!TestTrue(TEXT("Replay starts"), Recorder->Start(EScanEventRecorderMode::Replay, Filename))) return false;
+
+		// One more frame reaches the end of the log.
+		for (int32 Frame = 0; Frame <= GNumFrames && Recorder->IsReplaying(); ++Frame) World.Tick(GDeltaTime);
+
+		TestFalse(TEXT("Replay finished"), Recorder->IsReplaying());
+		TestEqual(TEXT("Replayed frames"), Recorder->GetNumReplayedFrames(), GNumFrames);
+		TestEqual(TEXT("Replayed scans"), NumScans, 1);
+		TestEqual(TEXT("Frames diverged from the log"), Recorder->GetNumMismatchedFrames(), 0);
+
+		Character->Destroy();
+	}
+
+	return true;
+}
+
+#endif
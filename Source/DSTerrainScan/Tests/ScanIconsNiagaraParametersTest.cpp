@@ -0,0 +1,76 @@
+﻿#include "Misc/AutomationTest.h"
+#include "NiagaraComponent.h"
+#include "NiagaraSystem.h"
+#include "NiagaraTypes.h"
+#include "ScanIconsNiagaraParameters.h"
+#include "TerrainScanTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ScanIconsNiagaraParametersTest
+{
+	/** Icons system of the project, declaring every EScanIconsParameter. */
+	const TCHAR* const GIconsSystem = TEXT("/Game/Particles/FXS_TerrainScanIcons.FXS_TerrainScanIcons");
+
+	/** Value of a float user parameter, looked up by name. */
+	TOptional<float> ReadFloat(UNiagaraComponent* Component, const TCHAR* Name)
+	{
+		const FNiagaraUserRedirectionParameterStore& Store = Component->GetOverrideParameters();
+		const int32* Offset = Store.FindParameterOffset(FNiagaraVariable{FNiagaraTypeDefinition::GetFloatDef(), Name});
+		if (!Offset) return {};
+
+		float Value;
+		FMemory::Memcpy(&Value, Store.GetParameterData(*Offset), sizeof(float));
+		return Value;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanIconsNiagaraParametersTest, "TerrainScan.Icons.ParameterBindings",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanIconsNiagaraParametersTest::RunTest(const FString& Parameters)
+{
+	using namespace ScanIconsNiagaraParametersTest;
+
+	UNiagaraSystem* System = LoadObject<UNiagaraSystem>(nullptr, GIconsSystem);
+	if (!TestNotNull(TEXT("Icons system"), System)) return false;
+
+	const FTerrainScanTestWorld World;
+	UNiagaraComponent* Component = World.SpawnWithComponent<UNiagaraComponent>();
+	Component->SetAutoActivate(false);
+
+	// Bound before the asset is set: nothing to write to, and nothing is added.
+	FScanIconsNiagaraParameters Bound;
+	Bound.Bind(Component);
+	Bound.SetFloat(EScanIconsParameter::CurrentRange, 1.0f);
+	TestEqual(TEXT("Empty store untouched"), Component->GetOverrideParameters().Num(), 0);
+
+	// The new asset rebuilds the store: the offsets are resolved again on the next write.
+	Component->SetAsset(System);
+	const int32 NumParameters = Component->GetOverrideParameters().Num();
+
+	Bound.SetFloat(EScanIconsParameter::CurrentRange, 1234.5f);
+	Bound.SetFloat(EScanIconsParameter::CameraZ, 678.0f);
+	TestEqual(TEXT("CurrentRange after the asset change"), ReadFloat(Component, TEXT("CurrentRange")).Get(0.0f), 1234.5f);
+	TestEqual(TEXT("CameraZ after the asset change"), ReadFloat(Component, TEXT("CameraZ")).Get(0.0f), 678.0f);
+
+	// Parameters added by name are appended and leave the bound offsets valid.
+	Component->SetVariableFloat(TEXT("TerrainScanTestParameter"), 1.0f);
+	Bound.SetFloat(EScanIconsParameter::CurrentRange, 2000.0f);
+	TestEqual(TEXT("CurrentRange after an added parameter"), ReadFloat(Component, TEXT("CurrentRange")).Get(0.0f), 2000.0f);
+	TestEqual(TEXT("Added parameter untouched"), ReadFloat(Component, TEXT("TerrainScanTestParameter")).Get(0.0f), 1.0f);
+
+	// Reinitializing keeps the values written through the bindings, and Bind picks up the store again.
+	Component->ReinitializeSystem();
+	Bound.Bind(Component);
+	Bound.SetFloat(EScanIconsParameter::CurrentRange, 3000.0f);
+	TestEqual(TEXT("CurrentRange after a reinit"), ReadFloat(Component, TEXT("CurrentRange")).Get(0.0f), 3000.0f);
+	TestEqual(TEXT("CameraZ kept by the reinit"), ReadFloat(Component, TEXT("CameraZ")).Get(0.0f), 678.0f);
+
+	// Writes never add parameters.
+	TestEqual(TEXT("Parameter count"), Component->GetOverrideParameters().Num(), NumParameters + 1);
+
+	return true;
+}
+
+#endif
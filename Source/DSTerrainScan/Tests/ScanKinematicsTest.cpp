@@ -0,0 +1,125 @@
+﻿#include "Misc/AutomationTest.h"
+#include "ScanKinematics.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ScanKinematicsTest
+{
+	/** Speed profile written directly from the parameters, independently of FScanKinematics. */
+	float ReferenceSpeed(const FScanKinematicsParams& Params, float T)
+	{
+		if (T < Params.SpawnAnimationDuration)
+		{
+			return FMath::Lerp(Params.SpawnInitialSpeed, Params.PrewarmSpeed, T / Params.SpawnAnimationDuration);
+		}
+
+		T -= Params.SpawnAnimationDuration;
+		if (T < Params.PrewarmAnimationDuration) return Params.PrewarmSpeed;
+
+		T -= Params.PrewarmAnimationDuration;
+		if (T <= Params.ExpansionMaxSpeedDuration)
+		{
+			return FMath::Lerp(Params.PrewarmSpeed, Params.ExpansionMaxSpeed, T / Params.ExpansionMaxSpeedDuration);
+		}
+
+		const float DecelerationDuration = Params.ExpansionAnimationDuration - Params.ExpansionMaxSpeedDuration;
+		T -= Params.ExpansionMaxSpeedDuration;
+		if (T < DecelerationDuration)
+		{
+			return FMath::Lerp(Params.ExpansionMaxSpeed, Params.ExpansionFinalSpeed, T / DecelerationDuration);
+		}
+
+		return 0.0f;
+	}
+
+	constexpr float Rates[] = {30.0f, 60.0f, 144.0f, 240.0f};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanKinematicsIntegratorTest, "TerrainScan.Kinematics.MatchesIntegrator",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanKinematicsIntegratorTest::RunTest(const FString& Parameters)
+{
+	const FScanKinematicsParams Params;
+	const FScanKinematics Kinematics{Params};
+
+	// Same closed form as the former GetScannerFinalRange.
+	const float ExpectedFinalRange = Params.SpawnInitialRange
+		+ Params.SpawnAnimationDuration * (Params.SpawnInitialSpeed + Params.PrewarmSpeed) / 2
+		+ Params.PrewarmAnimationDuration * Params.PrewarmSpeed
+		+ Params.ExpansionMaxSpeedDuration * (Params.PrewarmSpeed + Params.ExpansionMaxSpeed) / 2
+		+ (Params.ExpansionAnimationDuration - Params.ExpansionMaxSpeedDuration)
+			* (Params.ExpansionMaxSpeed + Params.ExpansionFinalSpeed) / 2;
+
+	TestNearlyEqual(TEXT("Final range"), Kinematics.GetFinalRange(), ExpectedFinalRange, 0.5f);
+
+	// The speed is continuous, so the trapezoidal rule only errs on the steps straddling a kink.
+	const float Tolerance = ExpectedFinalRange * 1e-3f;
+
+	for (float Rate : ScanKinematicsTest::Rates)
+	{
+		const float DeltaTime = 1.0f / Rate;
+		const int32 NumSteps = FMath::CeilToInt32((Kinematics.GetTotalDuration() + 0.5f) * Rate);
+
+		double Range = Params.SpawnInitialRange;
+		float MaxError = 0.0f;
+
+		for (int32 Step = 1; Step <= NumSteps; ++Step)
+		{
+			const float T0 = (Step - 1) * DeltaTime;
+			const float T1 = Step * DeltaTime;
+			Range += 0.5 * (ScanKinematicsTest::ReferenceSpeed(Params, T0) + ScanKinematicsTest::ReferenceSpeed(Params, T1))
+				* DeltaTime;
+
+			MaxError = FMath::Max(MaxError, FMath::Abs(Kinematics.Evaluate(T1).Range - static_cast<float>(Range)));
+		}
+
+		TestTrue(FString::Printf(TEXT("%.0f Hz: max range error %f within %f"), Rate, MaxError, Tolerance),
+			MaxError <= Tolerance);
+
+		const FScanKinematicsSample Last = Kinematics.Evaluate(NumSteps * DeltaTime);
+		TestTrue(FString::Printf(TEXT("%.0f Hz: inactive at the end"), Rate),
+			Last.AnimationState == EScannerAnimationState::Inactive);
+		TestNearlyEqual(FString::Printf(TEXT("%.0f Hz: final range"), Rate), Last.Range, Kinematics.GetFinalRange());
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanKinematicsFrameRateTest, "TerrainScan.Kinematics.FrameRateIndependent",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanKinematicsFrameRateTest::RunTest(const FString& Parameters)
+{
+	const FScanKinematics Kinematics{FScanKinematicsParams{}};
+
+	// Every rate reaches the same instants through its own accumulated clock, as the tick does. The instants
+	// are whole frames at every rate (multiples of 1/6 s), one per phase plus one after the end.
+	constexpr float CheckTimes[] = {1.0f / 6.0f, 2.0f / 6.0f, 4.0f / 6.0f, 1.0f, 2.0f, 3.5f};
+
+	for (float CheckTime : CheckTimes)
+	{
+		const FScanKinematicsSample Reference = Kinematics.Evaluate(CheckTime);
+
+		for (float Rate : ScanKinematicsTest::Rates)
+		{
+			double Clock = 0.0;
+			const int32 NumSteps = FMath::RoundToInt32(CheckTime * Rate);
+			for (int32 Step = 0; Step < NumSteps; ++Step)
+			{
+				Clock += 1.0 / Rate;
+			}
+
+			const FScanKinematicsSample Sample = Kinematics.Evaluate(static_cast<float>(Clock));
+			const FString What = FString::Printf(TEXT("%.0f Hz at %.2f s"), Rate, CheckTime);
+
+			TestTrue(What + TEXT(": state"), Sample.AnimationState == Reference.AnimationState);
+			TestNearlyEqual(What + TEXT(": range"), Sample.Range, Reference.Range, 1.0f);
+			TestNearlyEqual(What + TEXT(": opacity"), Sample.Opacity, Reference.Opacity, 1e-3f);
+		}
+	}
+
+	return true;
+}
+
+#endif
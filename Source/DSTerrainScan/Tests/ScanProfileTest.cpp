@@ -0,0 +1,105 @@
+﻿#include "Misc/AutomationTest.h"
+#include "ScannerControllerComponent.h"
+#include "ScannerIconsControllerComponent.h"
+#include "ScanProfileDataAsset.h"
+#include "TerrainScanCustomVersion.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanProfileDerivedValuesTest, "TerrainScan.Profile.DerivedValues",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanProfileDerivedValuesTest::RunTest(const FString& Parameters)
+{
+	UScanProfileDataAsset* Template = NewObject<UScanProfileDataAsset>();
+	Template->Scan.ArcAngle = 90.0f;
+	Template->Scan.Kinematics.ExpansionAnimationDuration = 6.0f;
+	Template->Scan.Kinematics.ExpansionMaxSpeed = 9000.0f;
+	Template->Appearance.DarkCircleSize = 1234.0f;
+	Template->Icons.GridX = 64;
+	Template->Icons.TotalAnimationCycles = 3;
+	Template->Icons.DangerIconFadeoutTime = 2.5f;
+
+	// Derived values are computed in PostInitProperties, from the values copied off the template.
+	UScanProfileDataAsset* Profile = NewObject<UScanProfileDataAsset>(GetTransientPackage(), NAME_None, RF_NoFlags,
+		Template);
+
+	const FScanKinematics Kinematics{Profile->Scan.Kinematics};
+	TestEqual(TEXT("Final range"), Profile->GetScannerFinalRange(), Kinematics.GetFinalRange());
+	TestEqual(TEXT("Total scan duration"), Profile->GetTotalScanDuration(), Kinematics.GetTotalDuration());
+	TestEqual(TEXT("Cosine of the half angle"), Profile->GetCosHalfAngle(), FMath::Cos(FMath::DegreesToRadians(45.0f)));
+	TestEqual(TEXT("Total effect duration"), Profile->GetTotalEffectDuration(),
+		Profile->Icons.ComputeTotalEffectDuration());
+	TestNotEqual(TEXT("Derived from the edited values"), Profile->GetTotalEffectDuration(),
+		FScanIconsSettings{}.ComputeTotalEffectDuration());
+
+	// The embedded settings start from the struct defaults, as the former inline values did.
+	UScannerControllerComponent* Scanner = NewObject<UScannerControllerComponent>();
+	const FScanProfile DefaultScan;
+	const FScanProfile InlineScan = Scanner->MakeScanProfile();
+	TestTrue(TEXT("Default scanner settings"),
+		FScanProfile::StaticStruct()->CompareScriptStruct(&InlineScan, &DefaultScan, PPF_None));
+
+	const FScanAppearance DefaultAppearance;
+	TestTrue(TEXT("Default scanner appearance"), FScanAppearance::StaticStruct()->CompareScriptStruct(
+		&Scanner->GetScanAppearance(), &DefaultAppearance, PPF_None));
+	TestEqual(TEXT("Default scanner final range"), Scanner->GetScannerFinalRange(),
+		FScanKinematics{DefaultScan.Kinematics}.GetFinalRange());
+
+	UScannerIconsControllerComponent* Icons = NewObject<UScannerIconsControllerComponent>();
+	const FScanIconsSettings DefaultIcons;
+	TestTrue(TEXT("Default icons settings"), FScanIconsSettings::StaticStruct()->CompareScriptStruct(
+		&Icons->GetIconsSettings(), &DefaultIcons, PPF_None));
+
+	Scanner->SetScanProfile(Profile);
+	TestEqual(TEXT("Scanner final range"), Scanner->GetScannerFinalRange(), Profile->GetScannerFinalRange());
+	TestEqual(TEXT("Scanner total duration"), Scanner->GetTotalScanDuration(), Profile->GetTotalScanDuration());
+	const FScanProfile ProfileScan = Scanner->MakeScanProfile();
+	TestTrue(TEXT("Scanner settings"),
+		FScanProfile::StaticStruct()->CompareScriptStruct(&ProfileScan, &Profile->Scan, PPF_None));
+	TestEqual(TEXT("Scanner appearance"), Scanner->GetScanAppearance().DarkCircleSize, 1234.0f);
+
+	Icons->SetScanProfile(Profile);
+	TestEqual(TEXT("Icons grid"), Icons->GetIconsSettings().GridX, 64);
+	TestEqual(TEXT("Icons total effect duration"), Icons->TotalEffectDuration(), Profile->GetTotalEffectDuration());
+
+	return true;
+}
+
+
+#if WITH_EDITORONLY_DATA
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanProfileDeprecatedSettingsTest, "TerrainScan.Profile.DeprecatedSettings",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanProfileDeprecatedSettingsTest::RunTest(const FString& Parameters)
+{
+	UScannerControllerComponent* Scanner = NewObject<UScannerControllerComponent>();
+	const UClass* Class = UScannerControllerComponent::StaticClass();
+
+	const FFloatProperty* ArcAngle = CastField<FFloatProperty>(Class->FindPropertyByName(TEXT("ArcAngle_DEPRECATED")));
+	const FFloatProperty* PrewarmSpeed = CastField<FFloatProperty>(
+		Class->FindPropertyByName(TEXT("PrewarmSpeed_DEPRECATED")));
+	if (!TestNotNull(TEXT("ArcAngle_DEPRECATED"), ArcAngle) || !TestNotNull(TEXT("PrewarmSpeed_DEPRECATED"), PrewarmSpeed))
+	{
+		return false;
+	}
+
+	// Values saved before the settings were embedded, as loaded through the property redirects.
+	ArcAngle->SetPropertyValue_InContainer(Scanner, 75.0f);
+	PrewarmSpeed->SetPropertyValue_InContainer(Scanner, 4321.0f);
+
+	FScanProfile Upgraded;
+	FTerrainScanCustomVersion::SyncDeprecatedSettings(Scanner, FScanProfile::StaticStruct(), &Upgraded, true);
+	FTerrainScanCustomVersion::SyncDeprecatedSettings(Scanner, FScanKinematicsParams::StaticStruct(),
+		&Upgraded.Kinematics, true);
+
+	TestEqual(TEXT("Arc angle upgraded"), Upgraded.ArcAngle, 75.0f);
+	TestEqual(TEXT("Prewarm speed upgraded"), Upgraded.Kinematics.PrewarmSpeed, 4321.0f);
+	TestEqual(TEXT("Other values keep their defaults"), Upgraded.Kinematics.ExpansionMaxSpeed,
+		FScanKinematicsParams{}.ExpansionMaxSpeed);
+
+	return true;
+}
+#endif
+
+#endif
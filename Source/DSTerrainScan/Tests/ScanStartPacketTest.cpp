@@ -0,0 +1,95 @@
+﻿#include "Misc/AutomationTest.h"
+#include "ScannerControllerComponent.h"
+#include "UObject/CoreNet.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ScanStartPacketTest
+{
+	/** Writes the packet as the RPC would, and reads it back. */
+	FScanStartPacket RoundTrip(FAutomationTestBase& Test, const FScanStartPacket& Packet)
+	{
+		FScanStartPacket Written = Packet;
+		FNetBitWriter Writer{128};
+		bool bSuccess = true;
+		Test.TestTrue(TEXT("Packet written"), Written.NetSerialize(Writer, nullptr, bSuccess) && bSuccess);
+
+		Test.TestEqual(TEXT("GetNumBits matches the written bits"), static_cast<int64>(Packet.GetNumBits()),
+			Writer.GetNumBits());
+
+		FNetBitReader Reader{nullptr, Writer.GetData(), Writer.GetNumBits()};
+		FScanStartPacket Read;
+		bSuccess = true;
+		Test.TestTrue(TEXT("Packet read"), Read.NetSerialize(Reader, nullptr, bSuccess) && bSuccess);
+		Test.TestFalse(TEXT("Reader overflow"), Reader.IsError());
+		Test.TestEqual(TEXT("Bits read"), Reader.GetPosBits(), Writer.GetNumBits());
+
+		return Read;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanStartPacketTest, "TerrainScan.Net.StartPacketRoundTrip",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanStartPacketTest::RunTest(const FString& Parameters)
+{
+	using namespace ScanStartPacketTest;
+
+	FScanStartPacket Packet;
+	Packet.Origin = FVector{123456.78, -98765.43, 321.25};
+	Packet.SetRotation(FRotator{-12.5f, 271.25f, 0.0f});
+	Packet.ServerStartTime = 4321.125f;
+
+	const FScanStartPacket Read = RoundTrip(*this, Packet);
+
+	// Rounded to the centimeter.
+	TestTrue(TEXT("Origin"), FVector{Read.Origin}.Equals(FVector{123457.0, -98765.0, 321.0}, 0.5));
+	TestEqual(TEXT("Yaw"), Read.Yaw, Packet.Yaw);
+	TestEqual(TEXT("Pitch"), Read.Pitch, Packet.Pitch);
+	TestTrue(TEXT("Rotation within the 16-bit step"), Read.GetRotation().Equals(FRotator{-12.5f, 271.25f, 0.0f}, 0.01f));
+	TestEqual(TEXT("Server start time"), Read.ServerStartTime, Packet.ServerStartTime);
+	TestFalse(TEXT("No profile"), Read.bHasProfile);
+
+	// Quantized origin (a small header plus up to 3 x 24 bits in a level of this size), 2 x 16 bits of
+	// rotation, 32 bits of time and a single bit for the missing profile: 20 bytes at most.
+	const int32 NumBits = Packet.GetNumBits();
+	TestTrue(FString::Printf(TEXT("Packet without profile is %d bits, at most 160"), NumBits), NumBits <= 160);
+
+	// Near the world origin the quantized vector shrinks, the rest of the packet does not.
+	FScanStartPacket NearOrigin = Packet;
+	NearOrigin.Origin = FVector{10.0, -20.0, 30.0};
+	TestTrue(TEXT("Smaller origin, fewer bits"), NearOrigin.GetNumBits() < NumBits);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FScanStartPacketProfileTest, "TerrainScan.Net.StartPacketProfileRoundTrip",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FScanStartPacketProfileTest::RunTest(const FString& Parameters)
+{
+	using namespace ScanStartPacketTest;
+
+	FScanStartPacket Packet;
+	Packet.Origin = FVector{100.0, 200.0, 300.0};
+	Packet.bHasProfile = true;
+	Packet.Profile.ArcAngle = 75.0f;
+	Packet.Profile.Kinematics.ExpansionAnimationDuration = 4.0f;
+	Packet.Profile.Kinematics.ExpansionMaxSpeed = 12345.0f;
+	Packet.Profile.Kinematics.SpawnFinalOpacity = 0.25f;
+
+	const FScanStartPacket Read = RoundTrip(*this, Packet);
+
+	TestTrue(TEXT("Has profile"), Read.bHasProfile);
+	TestTrue(TEXT("Profile unchanged"),
+		FScanProfile::StaticStruct()->CompareScriptStruct(&Read.Profile, &Packet.Profile, PPF_None));
+
+	// The profile is only sent when set.
+	FScanStartPacket WithoutProfile = Packet;
+	WithoutProfile.bHasProfile = false;
+	TestTrue(TEXT("Profile bits only when set"), WithoutProfile.GetNumBits() < Packet.GetNumBits());
+
+	return true;
+}
+
+#endif
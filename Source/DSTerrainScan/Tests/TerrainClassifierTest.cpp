@@ -0,0 +1,154 @@
+﻿#include "Misc/AutomationTest.h"
+#include "ScannerIconsControllerComponent.h"
+#include "TerrainClassifier.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TerrainClassifierTest
+{
+	struct FCase
+	{
+		const TCHAR* Name;
+
+		float NormalZ;
+
+		float WaterDepth;
+
+		ETerrainType ID;
+
+		ETerrainType Expected;
+	};
+
+	const FTerrainClassificationThresholds Thresholds;
+
+	/** Every class, the threshold edges, and the priority between water, IDs and slope. */
+	const FCase Cases[] =
+	{
+		{TEXT("Flat"), 1.0f, 0.0f, ETerrainType::Regular, ETerrainType::Regular},
+		{TEXT("Regular edge"), Thresholds.RegularTerrainThreshold, 0.0f, ETerrainType::Regular, ETerrainType::Regular},
+		{TEXT("Below regular"), Thresholds.RegularTerrainThreshold - 0.01f, 0.0f, ETerrainType::Regular, ETerrainType::Steep},
+		{TEXT("Steep edge"), Thresholds.SteepTerrainThreshold, 0.0f, ETerrainType::Regular, ETerrainType::Steep},
+		{TEXT("Below steep"), Thresholds.SteepTerrainThreshold - 0.01f, 0.0f, ETerrainType::Regular, ETerrainType::Dangerous},
+		{TEXT("Rocky"), 1.0f, 0.0f, ETerrainType::Rocky, ETerrainType::Rocky},
+		{TEXT("Vegetation on a cliff"), 0.1f, 0.0f, ETerrainType::Vegetation, ETerrainType::Vegetation},
+		{TEXT("Path"), 0.75f, 0.0f, ETerrainType::Path, ETerrainType::Path},
+		{TEXT("Shallow water"), 1.0f, 10.0f, ETerrainType::Regular, ETerrainType::ShallowWater},
+		{TEXT("Shallow edge"), 1.0f, Thresholds.ShallowWaterThreshold, ETerrainType::Regular, ETerrainType::ShallowWater},
+		{TEXT("Deep water"), 1.0f, Thresholds.ShallowWaterThreshold + 1.0f, ETerrainType::Regular, ETerrainType::DeepWater},
+		{TEXT("Deep edge"), 1.0f, Thresholds.DeepWaterThreshold, ETerrainType::Regular, ETerrainType::DeepWater},
+		{TEXT("Dangerous water"), 1.0f, Thresholds.DeepWaterThreshold + 1.0f, ETerrainType::Regular, ETerrainType::DangerousWater},
+		{TEXT("Water over rocks"), 1.0f, 10.0f, ETerrainType::Rocky, ETerrainType::ShallowWater},
+		{TEXT("Water over a cliff"), 0.1f, 600.0f, ETerrainType::Path, ETerrainType::DangerousWater}
+	};
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainClassifierTest, "TerrainScan.Classifier.OrderAndThresholds",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTerrainClassifierTest::RunTest(const FString& Parameters)
+{
+	using namespace TerrainClassifierTest;
+
+	constexpr int32 NumCases = UE_ARRAY_COUNT(Cases);
+
+	// Rows of 7 cells: four through the SIMD path, three through the scalar tail. Every case lands in both.
+	constexpr int32 GridX = NumCases * 7;
+	constexpr int32 GridY = 7;
+	constexpr int32 NumCells = GridX * GridY;
+
+	TArray<float> Depth;
+	TArray<float> WaterDepth;
+	TArray<FVector3f> Normals;
+	TArray<uint8> IDs;
+
+	for (int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		const FCase& Case = Cases[Cell % NumCases];
+		const float NormalXY = FMath::Sqrt(FMath::Max(1.0f - Case.NormalZ * Case.NormalZ, 0.0f));
+
+		Depth.Add(100.0f + Cell);
+		WaterDepth.Add(Case.WaterDepth);
+		Normals.Add(FVector3f{NormalXY, 0.0f, Case.NormalZ});
+		IDs.Add(Case.ID == ETerrainType::Regular ? 0 : static_cast<uint8>(Case.ID));
+	}
+
+	FTerrainClassificationInput Input;
+	Input.GridX = GridX;
+	Input.GridY = GridY;
+	Input.CameraZ = 5000.0f;
+	Input.Depth = Depth;
+	Input.WaterDepth = WaterDepth;
+	Input.Normals = Normals;
+	Input.IDs = IDs;
+
+	FTerrainClassificationResult Result;
+	if (!TestTrue(TEXT("Classify succeeds"), FTerrainClassifier::Classify(Input, Thresholds, Result))) return false;
+
+	for (int32 Cell = 0; Cell < NumCells; ++Cell)
+	{
+		const FCase& Case = Cases[Cell % NumCases];
+		const int32 X = Cell / GridY;
+		const int32 Y = Cell % GridY;
+
+		TestEqual(FString::Printf(TEXT("%s, cell %d"), Case.Name, Cell),
+			static_cast<int32>(Result.GetType(X, Y)), static_cast<int32>(Case.Expected));
+		TestNearlyEqual(FString::Printf(TEXT("Height of cell %d"), Cell), Result.GetHeight(X, Y),
+			Input.CameraZ - Depth[Cell]);
+	}
+
+	// One array short of a full grid.
+	Input.IDs = MakeArrayView(IDs.GetData(), NumCells - 1);
+	TestFalse(TEXT("Malformed input is rejected"), FTerrainClassifier::Classify(Input, Thresholds, Result));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainClassifierCaptureSampleTest, "TerrainScan.Classifier.CaptureSampleRoundTrip",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FTerrainClassifierCaptureSampleTest::RunTest(const FString& Parameters)
+{
+	using namespace TerrainClassifierTest;
+
+	// One cell per type: eight through the SIMD path, the last one through the scalar tail.
+	constexpr int32 NumTypes = static_cast<int32>(ETerrainType::Path) + 1;
+	constexpr float CameraZ = 5000.0f;
+
+	TArray<float> Depth;
+	TArray<float> WaterDepth;
+	TArray<FVector3f> Normals;
+	TArray<uint8> IDs;
+
+	for (int32 Type = 0; Type < NumTypes; ++Type)
+	{
+		const FTerrainCaptureSample Sample = FTerrainClassifier::MakeCaptureSample(static_cast<uint8>(Type),
+			100.0f * Type, CameraZ, Thresholds);
+
+		Depth.Add(Sample.Depth);
+		WaterDepth.Add(Sample.WaterDepth);
+		Normals.Add(Sample.Normal);
+		IDs.Add(Sample.ID);
+	}
+
+	FTerrainClassificationInput Input;
+	Input.GridX = 1;
+	Input.GridY = NumTypes;
+	Input.CameraZ = CameraZ;
+	Input.Depth = Depth;
+	Input.WaterDepth = WaterDepth;
+	Input.Normals = Normals;
+	Input.IDs = IDs;
+
+	FTerrainClassificationResult Result;
+	if (!TestTrue(TEXT("Classify succeeds"), FTerrainClassifier::Classify(Input, Thresholds, Result))) return false;
+
+	for (int32 Type = 0; Type < NumTypes; ++Type)
+	{
+		TestEqual(FString::Printf(TEXT("Type of cell %d"), Type), static_cast<int32>(Result.GetType(0, Type)), Type);
+		TestNearlyEqual(FString::Printf(TEXT("Height of cell %d"), Type), Result.GetHeight(0, Type), 100.0f * Type);
+	}
+
+	return true;
+}
+
+#endif
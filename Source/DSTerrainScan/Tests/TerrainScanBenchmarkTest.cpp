@@ -0,0 +1,114 @@
+﻿#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "TerrainScanBenchmark.h"
+#include "TerrainScanTestWorld.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace TerrainScanBenchmarkTest
+{
+	/** Character carrying the three scan components, with the project assets. */
+	const TCHAR* const GScannerCharacterClass = TEXT("/Game/Blueprints/BP_ScannerCharacter.BP_ScannerCharacter_C");
+
+	constexpr int32 GNumIterations = 50;
+
+	/**
+	 * Median cost of one work item, in milliseconds, of every case whose name starts with Prefix.
+	 * About ten times the cost measured on a development machine: over budget is a regression of
+	 * the algorithm, not noise.
+	 */
+	struct FBudget
+	{
+		const TCHAR* Prefix;
+
+		double MaxMsPerItem;
+	};
+
+	constexpr FBudget GBudgets[] = {
+		{TEXT("Scanner.SampleScanAt"), 0.001},
+		{TEXT("Scanner.Tick"), 0.25},
+		{TEXT("MPC.Flush"), 0.25},
+		{TEXT("ScanArea.Single/"), 0.0005},
+		{TEXT("ScanArea.Batch/"), 0.0002},
+		{TEXT("Icons.ScanPress/TimeSliced"), 1.0},
+		{TEXT("Icons.UploadStage"), 1.0},
+		{TEXT("Icons.CurrentRange.Bound/"), 0.001},
+		{TEXT("Footprints.SpawnEvict/"), 0.005},
+		{TEXT("Footprints.Highlight/"), 0.001},
+		{TEXT("DecalPool.Cycle"), 0.005},
+	};
+
+	/** Pairs of cases where the first one must not be slower than the second, the point of its optimization. */
+	const TPair<const TCHAR*, const TCHAR*> GFasterThan[] = {
+		{TEXT("ScanArea.Batch/100000"), TEXT("ScanArea.Single/100000")},
+		{TEXT("Icons.ScanPress/TimeSliced"), TEXT("Icons.ScanPress/Immediate")},
+		{TEXT("Icons.ScanParameters.Bound/256"), TEXT("Icons.ScanParameters.ByName/256")},
+		{TEXT("Icons.CurrentRange.Bound/256"), TEXT("Icons.CurrentRange.ByName/256")},
+	};
+
+	/** Slack of the GFasterThan comparisons, for timer noise between two close cases. */
+	constexpr double GFasterThanTolerance = 1.1;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainScanBenchmarkTest, "TerrainScan.Benchmark.Budgets",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FTerrainScanBenchmarkTest::RunTest(const FString& Parameters)
+{
+	using namespace TerrainScanBenchmarkTest;
+
+	const FTerrainScanTestWorld World;
+
+	UClass* CharacterClass = LoadClass<AActor>(nullptr, GScannerCharacterClass);
+	if (!TestNotNull(TEXT("Scanner character class"), CharacterClass)) return false;
+
+	AActor* Character = World.Get()->SpawnActor<AActor>(CharacterClass);
+	if (!TestNotNull(TEXT("Scanner character"), Character)) return false;
+
+	FTerrainScanBenchmark Benchmark(World.Get(), GNumIterations);
+	Benchmark.Run(Character);
+
+	// Same files as the console command, so that CI keeps the history.
+	Benchmark.WriteResults(FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("TerrainScan-Automation"));
+
+	TMap<FString, const FTerrainScanBenchmarkResult*> ResultsByName;
+	for (const FTerrainScanBenchmarkResult& Result : Benchmark.GetResults())
+	{
+		ResultsByName.Add(Result.Name, &Result);
+	}
+
+	for (const FBudget& Budget : GBudgets)
+	{
+		int32 NumCases = 0;
+
+		for (const FTerrainScanBenchmarkResult& Result : Benchmark.GetResults())
+		{
+			if (!Result.Name.StartsWith(Budget.Prefix)) continue;
+
+			++NumCases;
+			const double MsPerItem = Result.GetPercentile(50.0) / FMath::Max(Result.NumItems, 1);
+			TestTrue(FString::Printf(TEXT("%s: %.6f ms per item, budget %.6f ms"), *Result.Name, MsPerItem,
+				Budget.MaxMsPerItem), MsPerItem <= Budget.MaxMsPerItem);
+		}
+
+		// A missing case would silently pass: the character has every component the benchmark needs.
+		TestTrue(FString::Printf(TEXT("%s was measured"), Budget.Prefix), NumCases > 0);
+	}
+
+	for (const TPair<const TCHAR*, const TCHAR*>& Pair : GFasterThan)
+	{
+		const FTerrainScanBenchmarkResult* const* Fast = ResultsByName.Find(Pair.Key);
+		const FTerrainScanBenchmarkResult* const* Slow = ResultsByName.Find(Pair.Value);
+		if (!TestTrue(FString::Printf(TEXT("%s and %s were measured"), Pair.Key, Pair.Value), Fast && Slow)) continue;
+
+		const double FastMs = (*Fast)->GetPercentile(50.0);
+		const double SlowMs = (*Slow)->GetPercentile(50.0);
+		TestTrue(FString::Printf(TEXT("%s (%.4f ms) not slower than %s (%.4f ms)"), Pair.Key, FastMs, Pair.Value, SlowMs),
+			FastMs <= SlowMs * GFasterThanTolerance);
+	}
+
+	Character->Destroy();
+	return true;
+}
+
+#endif
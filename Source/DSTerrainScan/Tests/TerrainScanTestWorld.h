@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+/**
+ *	Empty game world with play begun, destroyed with the object. Actors spawned in it run BeginPlay,
+ *	so the components under test start as they would in a level.
+ */
+class FTerrainScanTestWorld
+{
+public:
+
+	FTerrainScanTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false);
+
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FTerrainScanTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	UWorld* Get() const { return World; }
+
+	/** Runs a full frame: tick functions, timers and world subsystems. */
+	void Tick(float DeltaTime = 1.0f / 60.0f) const { World->Tick(LEVELTICK_All, DeltaTime); }
+
+	/** Spawns a bare actor owning a registered component of the given class. */
+	template<typename ComponentType>
+	ComponentType* SpawnWithComponent() const
+	{
+		AActor* Actor = World->SpawnActor<AActor>();
+		ComponentType* Component = NewObject<ComponentType>(Actor);
+		Component->RegisterComponent();
+		return Component;
+	}
+
+private:
+
+	UWorld* World;
+};
+
+#endif
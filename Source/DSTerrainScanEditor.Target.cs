@@ -11,5 +11,6 @@ public class DSTerrainScanEditorTarget : TargetRules
 		DefaultBuildSettings = BuildSettingsVersion.V5;
 		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_5;
 		ExtraModuleNames.Add("DSTerrainScan");
+		ExtraModuleNames.Add("DSTerrainScanEditor");
 	}
 }
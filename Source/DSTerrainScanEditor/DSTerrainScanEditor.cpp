@@ -0,0 +1,4 @@
+#include "DSTerrainScanEditor.h"
+#include "Modules/ModuleManager.h"
+
+IMPLEMENT_MODULE( FDefaultModuleImpl, DSTerrainScanEditor );
@@ -0,0 +1,353 @@
+﻿#include "TerrainScanBakeCommandlet.h"
+#include "Async/ParallelFor.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "Landscape.h"
+#include "Misc/PackageName.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "PhysicsSettingsCore.h"
+#include "ScannerIconsControllerComponent.h"
+#include "TerrainClassifier.h"
+#include "TerrainScanAtlas.h"
+#include "TerrainScanTileCacheSubsystem.h"
+#include "Misc/ScopeExit.h"
+#include "WorldPartition/WorldPartition.h"
+#include "WorldPartition/LoaderAdapter/LoaderAdapterShape.h"
+
+namespace
+{
+	/** Surface types of the physical materials mapped to an alternative terrain or to water. */
+	struct FSurfaceMapping
+	{
+		uint8 IDs[SurfaceType_Max] = {};
+
+		TBitArray<> Water{false, SurfaceType_Max};
+	};
+
+	TArray<EPhysicalSurface> ParseSurfaces(const FString& Params, const TCHAR* Key)
+	{
+		TArray<EPhysicalSurface> Surfaces;
+
+		FString Value;
+		if (!FParse::Value(*Params, Key, Value, false)) return Surfaces;
+
+		TArray<FString> Names;
+		Value.ParseIntoArray(Names, TEXT(","));
+
+		for (const FString& Name : Names)
+		{
+			const FPhysicalSurfaceName* Surface = UPhysicsSettingsCore::Get()->PhysicalSurfaces.FindByPredicate(
+				[&Name](const FPhysicalSurfaceName& Candidate) { return Candidate.Name.ToString() == Name; });
+
+			if (Surface)
+			{
+				Surfaces.Add(Surface->Type);
+				continue;
+			}
+
+			// Also accept the raw enum names, e.g. SurfaceType3.
+			const int64 RawValue = StaticEnum<EPhysicalSurface>()->GetValueByNameString(Name);
+			if (RawValue != INDEX_NONE)
+			{
+				Surfaces.Add(static_cast<EPhysicalSurface>(RawValue));
+				continue;
+			}
+
+			UE_LOG(LogTemp, Warning, TEXT("Terrain scan bake: unknown physical surface %s."), *Name);
+		}
+
+		return Surfaces;
+	}
+
+	FSurfaceMapping ParseSurfaceMapping(const FString& Params)
+	{
+		FSurfaceMapping Mapping;
+
+		const TPair<const TCHAR*, ETerrainType> AlternativeTerrains[] =
+		{
+			{ TEXT("RockySurfaces="), ETerrainType::Rocky },
+			{ TEXT("VegetationSurfaces="), ETerrainType::Vegetation },
+			{ TEXT("PathSurfaces="), ETerrainType::Path }
+		};
+
+		for (const TPair<const TCHAR*, ETerrainType>& Terrain : AlternativeTerrains)
+		{
+			for (EPhysicalSurface Surface : ParseSurfaces(Params, Terrain.Key))
+			{
+				Mapping.IDs[Surface] = static_cast<uint8>(Terrain.Value);
+			}
+		}
+
+		for (EPhysicalSurface Surface : ParseSurfaces(Params, TEXT("WaterSurfaces=")))
+		{
+			Mapping.Water[Surface] = true;
+		}
+
+		return Mapping;
+	}
+
+	FTerrainClassificationThresholds ParseThresholds(const FString& Params)
+	{
+		FTerrainClassificationThresholds Thresholds;
+		FParse::Value(*Params, TEXT("RegularTerrainThreshold="), Thresholds.RegularTerrainThreshold);
+		FParse::Value(*Params, TEXT("SteepTerrainThreshold="), Thresholds.SteepTerrainThreshold);
+		FParse::Value(*Params, TEXT("ShallowWaterThreshold="), Thresholds.ShallowWaterThreshold);
+		FParse::Value(*Params, TEXT("DeepWaterThreshold="), Thresholds.DeepWaterThreshold);
+		return Thresholds;
+	}
+
+	EPhysicalSurface GetSurface(const FHitResult& Hit)
+	{
+		const UPhysicalMaterial* Material = Hit.PhysMaterial.Get();
+		return Material ? Material->SurfaceType.GetValue() : SurfaceType_Default;
+	}
+
+	/**
+	 * Traces and classifies every cell of a tile.
+	 * @return false if nothing was hit.
+	 */
+	bool BakeTile(const UWorld* World, const FIntPoint& TileKey, float CellSize, const FBox& Bounds,
+		const FSurfaceMapping& Mapping, const FTerrainClassificationThresholds& Thresholds, FTerrainScanAtlasTile& OutTile)
+	{
+		constexpr int32 CellsPerSide = FTerrainScanTile::CellsPerSide;
+		constexpr int32 NumCells = FTerrainScanTile::NumCells;
+
+		// Same input as the runtime captures: depth from a camera right above the landscape.
+		const float CameraZ = Bounds.Max.Z + 100.0f;
+		const float EndZ = Bounds.Min.Z - 100.0f;
+
+		float Depth[NumCells];
+		float WaterDepth[NumCells];
+		FVector3f Normals[NumCells];
+		uint8 IDs[NumCells];
+		TBitArray<> Hits{false, NumCells};
+
+		FCollisionQueryParams QueryParams{SCENE_QUERY_STAT(TerrainScanBake), true};
+		QueryParams.bReturnPhysicalMaterial = true;
+
+		for (int32 Cell = 0; Cell < NumCells; ++Cell)
+		{
+			const int32 CellX = TileKey.X * CellsPerSide + Cell / CellsPerSide;
+			const int32 CellY = TileKey.Y * CellsPerSide + Cell % CellsPerSide;
+			const FVector2D Location{(CellX + 0.5) * CellSize, (CellY + 0.5) * CellSize};
+
+			Depth[Cell] = 0.0f;
+			WaterDepth[Cell] = 0.0f;
+			Normals[Cell] = FVector3f::UpVector;
+			IDs[Cell] = 0;
+
+			FHitResult Hit;
+			if (!World->LineTraceSingleByChannel(Hit, FVector{Location, CameraZ}, FVector{Location, EndZ},
+				ECC_Visibility, QueryParams))
+			{
+				continue;
+			}
+
+			Hits[Cell] = true;
+			Depth[Cell] = CameraZ - Hit.ImpactPoint.Z;
+			Normals[Cell] = FVector3f{Hit.ImpactNormal};
+			IDs[Cell] = Mapping.IDs[GetSurface(Hit)];
+
+			if (!Mapping.Water[GetSurface(Hit)]) continue;
+
+			// Water surface: trace again through it for the terrain below.
+			FCollisionQueryParams BelowWaterParams = QueryParams;
+			BelowWaterParams.AddIgnoredComponent(Hit.GetComponent());
+
+			FHitResult BottomHit;
+			WaterDepth[Cell] = World->LineTraceSingleByChannel(BottomHit, Hit.ImpactPoint, FVector{Location, EndZ},
+				ECC_Visibility, BelowWaterParams)
+				? Hit.ImpactPoint.Z - BottomHit.ImpactPoint.Z
+				: Thresholds.DeepWaterThreshold + 1.0f;
+		}
+
+		OutTile.NumKnownCells = 0;
+		if (!Hits.Contains(true)) return false;
+
+		FTerrainClassificationInput Input;
+		Input.GridX = CellsPerSide;
+		Input.GridY = CellsPerSide;
+		Input.CameraZ = CameraZ;
+		Input.Depth = MakeArrayView(Depth);
+		Input.WaterDepth = MakeArrayView(WaterDepth);
+		Input.Normals = MakeArrayView(Normals);
+		Input.IDs = MakeArrayView(IDs);
+
+		FTerrainClassificationResult Result;
+		if (!FTerrainClassifier::Classify(Input, Thresholds, Result)) return false;
+
+		// Quantized exactly like the runtime cache.
+		FTerrainScanTile Tile;
+		for (TConstSetBitIterator<> It(Hits); It; ++It)
+		{
+			Tile.SetCell(It.GetIndex(), Result.Types[It.GetIndex()], Result.Heights[It.GetIndex()]);
+		}
+
+		OutTile.BaseHeight = Tile.BaseHeight;
+		OutTile.NumKnownCells = Tile.GetNumKnownCells();
+		FMemory::Memcpy(OutTile.PackedTypes, Tile.PackedTypes, sizeof(OutTile.PackedTypes));
+		FMemory::Memcpy(OutTile.QuantizedHeights, Tile.QuantizedHeights, sizeof(OutTile.QuantizedHeights));
+		return true;
+	}
+}
+
+
+UTerrainScanBakeCommandlet::UTerrainScanBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UTerrainScanBakeCommandlet::Main(const FString& Params)
+{
+	FString MapName;
+	if (!FParse::Value(*Params, TEXT("Map="), MapName))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Terrain scan bake: missing -Map=<package name>."));
+		return 1;
+	}
+
+	float CellSize = 60.0f;
+	FParse::Value(*Params, TEXT("CellSize="), CellSize);
+	if (CellSize <= 0.0f)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Terrain scan bake: invalid cell size %f."), CellSize);
+		return 1;
+	}
+
+	FString Filename = FTerrainScanAtlas::GetAtlasFilename(FPackageName::GetShortName(MapName));
+	FParse::Value(*Params, TEXT("Output="), Filename);
+
+	const FSurfaceMapping Mapping = ParseSurfaceMapping(Params);
+	const FTerrainClassificationThresholds Thresholds = ParseThresholds(Params);
+
+	// Load the map with its physics scene, traces need collision.
+
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Terrain scan bake: cannot load map %s."), *MapName);
+		return 1;
+	}
+
+	World->AddToRoot();
+	World->WorldType = EWorldType::Editor;
+
+	const bool bInitializeWorld = !World->bIsWorldInitialized;
+	if (bInitializeWorld)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(true)
+			.RequiresHitProxies(false)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.ShouldSimulatePhysics(false)
+			.SetTransactional(false));
+	}
+
+	World->UpdateWorldComponents(true, false);
+
+	// Partitioned maps only load their always-loaded actors: load the whole map.
+	TUniquePtr<FLoaderAdapterShape> LoaderAdapter;
+	if (UWorldPartition* WorldPartition = World->GetWorldPartition())
+	{
+		LoaderAdapter = MakeUnique<FLoaderAdapterShape>(World, WorldPartition->GetEditorWorldBounds(), TEXT("TerrainScanBake"));
+		LoaderAdapter->Load();
+		World->UpdateWorldComponents(true, false);
+	}
+
+	// Whatever the outcome, unload the map: loaded actors, components, physics scene, then the world itself.
+	ON_SCOPE_EXIT
+	{
+		if (LoaderAdapter)
+		{
+			LoaderAdapter->Unload();
+			LoaderAdapter.Reset();
+		}
+
+		World->ClearWorldComponents();
+		if (bInitializeWorld)
+		{
+			World->CleanupWorld();
+		}
+
+		World->RemoveFromRoot();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	};
+
+	FBox Bounds{ForceInit};
+	for (TActorIterator<ALandscapeProxy> It(World); It; ++It)
+	{
+		Bounds += It->GetComponentsBoundingBox(true);
+	}
+
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Terrain scan bake: no landscape in %s."), *MapName);
+		return 1;
+	}
+
+	const float TileSize = CellSize * FTerrainScanTile::CellsPerSide;
+
+	FTerrainScanAtlasHeader Header;
+	Header.CellSize = CellSize;
+	Header.CellsPerTile = FTerrainScanTile::CellsPerSide;
+	Header.MinTileX = FMath::FloorToInt32(Bounds.Min.X / TileSize);
+	Header.MinTileY = FMath::FloorToInt32(Bounds.Min.Y / TileSize);
+	Header.NumTilesX = FMath::FloorToInt32(Bounds.Max.X / TileSize) - Header.MinTileX + 1;
+	Header.NumTilesY = FMath::FloorToInt32(Bounds.Max.Y / TileSize) - Header.MinTileY + 1;
+
+	UE_LOG(LogTemp, Display, TEXT("Terrain scan bake: %s, %d x %d tiles of %.0f uu."),
+		*MapName, Header.NumTilesX, Header.NumTilesY, TileSize);
+
+	// Written next to the output and renamed when complete, so a failed bake never leaves a truncated atlas.
+	const FString TempFilename = Filename + TEXT(".tmp");
+	TUniquePtr<FArchive> Writer{IFileManager::Get().CreateFileWriter(*TempFilename)};
+	if (!Writer)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Terrain scan bake: cannot write %s."), *TempFilename);
+		return 1;
+	}
+
+	Writer->Serialize(&Header, sizeof(Header));
+
+	// One row of tiles at a time keeps the memory bounded on large maps.
+	TArray<FTerrainScanAtlasTile> RowTiles;
+	RowTiles.SetNumZeroed(Header.NumTilesY);
+	int32 NumBakedTiles = 0;
+
+	for (int32 TileX = 0; TileX < Header.NumTilesX; ++TileX)
+	{
+		std::atomic<int32> NumRowTiles{0};
+
+		ParallelFor(Header.NumTilesY, [&](int32 TileY)
+		{
+			const FIntPoint TileKey{Header.MinTileX + TileX, Header.MinTileY + TileY};
+			if (BakeTile(World, TileKey, CellSize, Bounds, Mapping, Thresholds, RowTiles[TileY]))
+			{
+				++NumRowTiles;
+			}
+		});
+
+		Writer->Serialize(RowTiles.GetData(), RowTiles.Num() * sizeof(FTerrainScanAtlasTile));
+		NumBakedTiles += NumRowTiles;
+
+		UE_LOG(LogTemp, Display, TEXT("Terrain scan bake: row %d / %d."), TileX + 1, Header.NumTilesX);
+	}
+
+	const bool bWritten = Writer->Close() && !Writer->IsError();
+	Writer.Reset();
+
+	if (!bWritten || !IFileManager::Get().Move(*Filename, *TempFilename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Terrain scan bake: cannot write %s."), *Filename);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Terrain scan bake: %d non-empty tiles written to %s."), NumBakedTiles, *Filename);
+	return 0;
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TerrainScanBakeCommandlet.generated.h"
+
+
+/**
+ *	Bakes the terrain classification of a whole map into a FTerrainScanAtlas, so that scans
+ *	of the map sample pre-baked tiles instead of capturing the scene. Cells are line traced
+ *	top-down over the landscape bounds and classified with FTerrainClassifier, tiles in
+ *	parallel. Runs headless:
+ *
+ *	UnrealEditor-Cmd DSTerrainScan.uproject -run=TerrainScanBake -Map=/Game/STF/Pack03-LandscapePro/Maps/open_world_LSP_v2
+ *		[-CellSize=60] [-Output=<file>] [-RockySurfaces=A,B] [-VegetationSurfaces=A,B] [-PathSurfaces=A,B]
+ *		[-WaterSurfaces=A,B] [-RegularTerrainThreshold=0.8] [-SteepTerrainThreshold=0.7]
+ *		[-ShallowWaterThreshold=100] [-DeepWaterThreshold=500] -unattended -nullrhi
+ *
+ *	Surfaces are physical surface names from the project settings. CellSize and thresholds
+ *	must match the icons component settings (Padding and thresholds). The map is unloaded
+ *	once baked.
+ */
+UCLASS()
+class DSTERRAINSCANEDITOR_API UTerrainScanBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UTerrainScanBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};